@@ -0,0 +1,414 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+#include <veekay/types.hpp>
+#include <veekay/transforms.hpp>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+constexpr uint32_t sample_count = 7;
+constexpr double default_sample_time = 0.05; // NOTE: Seconds
+constexpr double default_threshold = 10.0; // NOTE: Percent
+
+constexpr size_t input_count = 1024; // NOTE: Power of two, inputs are picked by mask
+constexpr size_t batch_objects = 1024;
+constexpr size_t batch_points = 4096;
+
+struct Benchmark {
+	std::string name;
+	size_t items_per_op; // NOTE: Objects processed by a single operation
+	std::function<void(size_t iterations)> run;
+};
+
+struct Result {
+	std::string name;
+	double ns_per_op;
+	double ops_per_second;
+	double items_per_second;
+	size_t iterations;
+};
+
+// NOTE: Keeps compiler from throwing away computed values
+template <typename T>
+void doNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+	static volatile const void* sink;
+	sink = &value;
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+const char* simdName() {
+#if defined(VEEKAY_SIMD_AVX) && defined(VEEKAY_SIMD_FMA)
+	return "avx+fma";
+#elif defined(VEEKAY_SIMD_AVX)
+	return "avx";
+#elif defined(VEEKAY_SIMD_SSE)
+	return "sse";
+#elif defined(VEEKAY_SIMD_NEON)
+	return "neon";
+#else
+	return "scalar";
+#endif
+}
+
+double measure(const Benchmark& benchmark, size_t iterations) {
+	const auto start = clock::now();
+	benchmark.run(iterations);
+	return std::chrono::duration<double>(clock::now() - start).count();
+}
+
+Result execute(const Benchmark& benchmark, double sample_time) {
+	// NOTE: Grow iteration count until a run is long enough to be timed reliably
+	size_t iterations = 1;
+	double elapsed = measure(benchmark, iterations);
+
+	while (elapsed < sample_time / 10.0) {
+		iterations *= 2;
+		elapsed = measure(benchmark, iterations);
+	}
+
+	iterations = std::max<size_t>(1, size_t(double(iterations) * sample_time / elapsed));
+
+	std::vector<double> samples(sample_count);
+
+	for (double& sample : samples) {
+		sample = measure(benchmark, iterations) / double(iterations);
+	}
+
+	std::sort(samples.begin(), samples.end());
+	const double seconds_per_op = samples[sample_count / 2];
+
+	return Result{
+		.name = benchmark.name,
+		.ns_per_op = seconds_per_op * 1e9,
+		.ops_per_second = 1.0 / seconds_per_op,
+		.items_per_second = double(benchmark.items_per_op) / seconds_per_op,
+		.iterations = iterations,
+	};
+}
+
+// NOTE: One benchmark per line, so baselines can be read back without a JSON parser
+void writeJson(std::ostream& stream, const std::vector<Result>& results) {
+	stream << "{\n";
+	stream << "\t\"simd\": \"" << simdName() << "\",\n";
+	stream << "\t\"benchmarks\": [\n";
+
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result& result = results[i];
+
+		stream << "\t\t{\"name\": \"" << result.name << "\""
+		       << ", \"ns_per_op\": " << result.ns_per_op
+		       << ", \"ops_per_second\": " << result.ops_per_second
+		       << ", \"items_per_second\": " << result.items_per_second
+		       << ", \"iterations\": " << result.iterations
+		       << "}" << (i + 1 < results.size() ? "," : "") << '\n';
+	}
+
+	stream << "\t]\n";
+	stream << "}\n";
+}
+
+bool readBaseline(const char* path, std::vector<Result>& results) {
+	std::ifstream file(path);
+	if (!file) {
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(file, line)) {
+		const std::string name_key = "\"name\": \"";
+		const std::string time_key = "\"ns_per_op\": ";
+
+		size_t name_begin = line.find(name_key);
+		size_t time_begin = line.find(time_key);
+
+		if (name_begin == std::string::npos || time_begin == std::string::npos) {
+			continue;
+		}
+
+		name_begin += name_key.size();
+		size_t name_end = line.find('"', name_begin);
+
+		Result result{};
+		result.name = line.substr(name_begin, name_end - name_begin);
+		result.ns_per_op = std::strtod(line.c_str() + time_begin + time_key.size(), nullptr);
+
+		results.push_back(result);
+	}
+
+	return true;
+}
+
+float random(std::mt19937& engine) {
+	return std::uniform_real_distribution<float>(-1.0f, 1.0f)(engine);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	const char* json_path = nullptr;
+	const char* baseline_path = nullptr;
+	const char* filter = nullptr;
+	double threshold = default_threshold;
+	double sample_time = default_sample_time;
+
+	for (int i = 1; i < argc; ++i) {
+		const bool has_value = i + 1 < argc;
+
+		if (!std::strcmp(argv[i], "--json") && has_value) {
+			json_path = argv[++i];
+		} else if (!std::strcmp(argv[i], "--baseline") && has_value) {
+			baseline_path = argv[++i];
+		} else if (!std::strcmp(argv[i], "--threshold") && has_value) {
+			threshold = std::atof(argv[++i]);
+		} else if (!std::strcmp(argv[i], "--filter") && has_value) {
+			filter = argv[++i];
+		} else if (!std::strcmp(argv[i], "--sample-time") && has_value) {
+			sample_time = std::atof(argv[++i]) / 1000.0;
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [--json <file>] [--baseline <file>]"
+			             " [--threshold <percent>] [--filter <substring>]"
+			             " [--sample-time <milliseconds>]\n"
+			             "  --json         write results as JSON, '-' for standard output\n"
+			             "  --baseline     fail when a benchmark is slower than in a previous JSON\n"
+			             "  --threshold    allowed slowdown against a baseline, default 10%\n";
+			return 2;
+		}
+	}
+
+	using namespace veekay;
+
+	// NOTE: Random inputs, so nothing gets constant-folded
+	std::mt19937 engine(1234);
+
+	std::vector<vec3> vectors(input_count);
+	std::vector<vec4> points(input_count);
+	std::vector<mat4> matrices(input_count);
+	std::vector<float> angles(input_count);
+
+	for (size_t i = 0; i < input_count; ++i) {
+		vectors[i] = {random(engine), random(engine), random(engine) + 2.0f};
+		points[i] = {random(engine), random(engine), random(engine), 1.0f};
+		angles[i] = random(engine) * 3.0f;
+
+		for (int j = 0; j < 4; ++j) {
+			for (int k = 0; k < 4; ++k) {
+				matrices[i][j][k] = random(engine);
+			}
+		}
+	}
+
+	const size_t mask = input_count - 1;
+
+	// NOTE: Batch inputs in structure-of-arrays layout
+	std::vector<float> streams[10];
+	for (auto& stream : streams) {
+		stream.resize(batch_points);
+
+		for (float& value : stream) {
+			value = random(engine);
+		}
+	}
+
+	for (size_t i = 0; i < batch_objects; ++i) {
+		vec4 rotation = vec4::normalized({streams[3][i], streams[4][i], streams[5][i], streams[6][i]});
+
+		streams[3][i] = rotation.x;
+		streams[4][i] = rotation.y;
+		streams[5][i] = rotation.z;
+		streams[6][i] = rotation.w;
+	}
+
+	batch::TransformStreams transforms{
+		streams[0].data(), streams[1].data(), streams[2].data(),
+		streams[3].data(), streams[4].data(), streams[5].data(), streams[6].data(),
+		streams[7].data(), streams[8].data(), streams[9].data(),
+	};
+
+	std::vector<mat4> batch_output(batch_objects);
+
+	std::vector<float> point_output[3];
+	for (auto& stream : point_output) {
+		stream.resize(batch_points);
+	}
+
+	std::vector<float> box_output[6];
+	for (auto& stream : box_output) {
+		stream.resize(batch_points);
+	}
+
+	std::vector<Benchmark> benchmarks = {
+		{"vec3::normalized", 1, [&](size_t n) {
+			for (size_t i = 0; i < n; ++i) {
+				doNotOptimize(vec3::normalized(vectors[i & mask]));
+			}
+		}},
+		{"vec3::cross", 1, [&](size_t n) {
+			for (size_t i = 0; i < n; ++i) {
+				doNotOptimize(vec3::cross(vectors[i & mask], vectors[(i + 1) & mask]));
+			}
+		}},
+		{"vec4::dot", 1, [&](size_t n) {
+			for (size_t i = 0; i < n; ++i) {
+				doNotOptimize(vec4::dot(points[i & mask], points[(i + 1) & mask]));
+			}
+		}},
+		{"mat4::rotation", 1, [&](size_t n) {
+			for (size_t i = 0; i < n; ++i) {
+				doNotOptimize(mat4::rotation(vectors[i & mask], angles[i & mask]));
+			}
+		}},
+		{"mat4::projection", 1, [&](size_t n) {
+			for (size_t i = 0; i < n; ++i) {
+				float value = angles[i & mask];
+				doNotOptimize(mat4::projection(60.0f + value, 1.6f, 0.01f, 100.0f + value));
+			}
+		}},
+		{"mat4::operator*", 1, [&](size_t n) {
+			for (size_t i = 0; i < n; ++i) {
+				doNotOptimize(matrices[i & mask] * matrices[(i + 1) & mask]);
+			}
+		}},
+		{"mat4::multiplyScalar", 1, [&](size_t n) {
+			for (size_t i = 0; i < n; ++i) {
+				doNotOptimize(mat4::multiplyScalar(matrices[i & mask], matrices[(i + 1) & mask]));
+			}
+		}},
+		{"mat4::transpose", 1, [&](size_t n) {
+			for (size_t i = 0; i < n; ++i) {
+				doNotOptimize(mat4::transpose(matrices[i & mask]));
+			}
+		}},
+		{"mat4::transposeScalar", 1, [&](size_t n) {
+			for (size_t i = 0; i < n; ++i) {
+				doNotOptimize(mat4::transposeScalar(matrices[i & mask]));
+			}
+		}},
+		{"vec4*mat4", 1, [&](size_t n) {
+			for (size_t i = 0; i < n; ++i) {
+				doNotOptimize(points[i & mask] * matrices[(i + 1) & mask]);
+			}
+		}},
+		{"batch::composeTRS", batch_objects, [&](size_t n) {
+			for (size_t i = 0; i < n; ++i) {
+				batch::composeTRS(transforms, batch_objects, batch_output.data());
+				doNotOptimize(batch_output[i & (batch_objects - 1)]);
+			}
+		}},
+		{"batch::multiply", batch_objects, [&](size_t n) {
+			for (size_t i = 0; i < n; ++i) {
+				batch::multiply(matrices.data(), matrices[i & mask],
+				                batch_objects, batch_output.data());
+				doNotOptimize(batch_output[i & (batch_objects - 1)]);
+			}
+		}},
+		{"batch::transformPoints", batch_points, [&](size_t n) {
+			batch::PointStreams in{streams[0].data(), streams[1].data(), streams[2].data()};
+			batch::PointStreams out{point_output[0].data(), point_output[1].data(),
+			                        point_output[2].data()};
+
+			for (size_t i = 0; i < n; ++i) {
+				batch::transformPoints(matrices[i & mask], in, batch_points, out);
+				doNotOptimize(point_output[0][i & (batch_points - 1)]);
+			}
+		}},
+		{"batch::transformBoxes", batch_points, [&](size_t n) {
+			batch::BoxStreams in{streams[0].data(), streams[1].data(), streams[2].data(),
+			                     streams[3].data(), streams[4].data(), streams[5].data()};
+			batch::BoxStreams out{box_output[0].data(), box_output[1].data(), box_output[2].data(),
+			                      box_output[3].data(), box_output[4].data(), box_output[5].data()};
+
+			for (size_t i = 0; i < n; ++i) {
+				batch::transformBoxes(matrices[i & mask], in, batch_points, out);
+				doNotOptimize(box_output[0][i & (batch_points - 1)]);
+			}
+		}},
+	};
+
+	std::vector<Result> results;
+
+	std::cerr << "SIMD: " << simdName() << '\n';
+
+	for (const Benchmark& benchmark : benchmarks) {
+		if (filter && benchmark.name.find(filter) == std::string::npos) {
+			continue;
+		}
+
+		Result result = execute(benchmark, sample_time);
+
+		char line[256];
+		std::snprintf(line, sizeof(line), "%-26s %12.3f ns/op %16.0f ops/s %16.0f items/s\n",
+		              result.name.c_str(), result.ns_per_op,
+		              result.ops_per_second, result.items_per_second);
+		std::cerr << line;
+
+		results.push_back(result);
+	}
+
+	if (json_path) {
+		if (!std::strcmp(json_path, "-")) {
+			writeJson(std::cout, results);
+		} else {
+			std::ofstream file(json_path);
+			if (!file) {
+				std::cerr << "Failed to open " << json_path << " for writing\n";
+				return 1;
+			}
+
+			writeJson(file, results);
+		}
+	}
+
+	if (baseline_path) {
+		std::vector<Result> baseline;
+		if (!readBaseline(baseline_path, baseline)) {
+			std::cerr << "Failed to read baseline from " << baseline_path << '\n';
+			return 1;
+		}
+
+		int regressions = 0;
+
+		for (const Result& result : results) {
+			auto it = std::find_if(baseline.begin(), baseline.end(), [&](const Result& other) {
+				return other.name == result.name;
+			});
+
+			if (it == baseline.end() || it->ns_per_op <= 0.0) {
+				continue;
+			}
+
+			const double change = (result.ns_per_op / it->ns_per_op - 1.0) * 100.0;
+
+			if (change > threshold) {
+				std::cerr << "Regression: " << result.name << " is " << change
+				          << "% slower than baseline\n";
+				++regressions;
+			}
+		}
+
+		if (regressions > 0) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
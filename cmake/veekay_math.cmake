@@ -0,0 +1,29 @@
+# Header-only vector math (veekay/types.hpp, veekay/transforms.hpp) as a target
+# of its own, so benchmarks can build without Vulkan, GLFW or ImGui
+
+if(TARGET veekay_math)
+	return()
+endif()
+
+add_library(veekay_math INTERFACE)
+
+target_include_directories(veekay_math INTERFACE
+	$<BUILD_INTERFACE:${CMAKE_CURRENT_LIST_DIR}/../include>
+	$<INSTALL_INTERFACE:include>
+)
+
+target_compile_features(veekay_math INTERFACE cxx_std_20)
+
+# Vector math in types.hpp uses SSE (or NEON on AArch64) by default
+option(VEEKAY_ENABLE_AVX2 "Compile vector math with AVX2 and FMA instructions" OFF)
+option(VEEKAY_DISABLE_SIMD "Use scalar reference code for vector math" OFF)
+
+if(VEEKAY_DISABLE_SIMD)
+	target_compile_definitions(veekay_math INTERFACE VEEKAY_NO_SIMD)
+elseif(VEEKAY_ENABLE_AVX2)
+	if(MSVC)
+		target_compile_options(veekay_math INTERFACE /arch:AVX2)
+	else()
+		target_compile_options(veekay_math INTERFACE -mavx2 -mfma)
+	endif()
+endif()
@@ -8,6 +8,14 @@ typedef void (*InitFunc)(VkCommandBuffer);
 typedef void (*ShutdownFunc)();
 typedef void (*UpdateFunc)(double time);
 typedef void (*RenderFunc)(VkCommandBuffer, VkFramebuffer);
+typedef void (*ReadbackFunc)(uint64_t frame, const void* pixels);
+
+enum class PresentMode {
+	fifo,         // NOTE: Waits for vertical blank, always supported
+	fifo_relaxed, // NOTE: Like fifo, but late frames are shown right away and may tear
+	mailbox,      // NOTE: Newest frame replaces queued one, no tearing and low latency
+	immediate,    // NOTE: No waiting at all, tears
+};
 
 struct Application {
 	uint32_t window_width;
@@ -17,6 +25,38 @@ struct Application {
 	VkPhysicalDevice vk_physical_device;
 	VkRenderPass vk_render_pass;
 
+	// NOTE: Persisted between runs, pass it to every vkCreateXXXPipelines call
+	VkPipelineCache vk_pipeline_cache;
+
+	// NOTE: Optional device features, enabled when supported
+	bool multi_draw_indirect; // NOTE: Indirect draws may have drawCount above 1
+	bool draw_indirect_count; // NOTE: vkCmdDrawIndexedIndirectCount is available
+
+	// NOTE: Indirect draws may have non-zero firstInstance, otherwise it must be 0
+	bool draw_indirect_first_instance;
+
+	// NOTE: Block-compressed texture formats that may be sampled
+	bool texture_compression_bc;
+	bool texture_compression_etc2;
+	bool texture_compression_astc; // NOTE: LDR profile
+
+	// NOTE: Storage image arrays may be indexed, needed by compute mip generation
+	bool storage_image_array_indexing;
+
+	bool memory_budget; // NOTE: VK_EXT_memory_budget is enabled
+
+	// NOTE: VK_KHR_present_id and VK_KHR_present_wait are enabled,
+	//       frame limiter waits for frames to reach the display
+	bool present_wait;
+
+	// NOTE: What swapchain ended up with, FIFO when requested one is unsupported.
+	//       Meaningless for headless runs
+	VkPresentModeKHR vk_present_mode;
+
+	// NOTE: Frames per second, 0 is uncapped. May be changed at any time
+	double max_frame_rate;
+
+	bool headless;
 	bool running;
 };
 
@@ -25,6 +65,38 @@ struct ApplicationInfo {
 	ShutdownFunc shutdown;
 	UpdateFunc update;
 	RenderFunc render;
+
+	// NOTE: How many frames CPU may record ahead of GPU, 0 picks the default
+	uint32_t frames_in_flight;
+
+	// NOTE: Render into offscreen images instead of a window,
+	//       no GLFW window, surface or swapchain is created
+	bool headless;
+	uint32_t headless_width;
+	uint32_t headless_height;
+
+	// NOTE: Ignored by headless runs
+	PresentMode present_mode;
+
+	// NOTE: Initial app.max_frame_rate, limits headless runs too
+	double max_frame_rate;
+
+	// NOTE: Stop after that many headless frames, 0 runs until app.running is cleared
+	uint64_t headless_frames;
+
+	// NOTE: File compiled pipelines are kept in between runs, nullptr picks the default
+	const char* pipeline_cache_path;
+
+	// NOTE: Compiled mips.comp shader, nullptr picks the default. Without it
+	//       mips are blitted and only power of two textures get them
+	const char* mip_shader_path;
+
+	// NOTE: Compiled widen.comp shader, nullptr picks the default. Without it mesh
+	//       arenas widen 16-bit indices with a copy region per index, which is slow
+	const char* index_shader_path;
+
+	// NOTE: Optional, receives tightly packed B8G8R8A8 pixels of every finished headless frame
+	ReadbackFunc readback;
 };
 
 extern Application app;
@@ -1,21 +1,124 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
 #include <vulkan/vulkan_core.h>
 
 namespace veekay::graphics {
 
+struct MemoryBlock;
+struct Buffer;
+
+// NOTE: Range of a large VkDeviceMemory block, resources are bound at memory + offset
+struct Allocation {
+	VkDeviceMemory memory;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	void* mapped; // NOTE: Pointer to offset for host visible memory, nullptr otherwise
+	MemoryBlock* block;
+};
+
+// NOTE: Device memory usage, either of a single memory type or of all of them
+struct MemoryStats {
+	uint32_t block_count;            // NOTE: Live vkAllocateMemory allocations
+	uint32_t allocation_count;       // NOTE: Sub-allocations handed out from blocks
+	VkDeviceSize block_bytes;        // NOTE: Total size of blocks
+	VkDeviceSize used_bytes;         // NOTE: Bytes taken by sub-allocations
+	VkDeviceSize free_bytes;
+	VkDeviceSize largest_free_range;
+	uint32_t free_range_count;
+	float fragmentation;             // NOTE: 1 - largest_free_range / free_bytes, 0 when free space is contiguous
+};
+
+// NOTE: Sub-allocates memory with given properties from blocks of a matching memory type.
+//       Linear resources are buffers and linearly tiled images, optimal images
+//       are kept in separate blocks so bufferImageGranularity never gets in the way.
+//       Host visible blocks stay mapped for their whole lifetime
+//       Preferred flags are tried first and dropped when no memory type has them
+Allocation allocateMemory(const VkMemoryRequirements& requirements,
+                          VkMemoryPropertyFlags flags, bool linear,
+                          VkMemoryPropertyFlags preferred = 0);
+void freeMemory(const Allocation& allocation);
+
+MemoryStats memoryStats();
+MemoryStats memoryStats(uint32_t memory_type);
+
+// NOTE: Host visible memory for a copy recorded into a command buffer
+struct StagingAllocation {
+	VkBuffer buffer;
+	VkDeviceSize offset;
+	void* mapped;
+};
+
+// NOTE: Sub-allocates from a shared staging ring. Memory is reused as soon as
+//       the frame (or init) submission that recorded the copy completes, so
+//       it must only be used by commands of the current frame.
+//       Alignment doesn't have to be a power of two, e.g. for 12 byte texels
+StagingAllocation allocateStaging(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+// NOTE: Staging memory whose owner frees it once the GPU is done with it, for
+//       copies of submissions other than frame ones, e.g. asynchronous uploads.
+//       Held ring memory can't be reused by anyone until it's freed
+struct StagingBlock {
+	StagingAllocation allocation;
+	uint64_t region;  // NOTE: 0 when it didn't fit into the ring
+	Buffer* fallback; // NOTE: Temporary buffer in that case
+};
+
+// NOTE: Safe to call from any thread
+StagingBlock allocateStagingBlock(VkDeviceSize size, VkDeviceSize alignment = 16);
+void freeStagingBlock(const StagingBlock& block);
+
+// NOTE: Runs release once the frame (or init) submission being recorded completes,
+//       e.g. to destroy a resource its commands still use. Runs on main thread with
+//       staging locked, so release must not allocate staging memory itself
+void releaseAfterSubmit(std::function<void()> release);
+
+// NOTE: Where buffer memory lives and who is expected to access it
+enum class BufferPlacement {
+	device,   // NOTE: Device local, fastest for GPU, not accessible by CPU
+	upload,   // NOTE: Host visible and coherent, written by CPU and read by GPU
+	readback, // NOTE: Host visible and cached when possible, written by GPU and read by CPU
+};
+
 struct Buffer {
 	VkBuffer buffer;
-	VkDeviceMemory memory;
-	void* mapped_region;
+	Allocation allocation;
+	void* mapped_region; // NOTE: nullptr for device placement
+	BufferPlacement placement;
 
+	// NOTE: Device placement buffers can't be given initial data this way
 	Buffer(size_t size, const void* data,
+	       VkBufferUsageFlags usage,
+	       BufferPlacement placement = BufferPlacement::upload);
+
+	// NOTE: Device local buffer filled through staging memory, copy is recorded into cmd
+	Buffer(VkCommandBuffer cmd, size_t size, const void* data,
 	       VkBufferUsageFlags usage);
+
 	~Buffer();
 
 	static size_t structureAlignment(size_t struct_size);
 };
 
+// NOTE: Size of smallest addressable piece of an image, 1x1 for uncompressed formats
+struct FormatBlock {
+	uint32_t width;
+	uint32_t height;
+	uint32_t bytes; // NOTE: 0 for unknown formats
+};
+
+FormatBlock formatBlock(VkFormat format);
+
+// NOTE: Tightly packed bytes of a mip level, partial blocks at the edges are rounded up
+size_t textureLevelSize(VkFormat format, uint32_t width, uint32_t height, uint32_t level);
+
+// NOTE: Format can be copied into and sampled with optimal tiling, compressed
+//       families also need their device feature, see Application
+bool isFormatSampled(VkFormat format);
+
 struct Texture {
 	uint32_t width;
 	uint32_t height;
@@ -23,15 +126,44 @@ struct Texture {
 
 	VkImage image;
 	VkImageView view;
-	VkDeviceMemory memory;
+	Allocation allocation;
+
+	uint32_t mip_levels;
+
+	// NOTE: Levels are written by the mip compute shader, only images that
+	//       generate their mips are storage, others keep framebuffer compression
+	bool storage;
 
-	Buffer* staging;
+	// NOTE: Image contents are undefined, e.g. until filled by uploadTexture
+	//       Mip levels are generated for RGBA8 and BGRA8 images of any size and
+	//       for other power of two uncompressed ones, see generateMips
+	Texture(uint32_t width, uint32_t height, VkFormat format);
+
+	// NOTE: Levels are filled by the caller, generateMips blits them down
+	Texture(uint32_t width, uint32_t height, VkFormat format, uint32_t mip_levels);
 
 	Texture(VkCommandBuffer cmd,
 	        uint32_t width, uint32_t height,
 	        VkFormat format,
 	        const void* pixels);
+
+	// NOTE: Precomputed mip levels, levels[i] holds textureLevelSize bytes of level i.
+	//       Every level is copied with one command, works for block-compressed formats
+	Texture(VkCommandBuffer cmd,
+	        uint32_t width, uint32_t height,
+	        VkFormat format, uint32_t mip_levels,
+	        const void* const* levels);
 	~Texture();
+
+private:
+	Texture(uint32_t width, uint32_t height, VkFormat format,
+	        uint32_t mip_levels, bool generates_mips);
 };
 
+// NOTE: Builds every mip level from level 0, one compute dispatch per texture and
+//       barriers shared by the whole batch. Expects every level in TRANSFER_DST layout
+//       with level 0 filled, leaves all of them SHADER_READ_ONLY. Formats compute
+//       shader can't write are blitted down instead
+void generateMips(VkCommandBuffer cmd, const Texture* const* textures, size_t count);
+
 } // namespace veekay::graphics
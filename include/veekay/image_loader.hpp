@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/graphics.hpp>
+#include <veekay/uploads.hpp>
+
+// NOTE: Loads many image files at once: job threads decode them in parallel and
+//       convert pixels straight into upload staging memory. Decoding itself is
+//       left to the application, e.g. lodepng in testbed
+namespace veekay::graphics {
+
+struct DecodedImage {
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint8_t> pixels; // NOTE: Tightly packed R8G8B8A8, straight alpha
+};
+
+// NOTE: Decodes a whole file mapped into memory, returns false on malformed data.
+//       Called from job threads at the same time
+typedef std::function<bool(const void* data, size_t size, DecodedImage& image)> ImageDecodeFunc;
+
+struct ImageLoadRequest {
+	const char* path;
+
+	// NOTE: R8G8B8A8 or B8G8R8A8, SRGB variant tags pixels as sRGB encoded
+	VkFormat format;
+
+	// NOTE: Multiply color by alpha, in encoded space for sRGB formats
+	bool premultiply;
+};
+
+struct ImageLoadResult {
+	Texture* texture; // NOTE: nullptr when loading failed, see error
+	std::string error;
+
+	uint32_t width;
+	uint32_t height;
+
+	// NOTE: Milliseconds, decode includes mapping the file
+	double decode_time;
+	double convert_time;
+	double upload_time; // NOTE: From submission until texture was seen ready
+};
+
+// NOTE: Converts R8G8B8A8 pixels to one of R8G8B8A8 or B8G8R8A8 formats
+void convertPixels(const uint8_t* source, void* destination, size_t pixel_count,
+                   VkFormat format, bool premultiply);
+
+// NOTE: Blocks until every texture is ready or failed, helping with jobs and
+//       submitting uploads of decoded files meanwhile. Results are in order of
+//       requests. Main thread only
+std::vector<ImageLoadResult> loadImages(const ImageLoadRequest* requests, size_t count,
+                                        const ImageDecodeFunc& decode);
+
+} // namespace veekay::graphics
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+
+namespace veekay::jobs {
+
+typedef std::function<void()> JobFunc;
+typedef std::function<void(size_t begin, size_t end)> RangeFunc;
+
+// NOTE: Refers to a submitted job, stays valid after the job is done.
+//       Default constructed handle counts as already done
+struct Handle {
+	uint32_t slot;
+	uint32_t generation;
+};
+
+// NOTE: Runs func on a worker once all dependencies are done. Counts towards
+//       current frame, see waitFrame. Safe to call from any thread and from
+//       inside other jobs. Jobs must not throw
+Handle submit(JobFunc func, std::initializer_list<Handle> dependencies = {});
+
+// NOTE: Long running work (asset decode, file IO) that may span several frames.
+//       Only picked up by worker threads, never by threads waiting on frame jobs
+Handle submitBackground(JobFunc func, std::initializer_list<Handle> dependencies = {});
+
+// NOTE: Splits [0, count) into ranges of at least grain items processed
+//       in parallel, returned handle is done when all of them are
+Handle parallelFor(size_t count, size_t grain, RangeFunc func,
+                   std::initializer_list<Handle> dependencies = {});
+
+bool isDone(Handle handle);
+
+// NOTE: Runs one queued frame job on calling thread, or yields when there is none.
+//       For threads that poll something else while jobs make progress
+void help();
+
+// NOTE: Pool threads execute other frame jobs while waiting,
+//       threads created by the application just yield
+void wait(Handle handle);
+
+// NOTE: Waits for every non-background job submitted so far, veekay::run
+//       calls it after render callback so no job outlives its frame.
+//       Must not be called from inside a job
+void waitFrame();
+
+// NOTE: Threads executing jobs, including the main one
+uint32_t workerCount();
+
+} // namespace veekay::jobs
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace veekay {
+
+// NOTE: Read-only memory mapping of a whole file, pages are read in by the OS
+//       when touched. Mapping starts at a page boundary, so it's aligned for any type
+class MappedFile {
+public:
+	explicit MappedFile(const char* path);
+	~MappedFile();
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const void* data() const { return bytes; }
+	size_t size() const { return length; }
+
+private:
+	void close();
+
+	const uint8_t* bytes = nullptr;
+	size_t length = 0;
+
+#if defined(_WIN32)
+	void* file = nullptr;
+	void* mapping = nullptr;
+#endif
+};
+
+} // namespace veekay
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/mapped_file.hpp>
+
+// NOTE: Binary mesh container, laid out so it can be used straight from a memory
+//       mapping. Little-endian, every section starts at a mesh_file_alignment boundary:
+//
+//       MeshFileHeader | vertices | indices | MeshFileLod[] | MeshFileMeshlet[]
+namespace veekay::graphics {
+
+constexpr uint32_t mesh_file_magic = 0x464d4b56; // NOTE: "VKMF"
+constexpr uint32_t mesh_file_version = 1;
+constexpr uint32_t mesh_file_alignment = 64;
+
+enum class MeshVertexFormat : uint32_t {
+	quantized = 1, // NOTE: QuantizedVertex, see vertices.hpp
+};
+
+struct MeshFileHeader {
+	uint32_t magic;
+	uint32_t version;
+
+	MeshVertexFormat vertex_format;
+	uint32_t vertex_stride;
+	uint32_t index_type; // NOTE: VkIndexType, 16 or 32-bit
+
+	uint32_t lod_count;     // NOTE: At least one, first is full detail
+	uint32_t meshlet_count; // NOTE: Meshlets cover full detail indices only
+
+	// NOTE: Bounding sphere in model space
+	float bounds_center[3];
+	float bounds_radius;
+
+	// NOTE: QuantizationBounds of quantized positions
+	float quantization_center[3];
+	float quantization_extent;
+
+	uint32_t vertex_count;
+	uint32_t index_count; // NOTE: Of every LOD together
+	uint32_t _pad0;
+
+	// NOTE: Byte offsets from start of file
+	uint64_t vertex_offset;
+	uint64_t index_offset;
+	uint64_t lod_offset;
+	uint64_t meshlet_offset;
+
+	uint64_t file_size;
+};
+
+// NOTE: Every LOD indexes the same vertices
+struct MeshFileLod {
+	uint32_t first_index;
+	uint32_t index_count;
+	float error; // NOTE: Largest distance a vertex moved, in model units
+	uint32_t _pad0;
+};
+
+// NOTE: Small cluster of triangles for finer culling. Cone test rejects meshlets facing
+//       away: dot(normalize(center - camera), cone_axis) >= cone_cutoff
+struct MeshFileMeshlet {
+	uint32_t first_index;
+	uint32_t index_count;
+	uint32_t vertex_count; // NOTE: Unique vertices referenced
+	uint32_t _pad0;
+
+	float center[3];
+	float radius;
+
+	float cone_axis[3];
+	float cone_cutoff;
+};
+
+// NOTE: Validated view of a mapped mesh file, sections point into the mapping
+class MeshFile {
+public:
+	explicit MeshFile(const char* path);
+
+	const MeshFileHeader& header() const { return *head; }
+
+	const void* vertices() const { return base() + head->vertex_offset; }
+	const void* indices() const { return base() + head->index_offset; }
+
+	VkIndexType indexType() const { return VkIndexType(head->index_type); }
+
+	const MeshFileLod* lods() const {
+		return reinterpret_cast<const MeshFileLod*>(base() + head->lod_offset);
+	}
+
+	const MeshFileMeshlet* meshlets() const {
+		return reinterpret_cast<const MeshFileMeshlet*>(base() + head->meshlet_offset);
+	}
+
+private:
+	const uint8_t* base() const { return static_cast<const uint8_t*>(file.data()); }
+
+	MappedFile file;
+	const MeshFileHeader* head;
+};
+
+// NOTE: Everything a mesh file holds, vertices and indices as raw bytes
+struct MeshFileData {
+	MeshVertexFormat vertex_format;
+	uint32_t vertex_stride;
+	VkIndexType index_type;
+
+	float bounds_center[3];
+	float bounds_radius;
+
+	float quantization_center[3];
+	float quantization_extent;
+
+	uint32_t vertex_count;
+	uint32_t index_count;
+
+	std::vector<uint8_t> vertices;
+	std::vector<uint8_t> indices;
+
+	std::vector<MeshFileLod> lods;
+	std::vector<MeshFileMeshlet> meshlets;
+};
+
+// NOTE: Written next to path and renamed over it, so readers never see a torn file
+void writeMeshFile(const char* path, const MeshFileData& data);
+
+} // namespace veekay::graphics
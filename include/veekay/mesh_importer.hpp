@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+#include <veekay/types.hpp>
+
+// NOTE: Imports OBJ and glTF 2.0 (.gltf with external buffers, .glb) meshes on the job
+//       system. Files are memory mapped and cut into chunks parsed by parallel jobs, which
+//       hand converted data straight to a target instead of building whole vertex arrays
+namespace veekay::graphics {
+
+// NOTE: Same layout as float vertices of testbed
+struct ImportedVertex {
+	vec3 position;
+	vec3 normal;
+	vec2 uv; // NOTE: Origin at top left, like Vulkan
+};
+
+struct MeshImportInfo {
+	uint32_t vertex_count;
+	uint32_t index_count; // NOTE: Triangle list
+
+	// NOTE: Box around every position
+	vec3 bounds_min;
+	vec3 bounds_max;
+};
+
+// NOTE: Consecutive vertices and indices, either part may be empty. Indices are
+//       relative to mesh's first vertex, not to first_vertex of a chunk
+struct MeshImportChunk {
+	uint32_t first_vertex;
+	uint32_t vertex_count;
+	const ImportedVertex* vertices;
+
+	uint32_t first_index;
+	uint32_t index_count;
+	const uint32_t* indices;
+};
+
+struct MeshImportTarget {
+	// NOTE: Called once on importing thread with totals, before any chunk
+	std::function<void(const MeshImportInfo& info)> begin;
+
+	// NOTE: Called from job threads at the same time, chunks never overlap.
+	//       Every vertex and index of the mesh is written exactly once
+	std::function<void(const MeshImportChunk& chunk)> write;
+};
+
+struct MeshImportOptions {
+	// NOTE: Bytes of OBJ text or of converted glTF data handled by one job. Memory of
+	//       chunks in flight, held by running jobs, is proportional to it. OBJ still
+	//       keeps every v, vt and vn, since faces may reference any of them
+	size_t chunk_size = 4 << 20;
+
+	// NOTE: OBJ and glTF have Y up, veekay has Y down like Vulkan. Mirroring Y
+	//       also turns their counter-clockwise front faces into clockwise ones
+	bool mirror_y = true;
+
+	// NOTE: For files that don't follow counter-clockwise convention of their format
+	bool flip_winding = false;
+};
+
+// NOTE: Format is picked by extension. OBJ face corners with the same v, vt and vn
+//       share a vertex within a chunk, faces without normals get the face's normal and
+//       a vertex per corner. All triangle primitives of every glTF mesh are merged in
+//       mesh space, node transforms are ignored. Blocks until done, helping with jobs
+//       meanwhile. Throws std::runtime_error on malformed files
+void importMesh(const char* path, const MeshImportTarget& target,
+                const MeshImportOptions& options = {});
+
+} // namespace veekay::graphics
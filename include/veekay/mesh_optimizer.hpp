@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include <veekay/types.hpp>
+
+// NOTE: Mesh processing on CPU, independent of Vulkan, so offline tools can use it too.
+//       Index buffers are triangle lists of 32-bit indices
+namespace veekay::graphics {
+
+// NOTE: Post-transform cache simulated as a FIFO, which most GPUs approximate
+struct VertexCacheStats {
+	uint32_t misses;
+	float acmr; // NOTE: Misses per triangle, 0.5 is ideal for large grids, 3 is worst
+	float atvr; // NOTE: Misses per vertex, 1 is ideal
+};
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t index_count,
+                                    size_t vertex_count, uint32_t cache_size = 16);
+
+// NOTE: Maps every vertex onto the first bitwise identical one, returns unique vertex count.
+//       remap must hold vertex_count entries, unique vertices keep their relative order
+size_t generateVertexRemap(uint32_t* remap, const void* vertices,
+                           size_t vertex_count, size_t stride);
+
+// NOTE: Destination may not alias source, unused vertices are dropped
+void remapVertices(void* destination, const void* vertices, size_t vertex_count,
+                   size_t stride, const uint32_t* remap);
+void remapIndices(uint32_t* destination, const uint32_t* indices, size_t index_count,
+                  const uint32_t* remap);
+
+// NOTE: Reorders triangles for post-transform cache hits (Tipsify, Sander et al. 2007).
+//       Destination may alias indices
+void optimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t index_count,
+                         size_t vertex_count, uint32_t cache_size = 16);
+
+// NOTE: Reorders clusters of cache-optimized triangles so outward facing ones go first,
+//       letting early depth testing reject more of what follows. Clusters are split where
+//       cache already starts cold, so ACMR is approximately preserved, and when it got
+//       worse after all, input order is kept. Front faces are clockwise.
+//       Destination may alias indices
+void optimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t index_count,
+                      const vec3* positions, size_t vertex_count, size_t position_stride,
+                      uint32_t cache_size = 16);
+
+// NOTE: Renumbers vertices in order of first use, so vertex fetch reads memory linearly.
+//       Indices are rewritten in place, returns count of vertices referenced by them
+size_t optimizeVertexFetch(void* destination, uint32_t* indices, size_t index_count,
+                           const void* vertices, size_t vertex_count, size_t stride);
+
+struct MeshOptimizationReport {
+	size_t vertices_before;
+	size_t vertices_after;
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+// NOTE: Deduplication, vertex cache, overdraw and fetch passes in that order, in place.
+//       Vertex count shrinks when duplicates or unused vertices are found
+MeshOptimizationReport optimizeMesh(void* vertices, size_t& vertex_count, size_t stride,
+                                    size_t position_offset,
+                                    uint32_t* indices, size_t index_count);
+
+template <typename Vertex>
+MeshOptimizationReport optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+                                    size_t position_offset = 0) {
+	size_t vertex_count = vertices.size();
+
+	MeshOptimizationReport report = optimizeMesh(vertices.data(), vertex_count, sizeof(Vertex),
+	                                             position_offset, indices.data(), indices.size());
+
+	vertices.resize(vertex_count);
+
+	return report;
+}
+
+} // namespace veekay::graphics
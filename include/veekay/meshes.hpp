@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/graphics.hpp>
+#include <veekay/vertices.hpp>
+#include <veekay/mesh_file.hpp>
+#include <veekay/mesh_importer.hpp>
+
+namespace veekay::graphics {
+
+// NOTE: Where mesh data sits inside arena buffers, arguments of vkCmdDrawIndexed
+struct MeshRange {
+	uint32_t first_index;
+	uint32_t index_count;
+	int32_t vertex_offset;
+	uint32_t vertex_count;
+};
+
+// NOTE: Stays valid until mesh is removed, ranges may move on compaction
+typedef uint32_t MeshId;
+
+struct MeshArenaState;
+
+// NOTE: Vertices and indices of many meshes in one shared pair of device local
+//       buffers, so any of them is drawn without rebinding. Indices are relative
+//       to mesh's first vertex, so 16-bit ones only limit vertices per mesh. Arena
+//       with 16-bit indices widens to 32-bit ones when a mesh has more than
+//       65536 vertices, which replaces buffers like compact does and expands
+//       indices with widen.comp, see ApplicationInfo::index_shader_path.
+//       Copies are recorded into cmd, which must be the init or a frame command
+//       buffer. Main thread only
+class MeshArena {
+public:
+	MeshArena(uint32_t vertex_stride, uint32_t vertex_capacity, uint32_t index_capacity,
+	          VkIndexType index_type = VK_INDEX_TYPE_UINT32);
+	~MeshArena();
+
+	MeshArena(const MeshArena&) = delete;
+	MeshArena& operator=(const MeshArena&) = delete;
+
+	// NOTE: Data is copied before returning, indices are converted to arena's type.
+	//       Buffers grow when there is no room, which replaces them, like compact does
+	MeshId add(VkCommandBuffer cmd,
+	           const void* vertices, uint32_t vertex_count,
+	           const uint32_t* indices, uint32_t index_count);
+
+	// NOTE: Copies straight from file mapping into staging memory, so file must
+	//       match arena's vertex stride. Indices of other type are converted.
+	//       Range spans indices of every LOD, their first_index is relative to range's one
+	MeshId add(VkCommandBuffer cmd, const MeshFile& file);
+
+	// NOTE: Streams an OBJ or glTF file through importMesh, job threads quantize chunks
+	//       straight into staging memory. Arena must hold QuantizedVertex, quantization
+	//       receives bounds the mesh was quantized with
+	MeshId importFile(VkCommandBuffer cmd, const char* path, QuantizationBounds& quantization,
+	                  const MeshImportOptions& options = {});
+
+	// NOTE: Ranges are reused only after frames drawing the mesh complete
+	void remove(MeshId id);
+
+	const MeshRange& range(MeshId id) const;
+
+	// NOTE: Moves meshes to the start of buffers, closing gaps left by removed ones.
+	//       Buffers are replaced, descriptors referencing them must be rewritten
+	void compact(VkCommandBuffer cmd);
+
+	// NOTE: Binds vertex buffer to binding 0 and index buffer
+	void bind(VkCommandBuffer cmd) const;
+
+	Buffer* vertexBuffer() const;
+	Buffer* indexBuffer() const;
+
+	// NOTE: May change on add, bind() uses the current one
+	VkIndexType indexType() const;
+
+	uint32_t meshCount() const;
+
+	// NOTE: Largest of vertex and index fragmentation, 1 - largest free range / free space
+	float fragmentation() const;
+
+private:
+	// NOTE: Takes ranges and records copies from staging memory returned for caller to fill
+	MeshId reserve(VkCommandBuffer cmd, uint32_t vertex_count, uint32_t index_count,
+	               void*& vertex_data, void*& index_data);
+
+	void relocate(VkCommandBuffer cmd, uint32_t vertex_capacity, uint32_t index_capacity,
+	              VkIndexType index_type);
+
+	std::shared_ptr<MeshArenaState> state;
+};
+
+} // namespace veekay::graphics
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+namespace veekay::graphics {
+
+struct PipelineBuild;
+
+// NOTE: Pipeline compiled by a background job through app.vk_pipeline_cache
+struct PipelineHandle {
+	PipelineBuild* build; // NOTE: nullptr for zero initialized handles
+
+	// NOTE: True once pipeline() may be bound, draws using it should be
+	//       skipped or go through a fallback pipeline until then
+	bool ready() const;
+
+	// NOTE: Compilation finished unsuccessfully, pipeline() stays VK_NULL_HANDLE
+	bool failed() const;
+
+	// NOTE: VK_NULL_HANDLE until ready
+	VkPipeline pipeline() const;
+};
+
+// NOTE: Create info is deep copied, so it may live on the stack. Referenced
+//       shader modules, layout and render pass must outlive compilation.
+//       Extension structures (pNext) are not supported
+PipelineHandle compilePipeline(const VkGraphicsPipelineCreateInfo& info);
+PipelineHandle compilePipeline(const VkComputePipelineCreateInfo& info);
+
+// NOTE: Waits for compilation if it's still running
+void destroyPipeline(PipelineHandle handle);
+
+} // namespace veekay::graphics
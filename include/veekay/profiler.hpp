@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+namespace veekay::profiler {
+
+// NOTE: CPU phases of a frame in veekay::run, in order of execution
+enum class Phase {
+	frame_limit,
+	input,
+	events,
+	update,
+	imgui_render,
+	fence_wait,
+	acquire,
+	render,
+	imgui_record,
+	readback,
+	submit,
+	present,
+	count,
+};
+
+// NOTE: GPU phases of a frame, measured with timestamp queries
+enum class GpuPhase {
+	frame,   // NOTE: Everything submitted for a frame
+	render,  // NOTE: Commands recorded by application render callback
+	overlay, // NOTE: ImGui drawing or headless readback
+	count,
+};
+
+struct Timing {
+	double last;    // NOTE: Milliseconds spent during last measured frame
+	double average; // NOTE: Milliseconds, exponential moving average
+};
+
+Timing cpuTiming(Phase phase);
+Timing gpuTiming(GpuPhase phase);
+
+// NOTE: CPU time between beginnings of two consecutive frames
+Timing frameTiming();
+
+const char* phaseName(Phase phase);
+const char* phaseName(GpuPhase phase);
+
+// NOTE: False when graphics queue can't write timestamps, GPU timings stay zero then
+bool isGpuSupported();
+
+void setOverlayVisible(bool visible);
+bool isOverlayVisible();
+
+} // namespace veekay::profiler
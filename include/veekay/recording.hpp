@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vulkan/vulkan_core.h>
+
+namespace veekay::recording {
+
+// NOTE: Records draws [begin, end) into a secondary command buffer continuing
+//       app.vk_render_pass. Pipeline, descriptor sets and dynamic state are
+//       not inherited from the primary buffer, so every chunk binds its own.
+//       Called concurrently from several threads
+typedef void (*RecordFunc)(VkCommandBuffer cmd, size_t begin, size_t end);
+
+// NOTE: Splits count draws into chunks recorded as jobs, then executes
+//       them in order from cmd. Render pass must have been begun with
+//       VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS. Main thread or jobs only
+void recordParallel(VkCommandBuffer cmd, VkFramebuffer framebuffer,
+                    size_t count, RecordFunc func);
+
+// NOTE: Threads taking part in recording, including the calling one
+uint32_t threadCount();
+
+} // namespace veekay::recording
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/graphics.hpp>
+
+namespace veekay::graphics {
+
+struct StreamingOptions {
+	// NOTE: Bytes streamed textures may take, 0 leaves it to VK_EXT_memory_budget.
+	//       Without budget from either of them textures are never evicted
+	VkDeviceSize budget;
+
+	// NOTE: Levels with longer side at most this many texels stay resident, 0 picks 64
+	uint32_t tail_size;
+
+	// NOTE: Bytes of mip data read from files by a single update, 0 picks 16 MiB
+	VkDeviceSize upload_bytes_per_update;
+
+	// NOTE: Texture not reported for that many updates falls back to its tail, 0 picks 120
+	uint32_t unused_updates;
+};
+
+typedef uint32_t StreamedTextureId;
+
+struct TextureStreamerState;
+
+// NOTE: KTX2 textures with precomputed mips, resident from their smallest levels
+//       up to what the screen needs and the budget allows. Changing residency
+//       builds a new Texture, copying levels it shares with the resident one on
+//       device and uploading only new ones from the file mapping, and swaps it in
+//       once ready, so descriptors must be rewritten whenever generation changes.
+//       Main thread only
+class TextureStreamer {
+public:
+	explicit TextureStreamer(const StreamingOptions& options = {});
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// NOTE: Only tail levels are uploaded right away, texture() is nullptr until they land
+	StreamedTextureId add(const char* path);
+
+	// NOTE: Texture is destroyed once frames using it complete
+	void remove(StreamedTextureId id);
+
+	// NOTE: Longest side of texture on screen in pixels this frame, e.g. from projected
+	//       bounding sphere of a model using it. Largest report of an update wins
+	void reportUsage(StreamedTextureId id, float screen_size);
+
+	// NOTE: Swaps in finished uploads, evicts high levels while over budget and
+	//       requests levels screen needs. Call once per frame
+	void update();
+
+	Texture* texture(StreamedTextureId id) const;
+
+	// NOTE: Bumped every time texture() is replaced
+	uint64_t generation(StreamedTextureId id) const;
+
+	// NOTE: First level of the file texture() holds, 0 is full resolution
+	uint32_t residentLevel(StreamedTextureId id) const;
+
+	VkDeviceSize residentBytes() const;
+
+	// NOTE: Budget used by last update, UINT64_MAX when there is none
+	VkDeviceSize budget() const;
+
+private:
+	std::unique_ptr<TextureStreamerState> state;
+};
+
+} // namespace veekay::graphics
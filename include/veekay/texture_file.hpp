@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/mapped_file.hpp>
+
+// NOTE: KTX2 texture container, as written by toktx or basisu with no supercompression.
+//       Only single 2D images are supported, no arrays, cubemaps or 3D textures:
+//
+//       Ktx2Header | Ktx2Level[max(level_count, 1)] | DFD | KVD | SGD | mip levels
+namespace veekay::graphics {
+
+constexpr uint8_t ktx2_identifier[12] = {
+	0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n',
+};
+
+struct Ktx2Header {
+	uint8_t identifier[12];
+
+	uint32_t vk_format; // NOTE: VkFormat, VK_FORMAT_UNDEFINED for Basis Universal
+	uint32_t type_size;
+	uint32_t pixel_width;
+	uint32_t pixel_height;
+	uint32_t pixel_depth;
+	uint32_t layer_count;
+	uint32_t face_count;
+	uint32_t level_count; // NOTE: 0 asks loader to generate mips
+	uint32_t supercompression_scheme;
+
+	// NOTE: Data format descriptor and key/value data, not used by veekay
+	uint32_t dfd_offset;
+	uint32_t dfd_size;
+	uint32_t kvd_offset;
+	uint32_t kvd_size;
+
+	uint64_t sgd_offset;
+	uint64_t sgd_size;
+};
+
+// NOTE: Level index entry, level 0 is the largest one
+struct Ktx2Level {
+	uint64_t offset;
+	uint64_t size;
+	uint64_t uncompressed_size;
+};
+
+// NOTE: Validated view of a mapped KTX2 file, levels point into the mapping.
+//       Device support isn't checked here, see isFormatSampled
+class TextureFile {
+public:
+	explicit TextureFile(const char* path);
+
+	uint32_t width() const { return head->pixel_width; }
+	uint32_t height() const { return head->pixel_height; }
+	VkFormat format() const { return VkFormat(head->vk_format); }
+
+	uint32_t levelCount() const { return uint32_t(level_data.size()); }
+
+	// NOTE: levelCount pointers, laid out as Texture and uploadTexture expect them
+	const void* const* levels() const { return level_data.data(); }
+
+private:
+	MappedFile file;
+	const Ktx2Header* head;
+	std::vector<const void*> level_data;
+};
+
+} // namespace veekay::graphics
@@ -0,0 +1,385 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+
+#include <veekay/types.hpp>
+
+// NOTE: Structure-of-arrays transform kernels for large object counts.
+//       Every kernel processes 8 (AVX) or 4 (SSE, NEON) objects at a time
+//       and finishes the remainder with scalar code
+namespace veekay::batch {
+
+// NOTE: Rotation is a unit quaternion
+struct TransformStreams {
+	const float* position_x;
+	const float* position_y;
+	const float* position_z;
+
+	const float* rotation_x;
+	const float* rotation_y;
+	const float* rotation_z;
+	const float* rotation_w;
+
+	const float* scale_x;
+	const float* scale_y;
+	const float* scale_z;
+};
+
+struct PointStreams {
+	float* x;
+	float* y;
+	float* z;
+};
+
+struct BoxStreams {
+	float* min_x;
+	float* min_y;
+	float* min_z;
+
+	float* max_x;
+	float* max_y;
+	float* max_z;
+};
+
+namespace detail {
+
+	// NOTE: Lane policies share one interface, so kernels are written once
+	struct ScalarLanes {
+		using type = float;
+		static constexpr size_t width = 1;
+
+		static type load(const float* pointer) { return *pointer; }
+		static void store(float* pointer, type value) { *pointer = value; }
+		static type set(float value) { return value; }
+		static type add(type a, type b) { return a + b; }
+		static type sub(type a, type b) { return a - b; }
+		static type mul(type a, type b) { return a * b; }
+		static type madd(type a, type b, type c) { return a * b + c; }
+		static type abs(type a) { return std::fabs(a); }
+
+		// NOTE: matrix[j * 4 + i] holds element [j][i] of every object
+		static void storeMatrices(const type (&matrix)[16], char* output, size_t /*stride*/) {
+			float* destination = reinterpret_cast<float*>(output);
+
+			for (int i = 0; i < 16; ++i) {
+				destination[i] = matrix[i];
+			}
+		}
+	};
+
+#if defined(VEEKAY_SIMD_SSE)
+	struct SSELanes {
+		using type = __m128;
+		static constexpr size_t width = 4;
+
+		static type load(const float* pointer) { return _mm_loadu_ps(pointer); }
+		static void store(float* pointer, type value) { _mm_storeu_ps(pointer, value); }
+		static type set(float value) { return _mm_set1_ps(value); }
+		static type add(type a, type b) { return _mm_add_ps(a, b); }
+		static type sub(type a, type b) { return _mm_sub_ps(a, b); }
+		static type mul(type a, type b) { return _mm_mul_ps(a, b); }
+		static type madd(type a, type b, type c) { return simd::madd(a, b, c); }
+		static type abs(type a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+		static void storeMatrices(const type (&matrix)[16], char* output, size_t stride) {
+			for (int j = 0; j < 4; ++j) {
+				__m128 x = matrix[j * 4 + 0];
+				__m128 y = matrix[j * 4 + 1];
+				__m128 z = matrix[j * 4 + 2];
+				__m128 w = matrix[j * 4 + 3];
+
+				// NOTE: Lanes hold objects, turn them into rows of each object
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+
+				_mm_store_ps(reinterpret_cast<float*>(output + 0 * stride) + j * 4, x);
+				_mm_store_ps(reinterpret_cast<float*>(output + 1 * stride) + j * 4, y);
+				_mm_store_ps(reinterpret_cast<float*>(output + 2 * stride) + j * 4, z);
+				_mm_store_ps(reinterpret_cast<float*>(output + 3 * stride) + j * 4, w);
+			}
+		}
+	};
+#endif
+
+#if defined(VEEKAY_SIMD_AVX)
+	struct AVXLanes {
+		using type = __m256;
+		static constexpr size_t width = 8;
+
+		static type load(const float* pointer) { return _mm256_loadu_ps(pointer); }
+		static void store(float* pointer, type value) { _mm256_storeu_ps(pointer, value); }
+		static type set(float value) { return _mm256_set1_ps(value); }
+		static type add(type a, type b) { return _mm256_add_ps(a, b); }
+		static type sub(type a, type b) { return _mm256_sub_ps(a, b); }
+		static type mul(type a, type b) { return _mm256_mul_ps(a, b); }
+		static type madd(type a, type b, type c) { return simd::madd(a, b, c); }
+		static type abs(type a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+
+		static void storeMatrices(const type (&matrix)[16], char* output, size_t stride) {
+			SSELanes::type low[16];
+			SSELanes::type high[16];
+
+			for (int i = 0; i < 16; ++i) {
+				low[i] = _mm256_castps256_ps128(matrix[i]);
+				high[i] = _mm256_extractf128_ps(matrix[i], 1);
+			}
+
+			SSELanes::storeMatrices(low, output, stride);
+			SSELanes::storeMatrices(high, output + 4 * stride, stride);
+		}
+	};
+#endif
+
+#if defined(VEEKAY_SIMD_NEON)
+	struct NEONLanes {
+		using type = float32x4_t;
+		static constexpr size_t width = 4;
+
+		static type load(const float* pointer) { return vld1q_f32(pointer); }
+		static void store(float* pointer, type value) { vst1q_f32(pointer, value); }
+		static type set(float value) { return vdupq_n_f32(value); }
+		static type add(type a, type b) { return vaddq_f32(a, b); }
+		static type sub(type a, type b) { return vsubq_f32(a, b); }
+		static type mul(type a, type b) { return vmulq_f32(a, b); }
+		static type madd(type a, type b, type c) { return vfmaq_f32(c, a, b); }
+		static type abs(type a) { return vabsq_f32(a); }
+
+		static void storeMatrices(const type (&matrix)[16], char* output, size_t stride) {
+			for (int j = 0; j < 4; ++j) {
+				float32x4x2_t xy = vtrnq_f32(matrix[j * 4 + 0], matrix[j * 4 + 1]);
+				float32x4x2_t zw = vtrnq_f32(matrix[j * 4 + 2], matrix[j * 4 + 3]);
+
+				vst1q_f32(reinterpret_cast<float*>(output + 0 * stride) + j * 4,
+				          vcombine_f32(vget_low_f32(xy.val[0]), vget_low_f32(zw.val[0])));
+				vst1q_f32(reinterpret_cast<float*>(output + 1 * stride) + j * 4,
+				          vcombine_f32(vget_low_f32(xy.val[1]), vget_low_f32(zw.val[1])));
+				vst1q_f32(reinterpret_cast<float*>(output + 2 * stride) + j * 4,
+				          vcombine_f32(vget_high_f32(xy.val[0]), vget_high_f32(zw.val[0])));
+				vst1q_f32(reinterpret_cast<float*>(output + 3 * stride) + j * 4,
+				          vcombine_f32(vget_high_f32(xy.val[1]), vget_high_f32(zw.val[1])));
+			}
+		}
+	};
+#endif
+
+#if defined(VEEKAY_SIMD_AVX)
+	using WideLanes = AVXLanes;
+#elif defined(VEEKAY_SIMD_SSE)
+	using WideLanes = SSELanes;
+#elif defined(VEEKAY_SIMD_NEON)
+	using WideLanes = NEONLanes;
+#else
+	using WideLanes = ScalarLanes;
+#endif
+
+	// NOTE: Returns index of the first object left unprocessed
+	template <typename L>
+	size_t composeTRS(const TransformStreams& t, size_t begin, size_t count,
+	                  char* output, size_t stride) {
+		using type = typename L::type;
+
+		const type zero = L::set(0.0f);
+		const type one = L::set(1.0f);
+		const type two = L::set(2.0f);
+
+		size_t i = begin;
+
+		// NOTE: Bound known up front, otherwise GCC can't tell scalar tail
+		//       loops end and warns with -Waggressive-loop-optimizations
+		const size_t end = begin + (count - begin) / L::width * L::width;
+
+		for (; i < end; i += L::width) {
+			const type qx = L::load(t.rotation_x + i);
+			const type qy = L::load(t.rotation_y + i);
+			const type qz = L::load(t.rotation_z + i);
+			const type qw = L::load(t.rotation_w + i);
+
+			const type sx = L::load(t.scale_x + i);
+			const type sy = L::load(t.scale_y + i);
+			const type sz = L::load(t.scale_z + i);
+
+			const type xx = L::mul(qx, qx);
+			const type yy = L::mul(qy, qy);
+			const type zz = L::mul(qz, qz);
+			const type xy = L::mul(qx, qy);
+			const type xz = L::mul(qx, qz);
+			const type yz = L::mul(qy, qz);
+			const type wx = L::mul(qw, qx);
+			const type wy = L::mul(qw, qy);
+			const type wz = L::mul(qw, qz);
+
+			// NOTE: Same layout as mat4::scaling(s) * mat4::rotation(q) * mat4::translation(p)
+			const type matrix[16] = {
+				L::mul(L::sub(one, L::mul(two, L::add(yy, zz))), sx),
+				L::mul(L::mul(two, L::add(xy, wz)), sx),
+				L::mul(L::mul(two, L::sub(xz, wy)), sx),
+				zero,
+
+				L::mul(L::mul(two, L::sub(xy, wz)), sy),
+				L::mul(L::sub(one, L::mul(two, L::add(xx, zz))), sy),
+				L::mul(L::mul(two, L::add(yz, wx)), sy),
+				zero,
+
+				L::mul(L::mul(two, L::add(xz, wy)), sz),
+				L::mul(L::mul(two, L::sub(yz, wx)), sz),
+				L::mul(L::sub(one, L::mul(two, L::add(xx, yy))), sz),
+				zero,
+
+				L::load(t.position_x + i),
+				L::load(t.position_y + i),
+				L::load(t.position_z + i),
+				one,
+			};
+
+			L::storeMatrices(matrix, output + i * stride, stride);
+		}
+
+		return i;
+	}
+
+	template <typename L>
+	size_t transformPoints(const mat4& m, const PointStreams& in, size_t begin, size_t count,
+	                       const PointStreams& out) {
+		using type = typename L::type;
+
+		size_t i = begin;
+
+		const size_t end = begin + (count - begin) / L::width * L::width;
+
+		for (; i < end; i += L::width) {
+			const type x = L::load(in.x + i);
+			const type y = L::load(in.y + i);
+			const type z = L::load(in.z + i);
+
+			type result[3];
+
+			for (int c = 0; c < 3; ++c) {
+				result[c] = L::madd(x, L::set(m[0][c]),
+				            L::madd(y, L::set(m[1][c]),
+				            L::madd(z, L::set(m[2][c]), L::set(m[3][c]))));
+			}
+
+			L::store(out.x + i, result[0]);
+			L::store(out.y + i, result[1]);
+			L::store(out.z + i, result[2]);
+		}
+
+		return i;
+	}
+
+	template <typename L>
+	size_t transformBoxes(const mat4& m, const BoxStreams& in, size_t begin, size_t count,
+	                      const BoxStreams& out) {
+		using type = typename L::type;
+
+		const type half = L::set(0.5f);
+
+		size_t i = begin;
+
+		const size_t end = begin + (count - begin) / L::width * L::width;
+
+		for (; i < end; i += L::width) {
+			const type min_x = L::load(in.min_x + i);
+			const type min_y = L::load(in.min_y + i);
+			const type min_z = L::load(in.min_z + i);
+			const type max_x = L::load(in.max_x + i);
+			const type max_y = L::load(in.max_y + i);
+			const type max_z = L::load(in.max_z + i);
+
+			// NOTE: Center is transformed as a point, extent by absolute values of a matrix
+			const type center[3] = {
+				L::mul(L::add(min_x, max_x), half),
+				L::mul(L::add(min_y, max_y), half),
+				L::mul(L::add(min_z, max_z), half),
+			};
+
+			const type extent[3] = {
+				L::mul(L::sub(max_x, min_x), half),
+				L::mul(L::sub(max_y, min_y), half),
+				L::mul(L::sub(max_z, min_z), half),
+			};
+
+			type new_center[3];
+			type new_extent[3];
+
+			for (int c = 0; c < 3; ++c) {
+				new_center[c] = L::madd(center[0], L::set(m[0][c]),
+				                L::madd(center[1], L::set(m[1][c]),
+				                L::madd(center[2], L::set(m[2][c]), L::set(m[3][c]))));
+
+				new_extent[c] = L::madd(extent[0], L::abs(L::set(m[0][c])),
+				                L::madd(extent[1], L::abs(L::set(m[1][c])),
+				                L::mul(extent[2], L::abs(L::set(m[2][c])))));
+			}
+
+			L::store(out.min_x + i, L::sub(new_center[0], new_extent[0]));
+			L::store(out.min_y + i, L::sub(new_center[1], new_extent[1]));
+			L::store(out.min_z + i, L::sub(new_center[2], new_extent[2]));
+			L::store(out.max_x + i, L::add(new_center[0], new_extent[0]));
+			L::store(out.max_y + i, L::add(new_center[1], new_extent[1]));
+			L::store(out.max_z + i, L::add(new_center[2], new_extent[2]));
+		}
+
+		return i;
+	}
+
+	inline bool isAligned(const void* pointer, size_t stride) {
+		return (reinterpret_cast<uintptr_t>(pointer) & 15) == 0 && (stride & 15) == 0;
+	}
+
+} // namespace detail
+
+// NOTE: Builds model matrices (scaling, then rotation, then translation).
+//       Matrix of object i is written at output + i * stride, so it can go
+//       straight into a mapped uniform buffer. Output and stride must be 16-byte aligned
+inline void composeTRS(const TransformStreams& transforms, size_t count,
+                       void* output, size_t stride = sizeof(mat4)) {
+	assert(detail::isAligned(output, stride));
+
+	char* destination = static_cast<char*>(output);
+
+	size_t i = detail::composeTRS<detail::WideLanes>(transforms, 0, count, destination, stride);
+	detail::composeTRS<detail::ScalarLanes>(transforms, i, count, destination, stride);
+}
+
+// NOTE: output[i] = lhs[i] * rhs[i], output and stride must be 16-byte aligned
+inline void multiply(const mat4* lhs, const mat4* rhs, size_t count,
+                     void* output, size_t stride = sizeof(mat4)) {
+	assert(detail::isAligned(output, stride));
+
+	char* destination = static_cast<char*>(output);
+
+	for (size_t i = 0; i < count; ++i) {
+		*reinterpret_cast<mat4*>(destination + i * stride) = lhs[i] * rhs[i];
+	}
+}
+
+// NOTE: output[i] = lhs[i] * rhs, e.g. model matrices composed with a view-projection
+inline void multiply(const mat4* lhs, const mat4& rhs, size_t count,
+                     void* output, size_t stride = sizeof(mat4)) {
+	assert(detail::isAligned(output, stride));
+
+	char* destination = static_cast<char*>(output);
+
+	for (size_t i = 0; i < count; ++i) {
+		*reinterpret_cast<mat4*>(destination + i * stride) = lhs[i] * rhs;
+	}
+}
+
+// NOTE: Transforms points as row vectors with w = 1, in and out may be the same streams
+inline void transformPoints(const mat4& matrix, const PointStreams& in, size_t count,
+                            const PointStreams& out) {
+	size_t i = detail::transformPoints<detail::WideLanes>(matrix, in, 0, count, out);
+	detail::transformPoints<detail::ScalarLanes>(matrix, in, i, count, out);
+}
+
+// NOTE: Computes axis-aligned bounds of transformed boxes, in and out may be the same streams
+inline void transformBoxes(const mat4& matrix, const BoxStreams& in, size_t count,
+                           const BoxStreams& out) {
+	size_t i = detail::transformBoxes<detail::WideLanes>(matrix, in, 0, count, out);
+	detail::transformBoxes<detail::ScalarLanes>(matrix, in, i, count, out);
+}
+
+} // namespace veekay::batch
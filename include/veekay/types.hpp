@@ -3,8 +3,60 @@
 #include <cstdint>
 #include <cmath>
 
+// NOTE: Instruction set for vector math is picked at compile time,
+//       define VEEKAY_NO_SIMD to fall back to scalar reference code
+#if !defined(VEEKAY_NO_SIMD)
+	#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || \
+	    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+		#include <immintrin.h>
+		#define VEEKAY_SIMD_SSE
+
+		#if defined(__AVX__)
+			#define VEEKAY_SIMD_AVX
+		#endif
+
+		#if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+			#define VEEKAY_SIMD_FMA
+		#endif
+	#elif defined(__ARM_NEON) && defined(__aarch64__)
+		#include <arm_neon.h>
+		#define VEEKAY_SIMD_NEON
+	#endif
+#endif
+
 namespace veekay {
 
+#if defined(VEEKAY_SIMD_SSE)
+namespace simd {
+
+	// NOTE: a * b + c
+	inline __m128 madd(__m128 a, __m128 b, __m128 c) {
+	#if defined(VEEKAY_SIMD_FMA)
+		return _mm_fmadd_ps(a, b, c);
+	#else
+		return _mm_add_ps(_mm_mul_ps(a, b), c);
+	#endif
+	}
+
+	#if defined(VEEKAY_SIMD_AVX)
+	inline __m256 madd(__m256 a, __m256 b, __m256 c) {
+	#if defined(VEEKAY_SIMD_FMA)
+		return _mm256_fmadd_ps(a, b, c);
+	#else
+		return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+	#endif
+	}
+
+	// NOTE: Same 4 floats in both 128-bit lanes
+	inline __m256 broadcast(const float* pointer) {
+		__m128 value = _mm_loadu_ps(pointer);
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(value), value, 1);
+	}
+	#endif
+
+} // namespace simd
+#endif
+
 union vec2 {
 	struct {
 		float x;
@@ -263,34 +315,114 @@ union vec4 {
 	float elements[4];
 
 	vec4& operator+=(const vec4& other) {
+	#if defined(VEEKAY_SIMD_SSE)
+		_mm_storeu_ps(elements, _mm_add_ps(_mm_loadu_ps(elements), _mm_loadu_ps(other.elements)));
+	#elif defined(VEEKAY_SIMD_NEON)
+		vst1q_f32(elements, vaddq_f32(vld1q_f32(elements), vld1q_f32(other.elements)));
+	#else
 		x += other.x;
 		y += other.y;
 		z += other.z;
 		w += other.w;
+	#endif
+		return *this;
+	}
+
+	vec4& operator+=(float scalar) {
+	#if defined(VEEKAY_SIMD_SSE)
+		_mm_storeu_ps(elements, _mm_add_ps(_mm_loadu_ps(elements), _mm_set1_ps(scalar)));
+	#elif defined(VEEKAY_SIMD_NEON)
+		vst1q_f32(elements, vaddq_f32(vld1q_f32(elements), vdupq_n_f32(scalar)));
+	#else
+		x += scalar;
+		y += scalar;
+		z += scalar;
+		w += scalar;
+	#endif
 		return *this;
 	}
 
 	vec4& operator-=(const vec4& other) {
+	#if defined(VEEKAY_SIMD_SSE)
+		_mm_storeu_ps(elements, _mm_sub_ps(_mm_loadu_ps(elements), _mm_loadu_ps(other.elements)));
+	#elif defined(VEEKAY_SIMD_NEON)
+		vst1q_f32(elements, vsubq_f32(vld1q_f32(elements), vld1q_f32(other.elements)));
+	#else
 		x -= other.x;
 		y -= other.y;
 		z -= other.z;
 		w -= other.w;
+	#endif
+		return *this;
+	}
+
+	vec4& operator-=(float scalar) {
+	#if defined(VEEKAY_SIMD_SSE)
+		_mm_storeu_ps(elements, _mm_sub_ps(_mm_loadu_ps(elements), _mm_set1_ps(scalar)));
+	#elif defined(VEEKAY_SIMD_NEON)
+		vst1q_f32(elements, vsubq_f32(vld1q_f32(elements), vdupq_n_f32(scalar)));
+	#else
+		x -= scalar;
+		y -= scalar;
+		z -= scalar;
+		w -= scalar;
+	#endif
 		return *this;
 	}
 
 	vec4& operator*=(const vec4& other) {
+	#if defined(VEEKAY_SIMD_SSE)
+		_mm_storeu_ps(elements, _mm_mul_ps(_mm_loadu_ps(elements), _mm_loadu_ps(other.elements)));
+	#elif defined(VEEKAY_SIMD_NEON)
+		vst1q_f32(elements, vmulq_f32(vld1q_f32(elements), vld1q_f32(other.elements)));
+	#else
 		x *= other.x;
 		y *= other.y;
 		z *= other.z;
 		w *= other.w;
+	#endif
+		return *this;
+	}
+
+	vec4& operator*=(float scalar) {
+	#if defined(VEEKAY_SIMD_SSE)
+		_mm_storeu_ps(elements, _mm_mul_ps(_mm_loadu_ps(elements), _mm_set1_ps(scalar)));
+	#elif defined(VEEKAY_SIMD_NEON)
+		vst1q_f32(elements, vmulq_n_f32(vld1q_f32(elements), scalar));
+	#else
+		x *= scalar;
+		y *= scalar;
+		z *= scalar;
+		w *= scalar;
+	#endif
 		return *this;
 	}
 
 	vec4& operator/=(const vec4& other) {
+	#if defined(VEEKAY_SIMD_SSE)
+		_mm_storeu_ps(elements, _mm_div_ps(_mm_loadu_ps(elements), _mm_loadu_ps(other.elements)));
+	#elif defined(VEEKAY_SIMD_NEON)
+		vst1q_f32(elements, vdivq_f32(vld1q_f32(elements), vld1q_f32(other.elements)));
+	#else
 		x /= other.x;
 		y /= other.y;
 		z /= other.z;
 		w /= other.w;
+	#endif
+		return *this;
+	}
+
+	vec4& operator/=(float scalar) {
+	#if defined(VEEKAY_SIMD_SSE)
+		_mm_storeu_ps(elements, _mm_div_ps(_mm_loadu_ps(elements), _mm_set1_ps(scalar)));
+	#elif defined(VEEKAY_SIMD_NEON)
+		vst1q_f32(elements, vdivq_f32(vld1q_f32(elements), vdupq_n_f32(scalar)));
+	#else
+		x /= scalar;
+		y /= scalar;
+		z /= scalar;
+		w /= scalar;
+	#endif
 		return *this;
 	}
 
@@ -299,21 +431,68 @@ union vec4 {
 		return result += other;
 	}
 
+	vec4 operator+(float scalar) const {
+		vec4 result = *this;
+		return result += scalar;
+	}
+
 	vec4 operator-(const vec4& other) const {
 		vec4 result = *this;
 		return result -= other;
 	}
 
+	vec4 operator-(float scalar) const {
+		vec4 result = *this;
+		return result -= scalar;
+	}
+
+	vec4 operator-() const { return {-x, -y, -z, -w}; }
+
 	vec4 operator*(const vec4& other) const {
 		vec4 result = *this;
 		return result *= other;
 	}
 
+	vec4 operator*(float scalar) const {
+		vec4 result = *this;
+		return result *= scalar;
+	}
+
 	vec4 operator/(const vec4& other) const {
 		vec4 result = *this;
 		return result /= other;
 	}
 
+	vec4 operator/(float scalar) const {
+		vec4 result = *this;
+		return result /= scalar;
+	}
+
+	static float dot(const vec4& lhs, const vec4& rhs) {
+	#if defined(VEEKAY_SIMD_SSE)
+		__m128 product = _mm_mul_ps(_mm_loadu_ps(lhs.elements), _mm_loadu_ps(rhs.elements));
+		__m128 sum = _mm_add_ps(product, _mm_movehl_ps(product, product));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+		return _mm_cvtss_f32(sum);
+	#elif defined(VEEKAY_SIMD_NEON)
+		return vaddvq_f32(vmulq_f32(vld1q_f32(lhs.elements), vld1q_f32(rhs.elements)));
+	#else
+		return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z + lhs.w * rhs.w;
+	#endif
+	}
+
+	static float squaredLength(const vec4& vector) {
+		return dot(vector, vector);
+	}
+
+	static float length(const vec4& vector) {
+		return std::sqrt(squaredLength(vector));
+	}
+
+	static vec4 normalized(const vec4& vector) {
+		return vector / length(vector);
+	}
+
 	float& operator[](size_t index) { return elements[index]; }
 	const float& operator[](size_t index) const { return elements[index]; }
 };
@@ -401,6 +580,37 @@ union mat4 {
 	}
 
 	static mat4 transpose(const mat4& matrix) {
+	#if defined(VEEKAY_SIMD_SSE)
+		__m128 row0 = _mm_loadu_ps(matrix.elements[0]);
+		__m128 row1 = _mm_loadu_ps(matrix.elements[1]);
+		__m128 row2 = _mm_loadu_ps(matrix.elements[2]);
+		__m128 row3 = _mm_loadu_ps(matrix.elements[3]);
+
+		_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+		mat4 result;
+		_mm_storeu_ps(result.elements[0], row0);
+		_mm_storeu_ps(result.elements[1], row1);
+		_mm_storeu_ps(result.elements[2], row2);
+		_mm_storeu_ps(result.elements[3], row3);
+		return result;
+	#elif defined(VEEKAY_SIMD_NEON)
+		// NOTE: De-interleaving load of 4 vectors is a transpose
+		float32x4x4_t rows = vld4q_f32(&matrix.elements[0][0]);
+
+		mat4 result;
+		vst1q_f32(result.elements[0], rows.val[0]);
+		vst1q_f32(result.elements[1], rows.val[1]);
+		vst1q_f32(result.elements[2], rows.val[2]);
+		vst1q_f32(result.elements[3], rows.val[3]);
+		return result;
+	#else
+		return transposeScalar(matrix);
+	#endif
+	}
+
+	// NOTE: Reference implementation, SIMD code must match its results
+	static mat4 transposeScalar(const mat4& matrix) {
 		mat4 result{};
 
 		for (int j = 0; j < 4; ++j) {
@@ -413,12 +623,76 @@ union mat4 {
 	}
 
 	mat4 operator*(const mat4& other) const {
+		mat4 result;
+
+		// NOTE: Every row of a result is a combination of rows of other,
+		//       weighted by elements of a matching row of this matrix
+	#if defined(VEEKAY_SIMD_AVX)
+		const __m256 other0 = simd::broadcast(other.elements[0]);
+		const __m256 other1 = simd::broadcast(other.elements[1]);
+		const __m256 other2 = simd::broadcast(other.elements[2]);
+		const __m256 other3 = simd::broadcast(other.elements[3]);
+
+		// NOTE: Two rows at a time, one per 128-bit lane
+		for (int j = 0; j < 4; j += 2) {
+			const __m256 rows = _mm256_loadu_ps(&elements[0][0] + j * 4);
+
+			__m256 sum = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(0, 0, 0, 0)), other0);
+			sum = simd::madd(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(1, 1, 1, 1)), other1, sum);
+			sum = simd::madd(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(2, 2, 2, 2)), other2, sum);
+			sum = simd::madd(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(3, 3, 3, 3)), other3, sum);
+
+			_mm256_storeu_ps(&result.elements[0][0] + j * 4, sum);
+		}
+	#elif defined(VEEKAY_SIMD_SSE)
+		const __m128 other0 = _mm_loadu_ps(other.elements[0]);
+		const __m128 other1 = _mm_loadu_ps(other.elements[1]);
+		const __m128 other2 = _mm_loadu_ps(other.elements[2]);
+		const __m128 other3 = _mm_loadu_ps(other.elements[3]);
+
+		for (int j = 0; j < 4; ++j) {
+			const __m128 row = _mm_loadu_ps(elements[j]);
+
+			__m128 sum = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), other0);
+			sum = simd::madd(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), other1, sum);
+			sum = simd::madd(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), other2, sum);
+			sum = simd::madd(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3, 3, 3, 3)), other3, sum);
+
+			_mm_storeu_ps(result.elements[j], sum);
+		}
+	#elif defined(VEEKAY_SIMD_NEON)
+		const float32x4_t other0 = vld1q_f32(other.elements[0]);
+		const float32x4_t other1 = vld1q_f32(other.elements[1]);
+		const float32x4_t other2 = vld1q_f32(other.elements[2]);
+		const float32x4_t other3 = vld1q_f32(other.elements[3]);
+
+		for (int j = 0; j < 4; ++j) {
+			const float32x4_t row = vld1q_f32(elements[j]);
+
+			float32x4_t sum = vmulq_laneq_f32(other0, row, 0);
+			sum = vfmaq_laneq_f32(sum, other1, row, 1);
+			sum = vfmaq_laneq_f32(sum, other2, row, 2);
+			sum = vfmaq_laneq_f32(sum, other3, row, 3);
+
+			vst1q_f32(result.elements[j], sum);
+		}
+	#else
+		result = multiplyScalar(*this, other);
+	#endif
+
+		return result;
+	}
+
+	// NOTE: Reference implementation, SIMD code sums in the same order. Fused
+	//       multiply-add (VEEKAY_SIMD_FMA, NEON) skips intermediate rounding,
+	//       so results match within a few ULP rather than exactly
+	static mat4 multiplyScalar(const mat4& lhs, const mat4& rhs) {
 		mat4 result{};
 
 		for (int j = 0; j < 4; j++) {
 			for (int i = 0; i < 4; i++) {
 				for (int k = 0; k < 4; k++) {
-					result[j][i] += elements[j][k] * other[k][i];
+					result[j][i] += lhs.elements[j][k] * rhs[k][i];
 				}
 			}
 		}
@@ -430,4 +704,37 @@ union mat4 {
 	const vec4& operator[](size_t index) const { return columns[index]; }
 };
 
+// NOTE: Transforms a row vector, so `vector * a * b` applies a first, then b.
+//       Matches `matrix * vector` in GLSL, since matrices share memory layout
+inline vec4 operator*(const vec4& vector, const mat4& matrix) {
+	vec4 result;
+
+#if defined(VEEKAY_SIMD_SSE)
+	const __m128 v = _mm_loadu_ps(vector.elements);
+
+	__m128 sum = _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)), _mm_loadu_ps(matrix.elements[0]));
+	sum = simd::madd(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)), _mm_loadu_ps(matrix.elements[1]), sum);
+	sum = simd::madd(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)), _mm_loadu_ps(matrix.elements[2]), sum);
+	sum = simd::madd(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)), _mm_loadu_ps(matrix.elements[3]), sum);
+
+	_mm_storeu_ps(result.elements, sum);
+#elif defined(VEEKAY_SIMD_NEON)
+	const float32x4_t v = vld1q_f32(vector.elements);
+
+	float32x4_t sum = vmulq_laneq_f32(vld1q_f32(matrix.elements[0]), v, 0);
+	sum = vfmaq_laneq_f32(sum, vld1q_f32(matrix.elements[1]), v, 1);
+	sum = vfmaq_laneq_f32(sum, vld1q_f32(matrix.elements[2]), v, 2);
+	sum = vfmaq_laneq_f32(sum, vld1q_f32(matrix.elements[3]), v, 3);
+
+	vst1q_f32(result.elements, sum);
+#else
+	for (int i = 0; i < 4; ++i) {
+		result[i] = vector.x * matrix[0][i] + vector.y * matrix[1][i] +
+		            vector.z * matrix[2][i] + vector.w * matrix[3][i];
+	}
+#endif
+
+	return result;
+}
+
 } // namespace veekay
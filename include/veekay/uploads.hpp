@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/graphics.hpp>
+
+namespace veekay::graphics {
+
+// NOTE: Completion handle of an asynchronous upload, cheap to copy and poll
+struct UploadHandle {
+	uint64_t batch;
+
+	// NOTE: True once resource may be used by frame commands
+	bool ready() const;
+
+	// NOTE: Blocks until upload completes, must be called from main thread
+	void wait() const;
+};
+
+// NOTE: Device local buffer filled in the background, on a dedicated transfer
+//       queue when there is one. Data is copied before returning, so it can be
+//       freed right away. Buffer must not be used by frame commands until
+//       handle is ready. Safe to call from any thread
+Buffer* uploadBuffer(size_t size, const void* data,
+                     VkBufferUsageFlags usage, UploadHandle& handle);
+
+// NOTE: Same for textures, mip levels are generated on graphics queue afterwards
+Texture* uploadTexture(uint32_t width, uint32_t height,
+                       VkFormat format, const void* pixels,
+                       UploadHandle& handle);
+
+// NOTE: Staging memory for level 0 pixels of a texture, for callers that
+//       write them in place instead of copying from their own memory
+StagingBlock createUploadStaging(uint32_t width, uint32_t height, VkFormat format);
+
+// NOTE: Same, with pixels already in staging memory from createUploadStaging.
+//       Takes ownership of it, even when texture can't be created
+Texture* uploadTexture(uint32_t width, uint32_t height,
+                       VkFormat format, const StagingBlock& staging,
+                       UploadHandle& handle);
+
+// NOTE: Precomputed mip levels, see Texture. Nothing runs on graphics queue
+//       besides ownership transfer
+Texture* uploadTexture(uint32_t width, uint32_t height,
+                       VkFormat format, uint32_t mip_levels,
+                       const void* const* levels, UploadHandle& handle);
+
+// NOTE: Same, only first uploaded_levels come from levels, the rest are copied on
+//       graphics queue from source starting at its source_level, e.g. when its
+//       range of resident levels changes. Source must be sampled only in
+//       SHADER_READ_ONLY layout and stay alive until handle is ready
+Texture* uploadTexture(uint32_t width, uint32_t height,
+                       VkFormat format, uint32_t mip_levels,
+                       const void* const* levels, uint32_t uploaded_levels,
+                       const Texture* source, uint32_t source_level,
+                       UploadHandle& handle);
+
+// NOTE: False when uploads share graphics queue
+bool hasTransferQueue();
+
+} // namespace veekay::graphics
@@ -1,6 +1,21 @@
 #pragma once
 
 #include <veekay/types.hpp>
+#include <veekay/transforms.hpp>
 #include <veekay/application.hpp>
 #include <veekay/input.hpp>
 #include <veekay/graphics.hpp>
+#include <veekay/uploads.hpp>
+#include <veekay/meshes.hpp>
+#include <veekay/vertices.hpp>
+#include <veekay/mesh_optimizer.hpp>
+#include <veekay/mapped_file.hpp>
+#include <veekay/mesh_file.hpp>
+#include <veekay/mesh_importer.hpp>
+#include <veekay/texture_file.hpp>
+#include <veekay/streaming.hpp>
+#include <veekay/image_loader.hpp>
+#include <veekay/recording.hpp>
+#include <veekay/jobs.hpp>
+#include <veekay/pipelines.hpp>
+#include <veekay/profiler.hpp>
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/types.hpp>
+
+namespace veekay::graphics {
+
+// NOTE: 16 bytes instead of 32 of a full float vertex, fetched as
+//       R16G16B16A16_SNORM, R16G16_SNORM and R16G16_UNORM attributes
+struct QuantizedVertex {
+	int16_t position[4]; // NOTE: xyz inside quantization bounds, w is padding
+	int16_t normal[2];   // NOTE: Octahedral encoding, see decode in shader.vert
+	uint16_t uv[2];      // NOTE: Clamped to [0, 1], wrapping UVs don't fit
+};
+
+// NOTE: Cube around a mesh, position = center + quantized * extent. Scale is
+//       uniform, so dequantization folds into the model matrix without skewing normals
+struct QuantizationBounds {
+	vec3 center;
+	float extent;
+
+	// NOTE: Multiply by model matrix on the right, matrix() * model
+	mat4 matrix() const;
+};
+
+// NOTE: Positions are read with a byte stride, so any vertex struct works
+QuantizationBounds quantizationBounds(const vec3* positions, size_t count, size_t stride);
+QuantizationBounds quantizationBounds(const vec3& min, const vec3& max);
+
+QuantizedVertex quantizeVertex(const QuantizationBounds& bounds, const vec3& position,
+                               const vec3& normal, const vec2& uv);
+
+int16_t packSnorm16(float value);
+uint16_t packUnorm16(float value);
+
+// NOTE: Unit vector onto an octahedron unfolded into [-1, 1] square
+vec2 encodeOctahedral(const vec3& normal);
+vec3 decodeOctahedral(const vec2& encoded);
+
+// NOTE: Binding with locations 0 (position), 1 (normal) and 2 (uv)
+VkVertexInputBindingDescription quantizedVertexBinding(uint32_t binding);
+void quantizedVertexAttributes(uint32_t binding, VkVertexInputAttributeDescription (&attributes)[3]);
+
+// NOTE: 16-bit when every index fits, indices are relative to first vertex of a mesh
+VkIndexType smallestIndexType(uint32_t vertex_count);
+uint32_t indexSize(VkIndexType type);
+
+// NOTE: Converts 32-bit indices into given type, out must hold count * indexSize(type) bytes
+void packIndices(const uint32_t* indices, size_t count, VkIndexType type, void* out);
+
+} // namespace veekay::graphics
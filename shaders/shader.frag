@@ -3,14 +3,10 @@
 layout (location = 0) in vec3 f_position;
 layout (location = 1) in vec3 f_normal;
 layout (location = 2) in vec2 f_uv;
+layout (location = 3) flat in vec3 f_albedo_color;
 
 layout (location = 0) out vec4 final_color;
 
-layout (binding = 1, std140) uniform ModelUniforms {
-	mat4 model;
-	vec3 albedo_color;
-};
-
 void main() {
-	final_color = vec4(albedo_color, 1.0f);
+	final_color = vec4(f_albedo_color, 1.0f);
 }
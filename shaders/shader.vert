@@ -1,29 +1,52 @@
 #version 450
 
-layout (location = 0) in vec3 v_position;
-layout (location = 1) in vec3 v_normal;
+// NOTE: Quantized attributes, vertex fetch maps snorm to [-1, 1] and unorm to [0, 1]
+layout (location = 0) in vec3 v_position; // NOTE: Inside mesh bounds, model matrix restores it
+layout (location = 1) in vec2 v_normal;   // NOTE: Octahedral encoding
 layout (location = 2) in vec2 v_uv;
 
 layout (location = 0) out vec3 f_position;
 layout (location = 1) out vec3 f_normal;
 layout (location = 2) out vec2 f_uv;
+layout (location = 3) flat out vec3 f_albedo_color;
 
 layout (binding = 0, std140) uniform SceneUniforms {
 	mat4 view_projection;
 };
 
-layout (binding = 1, std140) uniform ModelUniforms {
+struct ModelInstance {
 	mat4 model;
 	vec3 albedo_color;
 };
 
+layout (binding = 1, std430) readonly buffer ModelInstances {
+	ModelInstance instances[];
+};
+
+// NOTE: Non-zero only for draws whose firstInstance must stay 0
+layout (push_constant) uniform DrawParameters {
+	uint first_object;
+};
+
+vec3 decodeOctahedral(vec2 encoded) {
+	vec3 normal = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-normal.z, 0.0f);
+	normal.xy += mix(vec2(fold), vec2(-fold), greaterThanEqual(normal.xy, vec2(0.0f)));
+	return normalize(normal);
+}
+
 void main() {
-	vec4 position = model * vec4(v_position, 1.0f);
-	vec4 normal = model * vec4(v_normal, 0.0f);
+	ModelInstance instance = instances[first_object + gl_InstanceIndex];
+
+	vec4 position = instance.model * vec4(v_position, 1.0f);
+
+	// NOTE: Model matrix carries dequantization scale, renormalize
+	vec3 normal = normalize((instance.model * vec4(decodeOctahedral(v_normal), 0.0f)).xyz);
 
 	gl_Position = view_projection * position;
 
 	f_position = position.xyz;
-	f_normal = normal.xyz;
+	f_normal = normal;
 	f_uv = v_uv;
+	f_albedo_color = instance.albedo_color;
 }
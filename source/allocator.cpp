@@ -0,0 +1,303 @@
+#include <veekay/graphics.hpp>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <veekay/application.hpp>
+#include <vulkan/vulkan_core.h>
+
+#include "free_list.hpp"
+
+namespace veekay::graphics {
+
+struct MemoryBlock {
+	VkDeviceMemory memory;
+	VkDeviceSize size;
+	void* mapped;
+
+	uint32_t memory_type;
+	uint32_t pool;
+	uint32_t allocation_count;
+	bool dedicated; // NOTE: Holds a single allocation too big to share a block
+
+	FreeList free_list;
+};
+
+namespace {
+
+	constexpr VkDeviceSize default_block_size = 64ull << 20;
+	constexpr VkDeviceSize min_block_size = 1ull << 20;
+
+	// NOTE: Blocks for linear resources and for optimal tiling images
+	constexpr uint32_t linear_pool = 0;
+	constexpr uint32_t optimal_pool = 1;
+	constexpr uint32_t pool_count = 2;
+
+	std::mutex mutex;
+
+	VkPhysicalDeviceMemoryProperties memory_properties;
+	VkDeviceSize buffer_image_granularity;
+	VkDeviceSize block_sizes[VK_MAX_MEMORY_TYPES];
+
+	std::vector<std::unique_ptr<MemoryBlock>> pools[VK_MAX_MEMORY_TYPES][pool_count];
+
+	uint32_t findMemoryType(uint32_t type_bits, VkMemoryPropertyFlags flags) {
+		for (uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i) {
+			const VkMemoryType& type = memory_properties.memoryTypes[i];
+
+			if ((type_bits & (1 << i)) && (type.propertyFlags & flags) == flags) {
+				return i;
+			}
+		}
+
+		return UINT32_MAX;
+	}
+
+	MemoryBlock* createBlock(uint32_t memory_type, uint32_t pool,
+	                         VkDeviceSize size, bool dedicated) {
+		VkDevice& device = veekay::app.vk_device;
+
+		VkMemoryAllocateInfo info{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+			.allocationSize = size,
+			.memoryTypeIndex = memory_type,
+		};
+
+		VkDeviceMemory memory;
+
+		if (vkAllocateMemory(device, &info, nullptr, &memory) != VK_SUCCESS) {
+			return nullptr;
+		}
+
+		void* mapped = nullptr;
+
+		const VkMemoryPropertyFlags flags = memory_properties.memoryTypes[memory_type].propertyFlags;
+
+		if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+			if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+				vkFreeMemory(device, memory, nullptr);
+				throw std::runtime_error("Failed to map Vulkan memory block");
+			}
+		}
+
+		auto block = std::make_unique<MemoryBlock>(MemoryBlock{
+			.memory = memory,
+			.size = size,
+			.mapped = mapped,
+			.memory_type = memory_type,
+			.pool = pool,
+			.allocation_count = 0,
+			.dedicated = dedicated,
+			.free_list = FreeList(size),
+		});
+
+		MemoryBlock* result = block.get();
+		pools[memory_type][pool].push_back(std::move(block));
+
+		return result;
+	}
+
+	void destroyBlock(MemoryBlock* block) {
+		auto& pool = pools[block->memory_type][block->pool];
+
+		// NOTE: Freeing memory implicitly unmaps it
+		vkFreeMemory(veekay::app.vk_device, block->memory, nullptr);
+
+		pool.erase(std::find_if(pool.begin(), pool.end(), [block](const auto& other) {
+			return other.get() == block;
+		}));
+	}
+
+	Allocation suballocate(MemoryBlock* block, VkDeviceSize size, VkDeviceSize alignment) {
+		const uint64_t offset = block->free_list.allocate(size, alignment);
+
+		if (offset == FreeList::invalid_offset) {
+			return Allocation{};
+		}
+
+		++block->allocation_count;
+
+		return Allocation{
+			.memory = block->memory,
+			.offset = offset,
+			.size = size,
+			.mapped = block->mapped ? static_cast<char*>(block->mapped) + offset : nullptr,
+			.block = block,
+		};
+	}
+
+	void accumulate(MemoryStats& stats, uint32_t memory_type) {
+		for (const auto& pool : pools[memory_type]) {
+			for (const auto& block : pool) {
+				const FreeList& list = block->free_list;
+
+				stats.block_count += 1;
+				stats.allocation_count += block->allocation_count;
+				stats.block_bytes += block->size;
+				stats.used_bytes += list.usedBytes();
+				stats.free_bytes += list.freeBytes();
+				stats.free_range_count += uint32_t(list.rangeCount());
+				stats.largest_free_range = std::max(stats.largest_free_range, list.largestRange());
+			}
+		}
+	}
+
+	MemoryStats finalize(MemoryStats stats) {
+		stats.fragmentation = stats.free_bytes > 0
+		                      ? 1.0f - float(stats.largest_free_range) / float(stats.free_bytes)
+		                      : 0.0f;
+		return stats;
+	}
+
+} // namespace
+
+Allocation allocateMemory(const VkMemoryRequirements& requirements,
+                          VkMemoryPropertyFlags flags, bool linear,
+                          VkMemoryPropertyFlags preferred) {
+	std::lock_guard lock(mutex);
+
+	uint32_t memory_type = findMemoryType(requirements.memoryTypeBits, flags | preferred);
+
+	if (memory_type == UINT32_MAX) {
+		memory_type = findMemoryType(requirements.memoryTypeBits, flags);
+	}
+
+	if (memory_type == UINT32_MAX) {
+		throw std::runtime_error("Failed to find required memory type to allocate Vulkan memory");
+	}
+
+	// NOTE: With granularity of 1 linear and optimal resources may share blocks freely
+	const uint32_t pool = (linear || buffer_image_granularity <= 1) ? linear_pool : optimal_pool;
+
+	const VkDeviceSize size = requirements.size;
+	const VkDeviceSize alignment = requirements.alignment;
+	VkDeviceSize block_size = block_sizes[memory_type];
+
+	if (size > block_size / 2) {
+		MemoryBlock* block = createBlock(memory_type, pool, size, true);
+
+		if (!block) {
+			throw std::runtime_error("Failed to allocate dedicated Vulkan memory block");
+		}
+
+		return suballocate(block, size, alignment);
+	}
+
+	for (const auto& block : pools[memory_type][pool]) {
+		if (block->dedicated) {
+			continue;
+		}
+
+		Allocation allocation = suballocate(block.get(), size, alignment);
+
+		if (allocation.block) {
+			return allocation;
+		}
+	}
+
+	// NOTE: Fall back to smaller blocks when device is running out of memory
+	for (; block_size >= size; block_size /= 2) {
+		MemoryBlock* block = createBlock(memory_type, pool, block_size, false);
+
+		if (block) {
+			return suballocate(block, size, alignment);
+		}
+	}
+
+	throw std::runtime_error("Failed to allocate Vulkan memory block");
+}
+
+void freeMemory(const Allocation& allocation) {
+	MemoryBlock* block = allocation.block;
+
+	if (!block) {
+		return;
+	}
+
+	std::lock_guard lock(mutex);
+
+	block->free_list.free(allocation.offset, allocation.size);
+	--block->allocation_count;
+
+	if (block->allocation_count > 0) {
+		return;
+	}
+
+	if (block->dedicated) {
+		destroyBlock(block);
+		return;
+	}
+
+	// NOTE: Keep one empty block around, so freeing and allocating
+	//       a single resource repeatedly doesn't hit the driver every time
+	for (const auto& other : pools[block->memory_type][block->pool]) {
+		if (other.get() != block && !other->dedicated && other->allocation_count == 0) {
+			destroyBlock(block);
+			return;
+		}
+	}
+}
+
+MemoryStats memoryStats() {
+	std::lock_guard lock(mutex);
+
+	MemoryStats stats{};
+
+	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i) {
+		accumulate(stats, i);
+	}
+
+	return finalize(stats);
+}
+
+MemoryStats memoryStats(uint32_t memory_type) {
+	std::lock_guard lock(mutex);
+
+	MemoryStats stats{};
+
+	if (memory_type < memory_properties.memoryTypeCount) {
+		accumulate(stats, memory_type);
+	}
+
+	return finalize(stats);
+}
+
+void initAllocator() {
+	VkPhysicalDevice& physical_device = veekay::app.vk_physical_device;
+
+	vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+
+	{
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(physical_device, &props);
+
+		buffer_image_granularity = props.limits.bufferImageGranularity;
+	}
+
+	// NOTE: Small heaps (e.g. 256 MiB BAR on discrete GPUs) get proportionally smaller blocks
+	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i) {
+		const uint32_t heap = memory_properties.memoryTypes[i].heapIndex;
+		const VkDeviceSize heap_size = memory_properties.memoryHeaps[heap].size;
+
+		block_sizes[i] = std::clamp(heap_size / 8, min_block_size, default_block_size);
+	}
+}
+
+void shutdownAllocator() {
+	std::lock_guard lock(mutex);
+
+	for (auto& type_pools : pools) {
+		for (auto& pool : type_pools) {
+			for (const auto& block : pool) {
+				vkFreeMemory(veekay::app.vk_device, block->memory, nullptr);
+			}
+
+			pool.clear();
+		}
+	}
+}
+
+} // namespace veekay::graphics
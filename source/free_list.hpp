@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <iterator>
+
+namespace veekay {
+
+// NOTE: Best-fit allocator of ranges inside [0, capacity), knows nothing about
+//       what the ranges are. Free ranges are coalesced with their neighbours
+class FreeList {
+public:
+	static constexpr uint64_t invalid_offset = UINT64_MAX;
+
+	explicit FreeList(uint64_t capacity = 0) {
+		reset(capacity);
+	}
+
+	// NOTE: Forgets every allocation, whole range becomes free
+	void reset(uint64_t capacity) {
+		total = capacity;
+		free_total = capacity;
+		ranges.clear();
+		by_size.clear();
+
+		if (capacity > 0) {
+			insert(0, capacity);
+		}
+	}
+
+	// NOTE: Returns offset of an allocated range or invalid_offset,
+	//       alignment must be a power of two
+	uint64_t allocate(uint64_t size, uint64_t alignment = 1) {
+		if (size == 0) {
+			return invalid_offset;
+		}
+
+		// NOTE: Smallest range that still fits after aligning its offset
+		for (auto it = by_size.lower_bound(size); it != by_size.end(); ++it) {
+			const uint64_t range_offset = it->second;
+			const uint64_t range_size = it->first;
+
+			const uint64_t offset = (range_offset + alignment - 1) & ~(alignment - 1);
+			const uint64_t padding = offset - range_offset;
+
+			if (padding + size > range_size) {
+				continue;
+			}
+
+			eraseBySize(it);
+
+			if (padding > 0) {
+				insert(range_offset, padding);
+			}
+
+			if (padding + size < range_size) {
+				insert(offset + size, range_size - padding - size);
+			}
+
+			free_total -= size;
+			return offset;
+		}
+
+		return invalid_offset;
+	}
+
+	void free(uint64_t offset, uint64_t size) {
+		free_total += size;
+
+		auto next = ranges.lower_bound(offset);
+
+		if (next != ranges.end() && offset + size == next->first) {
+			size += next->second;
+			next = eraseByOffset(next);
+		}
+
+		if (next != ranges.begin()) {
+			auto previous = std::prev(next);
+
+			if (previous->first + previous->second == offset) {
+				offset = previous->first;
+				size += previous->second;
+				eraseByOffset(previous);
+			}
+		}
+
+		insert(offset, size);
+	}
+
+	uint64_t capacity() const { return total; }
+	uint64_t freeBytes() const { return free_total; }
+	uint64_t usedBytes() const { return total - free_total; }
+	size_t rangeCount() const { return ranges.size(); }
+
+	uint64_t largestRange() const {
+		return by_size.empty() ? 0 : by_size.rbegin()->first;
+	}
+
+	// NOTE: True when nothing is allocated
+	bool empty() const { return free_total == total; }
+
+	// NOTE: Calls visit(offset, size) for every free range in offset order
+	template <typename F>
+	void forEachRange(F&& visit) const {
+		for (const auto& [offset, size] : ranges) {
+			visit(offset, size);
+		}
+	}
+
+private:
+	using SizeIterator = std::multimap<uint64_t, uint64_t>::iterator;
+	using OffsetIterator = std::map<uint64_t, uint64_t>::iterator;
+
+	void insert(uint64_t offset, uint64_t size) {
+		ranges.emplace(offset, size);
+		by_size.emplace(size, offset);
+	}
+
+	void eraseBySize(SizeIterator it) {
+		ranges.erase(it->second);
+		by_size.erase(it);
+	}
+
+	OffsetIterator eraseByOffset(OffsetIterator it) {
+		auto [first, last] = by_size.equal_range(it->second);
+
+		for (; first != last; ++first) {
+			if (first->second == it->first) {
+				by_size.erase(first);
+				break;
+			}
+		}
+
+		return ranges.erase(it);
+	}
+
+	uint64_t total;
+	uint64_t free_total;
+
+	std::map<uint64_t, uint64_t> ranges;       // NOTE: Offset to size
+	std::multimap<uint64_t, uint64_t> by_size; // NOTE: Size to offset
+};
+
+} // namespace veekay
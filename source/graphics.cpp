@@ -1,25 +1,114 @@
 #include <veekay/graphics.hpp>
 
 #include <stdexcept>
-#include <limits>
 #include <algorithm>
 #include <cmath>
+#include <numeric>
+#include <vector>
 
 #include <veekay/application.hpp>
 #include <vulkan/vulkan_core.h>
 
 namespace veekay::graphics {
 
+void initAllocator();
+void shutdownAllocator();
+void shutdownStaging();
+void shutdownUploads();
+void shutdownMips();
+void shutdownMeshes();
+bool computesMips(VkFormat format);
+uint32_t maxComputedMipLevels();
+
 namespace {
 
 	size_t min_uniform_buffer_offset_alignment;
 
+	// NOTE: Full chain of any size when compute shader can build it,
+	//       otherwise only power of two ones are blitted down, see blitMips
+	uint32_t generatedMipLevels(uint32_t width, uint32_t height, VkFormat format) {
+		const uint32_t full_chain = uint32_t(std::floor(std::log2(std::max(width, height)))) + 1;
+
+		if (computesMips(format) && full_chain <= maxComputedMipLevels()) {
+			return full_chain;
+		}
+
+		if (formatBlock(format).width != 1) {
+			return 1;
+		}
+
+		if ((width & (width - 1)) != 0 || (height & (height - 1)) != 0) {
+			return 1;
+		}
+
+		return full_chain;
+	}
+
+	VkFormat sampledFormat(VkFormat format) {
+		if (!isFormatSampled(format)) {
+			throw std::runtime_error("Texture format is not supported by Vulkan device");
+		}
+
+		return format;
+	}
+
 } // namespace
 
+// NOTE: Stages and accesses that may read a buffer of given usage
+void bufferConsumers(VkBufferUsageFlags usage,
+                     VkPipelineStageFlags& stages, VkAccessFlags& access) {
+	stages = 0;
+	access = 0;
+
+	if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) {
+		stages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+		access |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	}
+
+	if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+		stages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+		access |= VK_ACCESS_INDEX_READ_BIT;
+	}
+
+	if (usage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT) {
+		stages |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+		access |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	}
+
+	if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+		stages |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+		          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+		          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		access |= VK_ACCESS_UNIFORM_READ_BIT;
+	}
+
+	if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+		stages |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+		          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+		          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		access |= VK_ACCESS_SHADER_READ_BIT;
+	}
+
+	if (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) {
+		stages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+		access |= VK_ACCESS_TRANSFER_READ_BIT;
+	}
+
+	if (stages == 0) {
+		stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		access = VK_ACCESS_MEMORY_READ_BIT;
+	}
+}
+
 Buffer::Buffer(size_t size, const void* data,
-               VkBufferUsageFlags usage) {
+               VkBufferUsageFlags usage,
+               BufferPlacement placement)
+: placement{placement} {
 	VkDevice& device = veekay::app.vk_device;
-	VkPhysicalDevice& physical_device = veekay::app.vk_physical_device;
+
+	if (placement == BufferPlacement::device && data != nullptr) {
+		throw std::runtime_error("Device local Vulkan buffer must be filled through a command buffer");
+	}
 
 	{
 		VkBufferCreateInfo info{
@@ -38,45 +127,34 @@ Buffer::Buffer(size_t size, const void* data,
 		VkMemoryRequirements requirements;
 		vkGetBufferMemoryRequirements(device, buffer, &requirements);
 
-		VkPhysicalDeviceMemoryProperties properties;
-		vkGetPhysicalDeviceMemoryProperties(physical_device, &properties);
-
-		const VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-		                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		VkMemoryPropertyFlags flags;
+		VkMemoryPropertyFlags preferred = 0;
 
-		uint32_t index = std::numeric_limits<uint32_t>::max();
-		for (uint32_t i = 0; i < properties.memoryTypeCount; ++i) {
-			const VkMemoryType& type = properties.memoryTypes[i];
+		switch (placement) {
+			case BufferPlacement::device:
+				flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+				break;
 
-			if ((requirements.memoryTypeBits & (1 << i)) &&
-			    (type.propertyFlags & flags) == flags) {
-				index = i;
+			case BufferPlacement::upload:
+				flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+				        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 				break;
-			}
-		}
 
-		if (index == std::numeric_limits<uint32_t>::max()) {
-			throw std::runtime_error("Failed to find required memory type to allocate Vulkan buffer");
+			case BufferPlacement::readback:
+				// NOTE: Uncached reads are painfully slow, coherency spares us invalidating ranges
+				flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+				        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+				preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+				break;
 		}
 
-		VkMemoryAllocateInfo info{
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-			.allocationSize = requirements.size,
-			.memoryTypeIndex = index,
-		};
+		allocation = allocateMemory(requirements, flags, true, preferred);
+		mapped_region = placement == BufferPlacement::device ? nullptr : allocation.mapped;
 
-		if (vkAllocateMemory(device, &info, nullptr, &memory) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to allocate Vulkan buffer memory");
-		}
-
-		if (vkBindBufferMemory(device, buffer, memory, 0) != VK_SUCCESS) {
+		if (vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
 			throw std::runtime_error("Failed to bind Vulkan buffer memory");
 		}
 
-		if (vkMapMemory(device, memory, 0, requirements.size, 0, &mapped_region) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to map Vulkan buffer memory");
-		}
-
 		if (data != nullptr) {
 			std::copy(static_cast<const char*>(data),
 			          static_cast<const char*>(data) + size,
@@ -85,11 +163,50 @@ Buffer::Buffer(size_t size, const void* data,
 	}
 }
 
+Buffer::Buffer(VkCommandBuffer cmd, size_t size, const void* data,
+               VkBufferUsageFlags usage)
+: Buffer(size, nullptr, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, BufferPlacement::device) {
+	StagingAllocation staging = allocateStaging(size);
+
+	if (data != nullptr) {
+		std::copy(static_cast<const char*>(data),
+		          static_cast<const char*>(data) + size,
+		          static_cast<char*>(staging.mapped));
+	}
+
+	VkBufferCopy region{
+		.srcOffset = staging.offset,
+		.dstOffset = 0,
+		.size = size,
+	};
+
+	vkCmdCopyBuffer(cmd, staging.buffer, buffer, 1, &region);
+
+	VkPipelineStageFlags stages;
+	VkAccessFlags access;
+	bufferConsumers(usage, stages, access);
+
+	VkBufferMemoryBarrier barrier{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = access,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.buffer = buffer,
+		.offset = 0,
+		.size = VK_WHOLE_SIZE,
+	};
+
+	vkCmdPipelineBarrier(cmd,
+	                     VK_PIPELINE_STAGE_TRANSFER_BIT, stages,
+	                     0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
 Buffer::~Buffer() {
 	VkDevice& device = veekay::app.vk_device;
 
-	vkFreeMemory(device, memory, nullptr);
 	vkDestroyBuffer(device, buffer, nullptr);
+	freeMemory(allocation);
 }
 
 size_t Buffer::structureAlignment(size_t struct_size) {
@@ -99,175 +216,188 @@ size_t Buffer::structureAlignment(size_t struct_size) {
 	                     : struct_size;
 }
 
-Texture::Texture(VkCommandBuffer cmd,
-                 uint32_t width, uint32_t height,
-                 VkFormat format,
-                 const void* pixels)
-: width{width}, height{height}, format{format} {
-	VkDevice& device = veekay::app.vk_device;
-	VkPhysicalDevice& physical_device = veekay::app.vk_physical_device;
+FormatBlock formatBlock(VkFormat format) {
+	if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK) {
+		// NOTE: Footprints in enum order, each one has UNORM and SRGB variant
+		constexpr uint32_t footprints[][2] = {
+			{4, 4}, {5, 4}, {5, 5}, {6, 5}, {6, 6}, {8, 5}, {8, 6},
+			{8, 8}, {10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10}, {12, 12},
+		};
 
-	uint32_t mips = 1;
+		const uint32_t* footprint = footprints[(format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2];
 
-	if ((width & (width - 1)) == 0 && (height & (height - 1)) == 0) {
-		mips = uint32_t(std::floor(std::log2(std::max(width, height)))) + 1;
+		return {footprint[0], footprint[1], 16};
 	}
 
-	{
-		VkImageCreateInfo info{
-			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-			.imageType = VK_IMAGE_TYPE_2D,
-			.format = format,
-			.extent = {
-				.width = width,
-				.height = height,
-				.depth = 1,
-			},
-			.mipLevels = mips,
-			.arrayLayers = 1,
-			.samples = VK_SAMPLE_COUNT_1_BIT,
-			.tiling = VK_IMAGE_TILING_OPTIMAL,
-			.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | 
-			         VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-			         VK_IMAGE_USAGE_SAMPLED_BIT,
-			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-		};
-
-		if (vkCreateImage(device, &info, nullptr, &image) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to create Vulkan image");
-		}
-	}
+	switch (format) {
+		case VK_FORMAT_R32G32B32A32_SFLOAT:
+			return {1, 1, 16};
 
-	{
-		VkMemoryRequirements requirements;
-		vkGetImageMemoryRequirements(device, image, &requirements);
+		case VK_FORMAT_R32G32B32_SFLOAT:
+			return {1, 1, 12};
 
-		VkPhysicalDeviceMemoryProperties properties;
-		vkGetPhysicalDeviceMemoryProperties(physical_device, &properties);
+		case VK_FORMAT_R32G32_SFLOAT:
+		case VK_FORMAT_R16G16B16A16_SFLOAT:
+			return {1, 1, 8};
 
-		const VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		case VK_FORMAT_R32_SFLOAT:
+		case VK_FORMAT_R16G16_SFLOAT:
+		case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+		case VK_FORMAT_B8G8R8A8_UNORM:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+			return {1, 1, 4};
+
+		case VK_FORMAT_R16_SFLOAT:
+		case VK_FORMAT_R8G8_UNORM:
+			return {1, 1, 2};
+
+		case VK_FORMAT_R8_UNORM:
+			return {1, 1, 1};
+
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+		case VK_FORMAT_BC4_SNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+		case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+		case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+			return {4, 4, 8};
+
+		case VK_FORMAT_BC2_UNORM_BLOCK:
+		case VK_FORMAT_BC2_SRGB_BLOCK:
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC5_SNORM_BLOCK:
+		case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+		case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+		case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+		case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+			return {4, 4, 16};
 
-		uint32_t index = std::numeric_limits<uint32_t>::max();
-		for (uint32_t i = 0; i < properties.memoryTypeCount; ++i) {
-			const VkMemoryType& type = properties.memoryTypes[i];
+		default:
+			return {1, 1, 0};
+	}
+}
 
-			if ((requirements.memoryTypeBits & (1 << i)) &&
-			    (type.propertyFlags & flags) == flags) {
-				index = i;
-				break;
-			}
-		}
+size_t textureLevelSize(VkFormat format, uint32_t width, uint32_t height, uint32_t level) {
+	const FormatBlock block = formatBlock(format);
 
-		if (index == std::numeric_limits<uint32_t>::max()) {
-			throw std::runtime_error("Failed to find required memory type to allocate Vulkan buffer");
-		}
+	const size_t level_width = std::max(width >> level, 1u);
+	const size_t level_height = std::max(height >> level, 1u);
 
-		VkMemoryAllocateInfo info{
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-			.allocationSize = requirements.size,
-			.memoryTypeIndex = index,
-		};
+	return (level_width + block.width - 1) / block.width *
+	       ((level_height + block.height - 1) / block.height) * block.bytes;
+}
 
-		if (vkAllocateMemory(device, &info, nullptr, &memory) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to allocate Vulkan image memory");
-		}
+bool isFormatSampled(VkFormat format) {
+	// NOTE: Compressed families are unusable without their device feature,
+	//       even when format properties claim otherwise
+	if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK &&
+	    !veekay::app.texture_compression_bc) {
+		return false;
+	}
 
-		if (vkBindImageMemory(device, image, memory, 0) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to bind Vulkan image memory");
-		}
+	if (format >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && format <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK &&
+	    !veekay::app.texture_compression_etc2) {
+		return false;
 	}
 
-	VkImageSubresourceRange range{
-		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-		.baseMipLevel = 0,
-		.levelCount = mips,
-		.baseArrayLayer = 0,
-		.layerCount = 1,
-	};
+	if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK &&
+	    !veekay::app.texture_compression_astc) {
+		return false;
+	}
 
-	{
-		VkImageViewCreateInfo info{
-			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-			.image = image,
-			.viewType = VK_IMAGE_VIEW_TYPE_2D,
-			.format = format,
-			.subresourceRange = range,
-		};
+	VkFormatProperties props;
+	vkGetPhysicalDeviceFormatProperties(veekay::app.vk_physical_device, format, &props);
 
-		if (vkCreateImageView(device, &info, nullptr, &view) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to create Vulkan image view");
-		}
-	}
+	const VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+	                                    VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
 
-	uint32_t bytes_per_pixel;
-	switch (format) {
-		case VK_FORMAT_R32G32B32A32_SFLOAT:
-			bytes_per_pixel = 16;
-			break;
+	return (props.optimalTilingFeatures & needed) == needed;
+}
 
-		case VK_FORMAT_R32G32B32_SFLOAT:
-			bytes_per_pixel = 12;
-			break;
+// NOTE: Copy offsets must be a multiple of texel block size
+VkDeviceSize levelAlignment(VkFormat format) {
+	return std::lcm(VkDeviceSize(16), VkDeviceSize(std::max(formatBlock(format).bytes, 1u)));
+}
 
-		case VK_FORMAT_R32G32_SFLOAT:
-			bytes_per_pixel = 8;
-			break;
+// NOTE: Bytes of staging memory taking first level_count levels, see copyLevels
+VkDeviceSize stagedLevelsSize(const Texture& texture, uint32_t level_count) {
+	const VkDeviceSize alignment = levelAlignment(texture.format);
 
-		case VK_FORMAT_R32_SFLOAT:
-		case VK_FORMAT_B8G8R8A8_UNORM:
-		case VK_FORMAT_R8G8B8A8_UNORM:
-			bytes_per_pixel = 4;
-			break;
+	VkDeviceSize size = 0;
 
-		default:
-			bytes_per_pixel = 0;
-			break;
+	for (uint32_t i = 0; i < level_count; ++i) {
+		size = (size + alignment - 1) / alignment * alignment;
+		size += textureLevelSize(texture.format, texture.width, texture.height, i);
 	}
 
-	staging = new Buffer(width * height * bytes_per_pixel,
-	                     pixels,
-	                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	return size;
+}
 
-	VkImageMemoryBarrier undef_to_dst{
-		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-		.srcAccessMask = 0,
-		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-		.image = image,
-		.subresourceRange = range,
-	};
+// NOTE: Packs first level_count levels into staging memory mapped at offset of buffer
+//       and copies all of them with one command. Expects them in TRANSFER_DST layout
+void copyLevels(VkCommandBuffer cmd, const Texture& texture,
+                uint32_t level_count, const void* const* levels,
+                VkBuffer buffer, VkDeviceSize offset, void* mapped) {
+	const VkDeviceSize alignment = levelAlignment(texture.format);
 
-	vkCmdPipelineBarrier(cmd,
-	                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-	                     VK_PIPELINE_STAGE_TRANSFER_BIT,
-	                     0,
-	                     0, nullptr,
-	                     0, nullptr,
-	                     1, &undef_to_dst);
+	std::vector<VkBufferImageCopy> regions(level_count);
 
-	VkBufferImageCopy copy_info{
-		.bufferOffset = 0,
-		.bufferRowLength = 0,
-		.bufferImageHeight = 0,
+	VkDeviceSize level_offset = 0;
 
-		.imageSubresource = {
-			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-			.mipLevel = 0,
-			.baseArrayLayer = 0,
-			.layerCount = 1,
-		},
+	for (uint32_t i = 0; i < level_count; ++i) {
+		const size_t size = textureLevelSize(texture.format, texture.width, texture.height, i);
 
-		.imageOffset = {0, 0, 0},
-		.imageExtent = {width, height, 1},
-	};
+		level_offset = (level_offset + alignment - 1) / alignment * alignment;
 
-	vkCmdCopyBufferToImage(cmd, staging->buffer, image,
+		std::copy(static_cast<const char*>(levels[i]),
+		          static_cast<const char*>(levels[i]) + size,
+		          static_cast<char*>(mapped) + level_offset);
+
+		regions[i] = VkBufferImageCopy{
+			.bufferOffset = offset + level_offset,
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = i,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+			.imageOffset = {0, 0, 0},
+			.imageExtent = {
+				std::max(texture.width >> i, 1u),
+				std::max(texture.height >> i, 1u),
+				1,
+			},
+		};
+
+		level_offset += size;
+	}
+
+	vkCmdCopyBufferToImage(cmd, buffer, texture.image,
 	                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-	                       1, &copy_info);
+	                       uint32_t(regions.size()), regions.data());
+}
+
+// NOTE: Expects every mip level in TRANSFER_DST layout with level 0 filled,
+//       leaves all of them SHADER_READ_ONLY. Fallback of generateMips
+void blitMips(VkCommandBuffer cmd, const Texture& texture) {
+	const VkImage image = texture.image;
+	const uint32_t mips = texture.mip_levels;
 
 	VkImageMemoryBarrier dst_to_src_to_sample{
 		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
@@ -282,8 +412,8 @@ Texture::Texture(VkCommandBuffer cmd,
 		},
 	};
 
-	int32_t mip_width = width;
-	int32_t mip_height = height;
+	int32_t mip_width = texture.width;
+	int32_t mip_height = texture.height;
 
 	for (uint32_t i = 1; i < mips; ++i) {
 		dst_to_src_to_sample.subresourceRange.baseMipLevel = i - 1;
@@ -357,14 +487,206 @@ Texture::Texture(VkCommandBuffer cmd,
 	                     1, &dst_to_src_to_sample);
 }
 
-Texture::~Texture() {
+// NOTE: Mip shader writes levels through UNORM storage views
+Texture::Texture(uint32_t width, uint32_t height, VkFormat format)
+: Texture(width, height, format, generatedMipLevels(width, height, format),
+          computesMips(format)) {}
+
+Texture::Texture(uint32_t width, uint32_t height, VkFormat format, uint32_t mip_levels)
+: Texture(width, height, format, mip_levels, false) {}
+
+Texture::Texture(uint32_t width, uint32_t height, VkFormat format,
+                 uint32_t mip_levels, bool generates_mips)
+: width{width}, height{height}, format{format}, mip_levels{mip_levels},
+  storage{generates_mips && mip_levels > 1} {
 	VkDevice& device = veekay::app.vk_device;
 
-	delete staging;
+	{
+		VkImageCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.flags = storage ? VkImageCreateFlags(VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT |
+			                                      VK_IMAGE_CREATE_EXTENDED_USAGE_BIT)
+			                 : 0,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = format,
+			.extent = {
+				.width = width,
+				.height = height,
+				.depth = 1,
+			},
+			.mipLevels = mip_levels,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = VkImageUsageFlags(VK_IMAGE_USAGE_TRANSFER_SRC_BIT | 
+			                           VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+			                           VK_IMAGE_USAGE_SAMPLED_BIT |
+			                           (storage ? VK_IMAGE_USAGE_STORAGE_BIT : 0)),
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		};
+
+		if (vkCreateImage(device, &info, nullptr, &image) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Vulkan image");
+		}
+	}
+
+	{
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(device, image, &requirements);
+
+		allocation = allocateMemory(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
+
+		if (vkBindImageMemory(device, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to bind Vulkan image memory");
+		}
+	}
+
+	VkImageSubresourceRange range{
+		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+		.baseMipLevel = 0,
+		.levelCount = mip_levels,
+		.baseArrayLayer = 0,
+		.layerCount = 1,
+	};
+
+	{
+		// NOTE: sRGB and BGRA formats can't be storage images, so this view is sampled only
+		VkImageViewUsageCreateInfo usage{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_USAGE_CREATE_INFO,
+			.usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+		};
+
+		VkImageViewCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.pNext = storage ? &usage : nullptr,
+			.image = image,
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = format,
+			.subresourceRange = range,
+		};
+
+		if (vkCreateImageView(device, &info, nullptr, &view) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Vulkan image view");
+		}
+	}
+}
+
+Texture::Texture(VkCommandBuffer cmd,
+                 uint32_t width, uint32_t height,
+                 VkFormat format,
+                 const void* pixels)
+: Texture(width, height, format) {
+	const size_t size = textureLevelSize(format, width, height, 0);
+
+	StagingAllocation staging = allocateStaging(size, levelAlignment(format));
+
+	if (pixels != nullptr) {
+		std::copy(static_cast<const char*>(pixels),
+		          static_cast<const char*>(pixels) + size,
+		          static_cast<char*>(staging.mapped));
+	}
+
+	VkImageMemoryBarrier undef_to_dst{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask = 0,
+		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image,
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = mip_levels,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+
+	vkCmdPipelineBarrier(cmd,
+	                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+	                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+	                     0,
+	                     0, nullptr,
+	                     0, nullptr,
+	                     1, &undef_to_dst);
+
+	VkBufferImageCopy copy_info{
+		.bufferOffset = staging.offset,
+		.bufferRowLength = 0,
+		.bufferImageHeight = 0,
+
+		.imageSubresource = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.mipLevel = 0,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+
+		.imageOffset = {0, 0, 0},
+		.imageExtent = {width, height, 1},
+	};
+
+	vkCmdCopyBufferToImage(cmd, staging.buffer, image,
+	                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+	                       1, &copy_info);
+
+	const Texture* self = this;
+	generateMips(cmd, &self, 1);
+}
+
+Texture::Texture(VkCommandBuffer cmd,
+                 uint32_t width, uint32_t height,
+                 VkFormat format, uint32_t mip_levels,
+                 const void* const* levels)
+: Texture(width, height, sampledFormat(format), mip_levels) {
+	StagingAllocation staging = allocateStaging(stagedLevelsSize(*this, mip_levels), levelAlignment(format));
+
+	VkImageMemoryBarrier barrier{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask = 0,
+		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image,
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = mip_levels,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+
+	vkCmdPipelineBarrier(cmd,
+	                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+	                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+	                     0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	copyLevels(cmd, *this, mip_levels, levels, staging.buffer, staging.offset, staging.mapped);
+
+	// NOTE: Nothing left to generate, every level goes to shaders at once
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	vkCmdPipelineBarrier(cmd,
+	                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+	                     VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+	                     0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+Texture::~Texture() {
+	VkDevice& device = veekay::app.vk_device;
 
-	vkFreeMemory(device, memory, nullptr);
 	vkDestroyImageView(device, view, nullptr);
 	vkDestroyImage(device, image, nullptr);
+	freeMemory(allocation);
 }
 
 void init() {
@@ -375,6 +697,16 @@ void init() {
 	vkGetPhysicalDeviceProperties(physical_device, &props);
 
 	min_uniform_buffer_offset_alignment = props.limits.minUniformBufferOffsetAlignment;
+
+	initAllocator();
+}
+
+void shutdown() {
+	shutdownUploads();
+	shutdownStaging();
+	shutdownMips();
+	shutdownMeshes();
+	shutdownAllocator();
 }
 
 } // namespace veekay::graphics
@@ -0,0 +1,281 @@
+#include <veekay/image_loader.hpp>
+
+#include <mutex>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+
+#include <veekay/types.hpp>
+#include <veekay/jobs.hpp>
+#include <veekay/mapped_file.hpp>
+
+namespace veekay::graphics {
+
+void processUploads();
+
+namespace {
+
+	using clock = std::chrono::steady_clock;
+
+	double millisecondsSince(clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+	}
+
+	bool isBgra(VkFormat format) {
+		return format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+	}
+
+	bool isConvertible(VkFormat format) {
+		switch (format) {
+			case VK_FORMAT_R8G8B8A8_UNORM:
+			case VK_FORMAT_R8G8B8A8_SRGB:
+			case VK_FORMAT_B8G8R8A8_UNORM:
+			case VK_FORMAT_B8G8R8A8_SRGB:
+				return true;
+
+			default:
+				return false;
+		}
+	}
+
+	// NOTE: Rounded c * a / 255
+	uint8_t multiply(uint32_t c, uint32_t a) {
+		const uint32_t t = c * a + 128;
+		return uint8_t((t + (t >> 8)) >> 8);
+	}
+
+	void convertScalar(const uint8_t* source, uint8_t* destination, size_t pixel_count,
+	                   bool swizzle, bool premultiply) {
+		for (size_t i = 0; i < pixel_count; ++i) {
+			const uint8_t* in = source + i * 4;
+			uint8_t* out = destination + i * 4;
+
+			uint8_t r = in[0];
+			uint8_t g = in[1];
+			uint8_t b = in[2];
+			const uint8_t a = in[3];
+
+			if (premultiply) {
+				r = multiply(r, a);
+				g = multiply(g, a);
+				b = multiply(b, a);
+			}
+
+			out[0] = swizzle ? b : r;
+			out[1] = g;
+			out[2] = swizzle ? r : b;
+			out[3] = a;
+		}
+	}
+
+#if defined(VEEKAY_SIMD_SSE)
+	// NOTE: 4 pixels at a time with SSE2
+	size_t convertSimd(const uint8_t* source, uint8_t* destination, size_t pixel_count,
+	                   bool swizzle, bool premultiply) {
+		const __m128i green_alpha = _mm_set1_epi32(int32_t(0xff00ff00));
+		const __m128i color_lanes = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+		const __m128i alpha_one = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+		const __m128i half = _mm_set1_epi16(128);
+		const __m128i zero = _mm_setzero_si128();
+
+		// NOTE: Alpha lane is multiplied by 255 and stays as is
+		auto premultiplied = [&](__m128i color) {
+			__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(color, 0xff), 0xff);
+			alpha = _mm_or_si128(_mm_and_si128(alpha, color_lanes), alpha_one);
+
+			const __m128i t = _mm_add_epi16(_mm_mullo_epi16(color, alpha), half);
+			return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+		};
+
+		size_t i = 0;
+
+		for (; i + 4 <= pixel_count; i += 4) {
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+
+			if (swizzle) {
+				const __m128i red_blue = _mm_andnot_si128(green_alpha, pixels);
+				pixels = _mm_or_si128(_mm_and_si128(pixels, green_alpha),
+				                      _mm_or_si128(_mm_slli_epi32(red_blue, 16),
+				                                   _mm_srli_epi32(red_blue, 16)));
+			}
+
+			if (premultiply) {
+				pixels = _mm_packus_epi16(premultiplied(_mm_unpacklo_epi8(pixels, zero)),
+				                          premultiplied(_mm_unpackhi_epi8(pixels, zero)));
+			}
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), pixels);
+		}
+
+		return i;
+	}
+#elif defined(VEEKAY_SIMD_NEON)
+	// NOTE: 16 pixels at a time, channels are deinterleaved by loads and stores
+	size_t convertSimd(const uint8_t* source, uint8_t* destination, size_t pixel_count,
+	                   bool swizzle, bool premultiply) {
+		auto premultiplied = [](uint8x16_t color, uint8x16_t alpha) {
+			const uint16x8_t low = vmull_u8(vget_low_u8(color), vget_low_u8(alpha));
+			const uint16x8_t high = vmull_u8(vget_high_u8(color), vget_high_u8(alpha));
+
+			return vcombine_u8(vraddhn_u16(low, vrshrq_n_u16(low, 8)),
+			                   vraddhn_u16(high, vrshrq_n_u16(high, 8)));
+		};
+
+		size_t i = 0;
+
+		for (; i + 16 <= pixel_count; i += 16) {
+			uint8x16x4_t pixels = vld4q_u8(source + i * 4);
+
+			if (premultiply) {
+				pixels.val[0] = premultiplied(pixels.val[0], pixels.val[3]);
+				pixels.val[1] = premultiplied(pixels.val[1], pixels.val[3]);
+				pixels.val[2] = premultiplied(pixels.val[2], pixels.val[3]);
+			}
+
+			if (swizzle) {
+				const uint8x16_t red = pixels.val[0];
+				pixels.val[0] = pixels.val[2];
+				pixels.val[2] = red;
+			}
+
+			vst4q_u8(destination + i * 4, pixels);
+		}
+
+		return i;
+	}
+#else
+	size_t convertSimd(const uint8_t*, uint8_t*, size_t, bool, bool) {
+		return 0;
+	}
+#endif
+
+} // namespace
+
+void convertPixels(const uint8_t* source, void* destination, size_t pixel_count,
+                   VkFormat format, bool premultiply) {
+	uint8_t* out = static_cast<uint8_t*>(destination);
+
+	const bool swizzle = isBgra(format);
+
+	if (!swizzle && !premultiply) {
+		std::memcpy(out, source, pixel_count * 4);
+		return;
+	}
+
+	const size_t done = convertSimd(source, out, pixel_count, swizzle, premultiply);
+	convertScalar(source + done * 4, out + done * 4, pixel_count - done, swizzle, premultiply);
+}
+
+std::vector<ImageLoadResult> loadImages(const ImageLoadRequest* requests, size_t count,
+                                        const ImageDecodeFunc& decode) {
+	std::vector<ImageLoadResult> results(count);
+	std::vector<UploadHandle> handles(count);
+	std::vector<clock::time_point> upload_starts(count);
+
+	// NOTE: Files whose uploads job threads have queued, main thread submits them
+	std::mutex finished_mutex;
+	std::vector<size_t> finished;
+
+	// NOTE: One file per job, they differ in size too much for bigger grains
+	jobs::Handle job = jobs::parallelFor(count, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			const ImageLoadRequest& request = requests[i];
+			ImageLoadResult& result = results[i];
+
+			try {
+				if (!isConvertible(request.format)) {
+					throw std::runtime_error("unsupported target format");
+				}
+
+				auto start = clock::now();
+
+				DecodedImage image{};
+
+				{
+					MappedFile file(request.path);
+
+					if (!decode(file.data(), file.size(), image)) {
+						throw std::runtime_error("failed to decode");
+					}
+				}
+
+				if (image.width == 0 || image.height == 0 ||
+				    image.pixels.size() != size_t(image.width) * image.height * 4) {
+					throw std::runtime_error("decoder returned inconsistent size");
+				}
+
+				result.width = image.width;
+				result.height = image.height;
+				result.decode_time = millisecondsSince(start);
+
+				start = clock::now();
+
+				StagingBlock staging = createUploadStaging(image.width, image.height, request.format);
+				convertPixels(image.pixels.data(), staging.allocation.mapped,
+				              size_t(image.width) * image.height, request.format, request.premultiply);
+
+				result.convert_time = millisecondsSince(start);
+
+				result.texture = uploadTexture(image.width, image.height, request.format,
+				                               staging, handles[i]);
+
+				std::lock_guard lock(finished_mutex);
+				finished.push_back(i);
+			} catch (const std::exception& error) {
+				result.error = std::string(request.path) + ": " + error.what();
+			}
+		}
+	});
+
+	// NOTE: Main thread submits uploads as files finish and helps with jobs
+	//       in between, so transfers overlap with decoding of later files
+	std::vector<size_t> queued;
+	std::vector<size_t> in_flight;
+
+	for (;;) {
+		const bool decoded = jobs::isDone(job);
+
+		{
+			std::lock_guard lock(finished_mutex);
+			queued.swap(finished);
+		}
+
+		if (!queued.empty()) {
+			processUploads();
+
+			const clock::time_point now = clock::now();
+
+			for (size_t i : queued) {
+				upload_starts[i] = now;
+				in_flight.push_back(i);
+			}
+
+			queued.clear();
+		}
+
+		std::erase_if(in_flight, [&](size_t i) {
+			if (!handles[i].ready()) {
+				return false;
+			}
+
+			results[i].upload_time = millisecondsSince(upload_starts[i]);
+			return true;
+		});
+
+		if (decoded) {
+			break;
+		}
+
+		jobs::help();
+	}
+
+	for (size_t i : in_flight) {
+		handles[i].wait();
+		results[i].upload_time = millisecondsSince(upload_starts[i]);
+	}
+
+	return results;
+}
+
+} // namespace veekay::graphics
@@ -0,0 +1,407 @@
+#include <veekay/jobs.hpp>
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <condition_variable>
+
+namespace veekay::jobs {
+
+namespace {
+
+	// NOTE: Job slots are allocated in chunks that never move,
+	//       so a slot can be looked up without taking a lock
+	constexpr uint32_t chunk_bits = 10;
+	constexpr uint32_t chunk_size = 1u << chunk_bits;
+	constexpr uint32_t max_chunks = 256;
+
+	constexpr uint32_t max_workers = 64;
+
+	struct Job {
+		JobFunc func;
+		bool background;
+
+		// NOTE: Bumped when job is done, handles with an older generation
+		//       are considered done. Zero is never used
+		std::atomic<uint32_t> generation;
+
+		// NOTE: Unfinished dependencies plus one held until submission completes
+		std::atomic<uint32_t> pending;
+
+		std::mutex mutex; // NOTE: Guards dependents and generation changes
+		std::vector<uint32_t> dependents;
+	};
+
+	// NOTE: Owner takes newest jobs from the back, while other
+	//       threads steal oldest (usually biggest) ones from the front
+	struct Queue {
+		std::mutex mutex;
+		std::deque<uint32_t> slots;
+	};
+
+	std::atomic<Job*> chunks[max_chunks];
+	uint32_t chunk_count;
+	std::vector<uint32_t> free_slots;
+	std::mutex pool_mutex;
+
+	// NOTE: Queue 0 belongs to main thread, which runs jobs only while waiting
+	uint32_t worker_count;
+	std::unique_ptr<Queue[]> queues;
+	Queue background_queue;
+	std::vector<std::thread> threads;
+
+	std::atomic<uint32_t> next_queue;
+	std::atomic<int64_t> queued;     // NOTE: Jobs sitting in any queue
+	std::atomic<int64_t> frame_jobs; // NOTE: Non-background jobs submitted and not done yet
+
+	std::mutex wake_mutex;
+	std::condition_variable wake;
+	bool stopping;
+
+	thread_local int32_t worker_index = -1;
+
+	Job& get(uint32_t slot) {
+		Job* chunk = chunks[slot >> chunk_bits].load(std::memory_order_acquire);
+		return chunk[slot & (chunk_size - 1)];
+	}
+
+	uint32_t allocateSlot() {
+		std::lock_guard lock(pool_mutex);
+
+		if (free_slots.empty()) {
+			if (chunk_count == max_chunks) {
+				throw std::runtime_error("Too many jobs in flight");
+			}
+
+			Job* chunk = new Job[chunk_size];
+
+			for (uint32_t i = 0; i < chunk_size; ++i) {
+				chunk[i].generation.store(1, std::memory_order_relaxed);
+			}
+
+			chunks[chunk_count].store(chunk, std::memory_order_release);
+
+			// NOTE: Reversed, so lower slots are handed out first
+			for (uint32_t i = chunk_size; i-- > 0;) {
+				free_slots.push_back(chunk_count * chunk_size + i);
+			}
+
+			++chunk_count;
+		}
+
+		const uint32_t slot = free_slots.back();
+		free_slots.pop_back();
+
+		return slot;
+	}
+
+	void freeSlot(uint32_t slot) {
+		std::lock_guard lock(pool_mutex);
+		free_slots.push_back(slot);
+	}
+
+	void push(uint32_t slot) {
+		Job& job = get(slot);
+
+		Queue& queue = job.background ? background_queue
+		             : worker_index >= 0 ? queues[worker_index]
+		             : queues[next_queue.fetch_add(1, std::memory_order_relaxed) % worker_count];
+
+		{
+			std::lock_guard lock(queue.mutex);
+			queue.slots.push_back(slot);
+		}
+
+		queued.fetch_add(1, std::memory_order_release);
+
+		// NOTE: Taking the lock orders this with a worker about to fall asleep
+		{
+			std::lock_guard lock(wake_mutex);
+		}
+
+		wake.notify_one();
+	}
+
+	bool popBack(Queue& queue, uint32_t& slot) {
+		std::lock_guard lock(queue.mutex);
+
+		if (queue.slots.empty()) {
+			return false;
+		}
+
+		slot = queue.slots.back();
+		queue.slots.pop_back();
+
+		return true;
+	}
+
+	bool popFront(Queue& queue, uint32_t& slot) {
+		std::lock_guard lock(queue.mutex);
+
+		if (queue.slots.empty()) {
+			return false;
+		}
+
+		slot = queue.slots.front();
+		queue.slots.pop_front();
+
+		return true;
+	}
+
+	bool take(bool background, uint32_t& slot) {
+		if (queued.load(std::memory_order_acquire) <= 0) {
+			return false;
+		}
+
+		bool found = worker_index >= 0 && popBack(queues[worker_index], slot);
+
+		for (uint32_t i = 1; !found && i <= worker_count; ++i) {
+			const uint32_t victim = (uint32_t(worker_index) + i) % worker_count;
+			found = popFront(queues[victim], slot);
+		}
+
+		if (!found && background) {
+			found = popFront(background_queue, slot);
+		}
+
+		if (found) {
+			queued.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		return found;
+	}
+
+	void execute(uint32_t slot) {
+		Job& job = get(slot);
+
+		if (job.func) {
+			job.func();
+		}
+
+		// NOTE: Release captured state right away, not when slot gets reused
+		job.func = nullptr;
+
+		std::vector<uint32_t> dependents;
+
+		{
+			std::lock_guard lock(job.mutex);
+
+			dependents.swap(job.dependents);
+
+			uint32_t generation = job.generation.load(std::memory_order_relaxed) + 1;
+			job.generation.store(generation != 0 ? generation : 1, std::memory_order_release);
+		}
+
+		for (uint32_t dependent : dependents) {
+			if (get(dependent).pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				push(dependent);
+			}
+		}
+
+		const bool background = job.background;
+
+		freeSlot(slot);
+
+		if (!background) {
+			frame_jobs.fetch_sub(1, std::memory_order_release);
+		}
+	}
+
+	Handle enqueue(JobFunc func, const Handle* dependencies,
+	               size_t dependency_count, bool background) {
+		const uint32_t slot = allocateSlot();
+		Job& job = get(slot);
+
+		job.func = std::move(func);
+		job.background = background;
+		job.pending.store(1, std::memory_order_relaxed);
+
+		const Handle handle{
+			.slot = slot,
+			.generation = job.generation.load(std::memory_order_relaxed),
+		};
+
+		if (!background) {
+			frame_jobs.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		for (size_t i = 0; i < dependency_count; ++i) {
+			const Handle& dependency = dependencies[i];
+
+			if (dependency.generation == 0) {
+				continue;
+			}
+
+			Job& other = get(dependency.slot);
+
+			std::lock_guard lock(other.mutex);
+
+			if (other.generation.load(std::memory_order_relaxed) == dependency.generation) {
+				other.dependents.push_back(slot);
+				job.pending.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		if (job.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			push(slot);
+		}
+
+		return handle;
+	}
+
+	void workerLoop(uint32_t index) {
+		worker_index = int32_t(index);
+
+		for (;;) {
+			uint32_t slot;
+
+			if (take(true, slot)) {
+				execute(slot);
+				continue;
+			}
+
+			std::unique_lock lock(wake_mutex);
+
+			// NOTE: Queues are drained before exiting, so background jobs still finish
+			if (stopping) {
+				return;
+			}
+
+			wake.wait(lock, [] {
+				return stopping || queued.load(std::memory_order_acquire) > 0;
+			});
+		}
+	}
+
+} // namespace
+
+Handle submit(JobFunc func, std::initializer_list<Handle> dependencies) {
+	return enqueue(std::move(func), dependencies.begin(), dependencies.size(), false);
+}
+
+Handle submitBackground(JobFunc func, std::initializer_list<Handle> dependencies) {
+	return enqueue(std::move(func), dependencies.begin(), dependencies.size(), true);
+}
+
+Handle parallelFor(size_t count, size_t grain, RangeFunc func,
+                   std::initializer_list<Handle> dependencies) {
+	grain = std::max(grain, size_t(1));
+
+	// NOTE: Several ranges per worker even out uneven per-item cost
+	const size_t range_count = std::min((count + grain - 1) / grain, size_t(worker_count) * 4);
+
+	if (range_count <= 1) {
+		return enqueue([func = std::move(func), count] { func(0, count); },
+		               dependencies.begin(), dependencies.size(), false);
+	}
+
+	auto shared = std::make_shared<RangeFunc>(std::move(func));
+
+	std::vector<Handle> ranges(range_count);
+
+	for (size_t i = 0; i < range_count; ++i) {
+		const size_t begin = count * i / range_count;
+		const size_t end = count * (i + 1) / range_count;
+
+		ranges[i] = enqueue([shared, begin, end] { (*shared)(begin, end); },
+		                    dependencies.begin(), dependencies.size(), false);
+	}
+
+	// NOTE: Empty job that is done once every range is
+	return enqueue(nullptr, ranges.data(), ranges.size(), false);
+}
+
+bool isDone(Handle handle) {
+	if (handle.generation == 0) {
+		return true;
+	}
+
+	Job* chunk = chunks[handle.slot >> chunk_bits].load(std::memory_order_acquire);
+
+	// NOTE: Slots are gone after shutdown, every job has finished by then
+	if (!chunk) {
+		return true;
+	}
+
+	return chunk[handle.slot & (chunk_size - 1)].generation.load(std::memory_order_acquire) != handle.generation;
+}
+
+// NOTE: Threads outside of the pool only yield, so a job never
+//       ends up on a thread that has no per-worker resources
+void help() {
+	uint32_t slot;
+
+	if (worker_index >= 0 && take(false, slot)) {
+		execute(slot);
+	} else {
+		std::this_thread::yield();
+	}
+}
+
+void wait(Handle handle) {
+	while (!isDone(handle)) {
+		help();
+	}
+}
+
+void waitFrame() {
+	while (frame_jobs.load(std::memory_order_acquire) > 0) {
+		help();
+	}
+}
+
+uint32_t workerCount() {
+	return worker_count;
+}
+
+// NOTE: Index of calling thread in the pool, 0 for main thread, -1 for foreign ones
+int32_t currentWorker() {
+	return worker_index;
+}
+
+void init() {
+	// NOTE: At least one worker, otherwise background jobs would never run
+	const uint32_t thread_count = std::clamp(std::thread::hardware_concurrency(), 2u, max_workers) - 1;
+
+	worker_count = thread_count + 1;
+	queues = std::make_unique<Queue[]>(worker_count);
+
+	worker_index = 0;
+	stopping = false;
+
+	for (uint32_t i = 1; i <= thread_count; ++i) {
+		threads.emplace_back(workerLoop, i);
+	}
+}
+
+void shutdown() {
+	waitFrame();
+
+	{
+		std::lock_guard lock(wake_mutex);
+		stopping = true;
+	}
+
+	wake.notify_all();
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	threads.clear();
+	queues.reset();
+
+	for (uint32_t i = 0; i < chunk_count; ++i) {
+		delete[] chunks[i].exchange(nullptr);
+	}
+
+	chunk_count = 0;
+	free_slots.clear();
+}
+
+} // namespace veekay::jobs
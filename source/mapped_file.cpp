@@ -0,0 +1,156 @@
+#include <veekay/mapped_file.hpp>
+
+#include <string>
+#include <utility>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace veekay {
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(const char* path) {
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	                   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		throw std::runtime_error(std::string("Failed to open file ") + path);
+	}
+
+	LARGE_INTEGER file_size;
+
+	if (!GetFileSizeEx(file, &file_size)) {
+		close();
+		throw std::runtime_error(std::string("Failed to get size of file ") + path);
+	}
+
+	length = size_t(file_size.QuadPart);
+
+	// NOTE: Empty files can't be mapped, they are just empty
+	if (length == 0) {
+		return;
+	}
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	bytes = mapping ? static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0))
+	                : nullptr;
+
+	if (!bytes) {
+		close();
+		throw std::runtime_error(std::string("Failed to map file ") + path);
+	}
+}
+
+void MappedFile::close() {
+	if (bytes) {
+		UnmapViewOfFile(bytes);
+	}
+
+	if (mapping) {
+		CloseHandle(mapping);
+	}
+
+	if (file) {
+		CloseHandle(file);
+	}
+
+	bytes = nullptr;
+	mapping = nullptr;
+	file = nullptr;
+	length = 0;
+}
+
+#else
+
+MappedFile::MappedFile(const char* path) {
+	const int descriptor = open(path, O_RDONLY);
+
+	if (descriptor < 0) {
+		throw std::runtime_error(std::string("Failed to open file ") + path);
+	}
+
+	struct stat info;
+
+	if (fstat(descriptor, &info) != 0) {
+		::close(descriptor);
+		throw std::runtime_error(std::string("Failed to get size of file ") + path);
+	}
+
+	length = size_t(info.st_size);
+
+	// NOTE: Empty files can't be mapped, they are just empty
+	if (length == 0) {
+		::close(descriptor);
+		return;
+	}
+
+	void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+	// NOTE: Mapping holds its own reference to the file
+	::close(descriptor);
+
+	if (address == MAP_FAILED) {
+		length = 0;
+		throw std::runtime_error(std::string("Failed to map file ") + path);
+	}
+
+	// NOTE: Data is mostly copied front to back right after mapping,
+	//       so start reading ahead now. Advice values are not flags
+	madvise(address, length, MADV_SEQUENTIAL);
+	madvise(address, length, MADV_WILLNEED);
+
+	bytes = static_cast<const uint8_t*>(address);
+}
+
+void MappedFile::close() {
+	if (bytes) {
+		munmap(const_cast<uint8_t*>(bytes), length);
+	}
+
+	bytes = nullptr;
+	length = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+: bytes{std::exchange(other.bytes, nullptr)},
+  length{std::exchange(other.length, 0)}
+#if defined(_WIN32)
+, file{std::exchange(other.file, nullptr)},
+  mapping{std::exchange(other.mapping, nullptr)}
+#endif
+{}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		close();
+
+		bytes = std::exchange(other.bytes, nullptr);
+		length = std::exchange(other.length, 0);
+
+#if defined(_WIN32)
+		file = std::exchange(other.file, nullptr);
+		mapping = std::exchange(other.mapping, nullptr);
+#endif
+	}
+
+	return *this;
+}
+
+} // namespace veekay
@@ -0,0 +1,152 @@
+#include <veekay/mesh_file.hpp>
+
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+namespace veekay::graphics {
+
+static_assert(sizeof(MeshFileHeader) == 112, "Mesh file header layout must not change within a version");
+static_assert(sizeof(MeshFileLod) == 16);
+static_assert(sizeof(MeshFileMeshlet) == 48);
+
+namespace {
+
+	uint64_t alignUp(uint64_t value) {
+		return (value + mesh_file_alignment - 1) / mesh_file_alignment * mesh_file_alignment;
+	}
+
+	uint32_t indexSizeOf(uint32_t index_type) {
+		switch (index_type) {
+			case VK_INDEX_TYPE_UINT16: return 2;
+			case VK_INDEX_TYPE_UINT32: return 4;
+			default: return 0;
+		}
+	}
+
+	// NOTE: Section must be aligned and lie inside the file, sizes come from untrusted data
+	bool sectionFits(const MeshFileHeader& header, uint64_t offset, uint64_t count, uint64_t size) {
+		return offset % mesh_file_alignment == 0 &&
+		       offset <= header.file_size &&
+		       count <= (header.file_size - offset) / size;
+	}
+
+	void check(bool condition, const char* path, const char* what) {
+		if (!condition) {
+			throw std::runtime_error(std::string("Invalid mesh file ") + path + ": " + what);
+		}
+	}
+
+} // namespace
+
+MeshFile::MeshFile(const char* path)
+: file{path} {
+	check(file.size() >= sizeof(MeshFileHeader), path, "too small");
+
+	head = static_cast<const MeshFileHeader*>(file.data());
+
+	check(head->magic == mesh_file_magic, path, "not a mesh file");
+	check(head->version == mesh_file_version, path, "unsupported version");
+	check(head->file_size == file.size(), path, "truncated");
+	check(head->vertex_format == MeshVertexFormat::quantized, path, "unknown vertex format");
+	check(head->vertex_stride > 0, path, "zero vertex stride");
+
+	const uint32_t index_size = indexSizeOf(head->index_type);
+	check(index_size != 0, path, "unknown index type");
+
+	check(sectionFits(*head, head->vertex_offset, head->vertex_count, head->vertex_stride), path, "vertices out of file");
+	check(sectionFits(*head, head->index_offset, head->index_count, index_size), path, "indices out of file");
+	check(sectionFits(*head, head->lod_offset, head->lod_count, sizeof(MeshFileLod)), path, "LODs out of file");
+	check(sectionFits(*head, head->meshlet_offset, head->meshlet_count, sizeof(MeshFileMeshlet)), path, "meshlets out of file");
+
+	check(head->lod_count > 0, path, "no LODs");
+
+	// NOTE: Tables are tiny, index values are checked when they get copied
+	for (uint32_t i = 0; i < head->lod_count; ++i) {
+		const MeshFileLod& lod = lods()[i];
+		check(lod.first_index <= head->index_count &&
+		      lod.index_count <= head->index_count - lod.first_index, path, "LOD out of indices");
+	}
+
+	for (uint32_t i = 0; i < head->meshlet_count; ++i) {
+		const MeshFileMeshlet& meshlet = meshlets()[i];
+		check(meshlet.first_index <= head->index_count &&
+		      meshlet.index_count <= head->index_count - meshlet.first_index, path, "meshlet out of indices");
+	}
+}
+
+void writeMeshFile(const char* path, const MeshFileData& data) {
+	const uint32_t index_size = indexSizeOf(data.index_type);
+
+	if (index_size == 0) {
+		throw std::runtime_error("Unsupported index type of mesh file");
+	}
+
+	if (data.vertices.size() != size_t(data.vertex_count) * data.vertex_stride ||
+	    data.indices.size() != size_t(data.index_count) * index_size) {
+		throw std::runtime_error("Mesh file data sizes don't match counts");
+	}
+
+	if (data.lods.empty()) {
+		throw std::runtime_error("Mesh file needs at least one LOD");
+	}
+
+	MeshFileHeader header{
+		.magic = mesh_file_magic,
+		.version = mesh_file_version,
+		.vertex_format = data.vertex_format,
+		.vertex_stride = data.vertex_stride,
+		.index_type = uint32_t(data.index_type),
+		.lod_count = uint32_t(data.lods.size()),
+		.meshlet_count = uint32_t(data.meshlets.size()),
+		.bounds_center = {data.bounds_center[0], data.bounds_center[1], data.bounds_center[2]},
+		.bounds_radius = data.bounds_radius,
+		.quantization_center = {data.quantization_center[0], data.quantization_center[1],
+		                        data.quantization_center[2]},
+		.quantization_extent = data.quantization_extent,
+		.vertex_count = data.vertex_count,
+		.index_count = data.index_count,
+	};
+
+	header.vertex_offset = alignUp(sizeof(MeshFileHeader));
+	header.index_offset = alignUp(header.vertex_offset + data.vertices.size());
+	header.lod_offset = alignUp(header.index_offset + data.indices.size());
+	header.meshlet_offset = alignUp(header.lod_offset + data.lods.size() * sizeof(MeshFileLod));
+	header.file_size = alignUp(header.meshlet_offset + data.meshlets.size() * sizeof(MeshFileMeshlet));
+
+	std::vector<char> bytes(header.file_size, 0);
+
+	auto put = [&bytes](uint64_t offset, const void* source, size_t size) {
+		if (size > 0) {
+			std::copy(static_cast<const char*>(source), static_cast<const char*>(source) + size,
+			          bytes.data() + offset);
+		}
+	};
+
+	put(0, &header, sizeof(header));
+	put(header.vertex_offset, data.vertices.data(), data.vertices.size());
+	put(header.index_offset, data.indices.data(), data.indices.size());
+	put(header.lod_offset, data.lods.data(), data.lods.size() * sizeof(MeshFileLod));
+	put(header.meshlet_offset, data.meshlets.data(), data.meshlets.size() * sizeof(MeshFileMeshlet));
+
+	const std::string temp_path = std::string(path) + ".tmp";
+
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		file.write(bytes.data(), std::streamsize(bytes.size()));
+
+		if (!file) {
+			throw std::runtime_error("Failed to write mesh file " + temp_path);
+		}
+	}
+
+	std::remove(path);
+
+	if (std::rename(temp_path.c_str(), path) != 0) {
+		throw std::runtime_error(std::string("Failed to rename mesh file into ") + path);
+	}
+}
+
+} // namespace veekay::graphics
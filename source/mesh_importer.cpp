@@ -0,0 +1,1401 @@
+#include <veekay/mesh_importer.hpp>
+
+#include <cmath>
+#include <cctype>
+#include <mutex>
+#include <atomic>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <utility>
+#include <charconv>
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+#include <veekay/jobs.hpp>
+#include <veekay/mapped_file.hpp>
+
+namespace veekay::graphics {
+
+namespace {
+
+	// NOTE: Jobs must not throw, first error of any chunk is rethrown on importing thread
+	struct ImportErrors {
+		std::mutex mutex;
+		std::string message;
+		std::atomic<bool> failed = false;
+
+		void report(std::string text) {
+			std::lock_guard lock(mutex);
+
+			if (!failed.load(std::memory_order_relaxed)) {
+				message = std::move(text);
+				failed.store(true, std::memory_order_release);
+			}
+		}
+
+		void rethrow(const char* path) {
+			if (failed.load(std::memory_order_acquire)) {
+				throw std::runtime_error(std::string("Failed to import ") + path + ": " + message);
+			}
+		}
+	};
+
+	// NOTE: Runs func for every item of [0, count) on job threads and waits for all of them
+	template <typename Func>
+	void runParallel(size_t count, ImportErrors& errors, const Func& func) {
+		jobs::wait(jobs::parallelFor(count, 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end && !errors.failed.load(std::memory_order_relaxed); ++i) {
+				try {
+					func(i);
+				} catch (const std::exception& error) {
+					errors.report(error.what());
+				}
+			}
+		}));
+	}
+
+	bool hasExtension(std::string_view path, std::string_view extension) {
+		if (path.size() < extension.size()) {
+			return false;
+		}
+
+		return std::equal(extension.begin(), extension.end(), path.end() - extension.size(),
+		                  [](char a, char b) { return std::tolower(uint8_t(a)) == std::tolower(uint8_t(b)); });
+	}
+
+	vec3 mirrored(vec3 vector, bool mirror_y) {
+		if (mirror_y) {
+			vector.y = -vector.y;
+		}
+
+		return vector;
+	}
+
+	vec3 normalizedOrZero(const vec3& vector) {
+		const float length = vec3::length(vector);
+		return length > 0.0f ? vector * (1.0f / length) : vec3{};
+	}
+
+	void growBounds(vec3& min, vec3& max, const vec3& position) {
+		for (size_t i = 0; i < 3; ++i) {
+			min[i] = std::min(min[i], position[i]);
+			max[i] = std::max(max[i], position[i]);
+		}
+	}
+
+	constexpr float no_bounds = std::numeric_limits<float>::max();
+
+	// NOTE: Checks totals fit 32-bit vertex and index numbering
+	void beginImport(const MeshImportTarget& target, uint64_t vertex_count, uint64_t index_count,
+	                 const vec3& min, const vec3& max) {
+		if (vertex_count == 0 || index_count == 0) {
+			throw std::runtime_error("Mesh has no triangles");
+		}
+
+		if (vertex_count > UINT32_MAX || index_count > UINT32_MAX) {
+			throw std::runtime_error("Mesh has too many vertices or indices");
+		}
+
+		target.begin(MeshImportInfo{
+			.vertex_count = uint32_t(vertex_count),
+			.index_count = uint32_t(index_count),
+			.bounds_min = min,
+			.bounds_max = max,
+		});
+	}
+
+	// -------------------------------------------------------------------------
+	// NOTE: OBJ is parsed in three passes over chunks of whole lines. First one
+	//       counts elements, so every chunk knows where its output goes, second one
+	//       fills attribute pools and counts unique corners, third one emits them
+
+	struct ObjChunk {
+		const char* begin;
+		const char* end;
+
+		uint64_t lines;
+		uint64_t bad_line; // NOTE: Relative to chunk, first face with less than 3 corners
+		uint64_t positions;
+		uint64_t uvs;
+		uint64_t normals;
+		uint64_t vertices; // NOTE: Face corners, unique ones after second pass
+		uint64_t indices;
+
+		// NOTE: Prefix sums of counts above
+		uint64_t first_line;
+		uint64_t first_position;
+		uint64_t first_uv;
+		uint64_t first_normal;
+		uint64_t first_vertex;
+		uint64_t first_index;
+
+		vec3 min;
+		vec3 max;
+	};
+
+	struct ObjCorner {
+		uint32_t position;
+		uint32_t uv;
+		uint32_t normal;
+
+		bool operator==(const ObjCorner&) const = default;
+	};
+
+	struct ObjCornerHash {
+		size_t operator()(const ObjCorner& corner) const {
+			uint64_t hash = corner.position * 0x9e3779b97f4a7c15ull;
+			hash = (hash ^ corner.uv) * 0xbf58476d1ce4e5b9ull;
+			hash = (hash ^ corner.normal) * 0x94d049bb133111ebull;
+
+			return size_t(hash ^ (hash >> 31));
+		}
+	};
+
+	// NOTE: Local vertex of every corner seen in a chunk. Chunks number their vertices
+	//       on their own, so a corner used by two chunks becomes two vertices
+	typedef std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> ObjCornerMap;
+
+	constexpr uint32_t obj_missing = UINT32_MAX;
+
+	template <typename Func>
+	void forEachLine(const char* begin, const char* end, Func func) {
+		while (begin < end) {
+			const char* newline = static_cast<const char*>(std::memchr(begin, '\n', size_t(end - begin)));
+			const char* line_end = newline ? newline : end;
+
+			std::string_view line(begin, size_t(line_end - begin));
+
+			if (!line.empty() && line.back() == '\r') {
+				line.remove_suffix(1);
+			}
+
+			func(line);
+
+			begin = line_end + 1;
+		}
+	}
+
+	std::string_view nextToken(std::string_view& line) {
+		size_t start = 0;
+
+		while (start < line.size() && (line[start] == ' ' || line[start] == '\t')) {
+			++start;
+		}
+
+		size_t stop = start;
+
+		while (stop < line.size() && line[stop] != ' ' && line[stop] != '\t') {
+			++stop;
+		}
+
+		const std::string_view token = line.substr(start, stop - start);
+		line.remove_prefix(stop);
+
+		return token;
+	}
+
+	std::string lineError(uint64_t line, const char* what) {
+		return "line " + std::to_string(line + 1) + ": " + what;
+	}
+
+	float parseFloat(std::string_view token, uint64_t line) {
+		float value = 0.0f;
+
+		// NOTE: from_chars doesn't accept leading plus, some exporters write it
+		if (!token.empty() && token[0] == '+') {
+			token.remove_prefix(1);
+		}
+
+		const auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+
+		if (error != std::errc() || end != token.data() + token.size()) {
+			throw std::runtime_error(lineError(line, "invalid number"));
+		}
+
+		return value;
+	}
+
+	// NOTE: OBJ indices start at 1, negative ones count back from last element read so far
+	uint32_t parseObjIndex(std::string_view token, uint64_t seen, uint64_t line) {
+		int64_t index = 0;
+
+		const auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), index);
+
+		if (error != std::errc() || end != token.data() + token.size()) {
+			throw std::runtime_error(lineError(line, "invalid index"));
+		}
+
+		const int64_t resolved = index < 0 ? int64_t(seen) + index : index - 1;
+
+		if (index == 0 || resolved < 0 || uint64_t(resolved) >= seen) {
+			throw std::runtime_error(lineError(line, "index out of range"));
+		}
+
+		return uint32_t(resolved);
+	}
+
+	// NOTE: Corner is one of v, v/vt, v//vn or v/vt/vn
+	ObjCorner parseObjCorner(std::string_view token, const ObjChunk& chunk,
+	                         uint64_t positions, uint64_t uvs, uint64_t normals, uint64_t line) {
+		ObjCorner corner{obj_missing, obj_missing, obj_missing};
+
+		const size_t first_slash = token.find('/');
+		corner.position = parseObjIndex(token.substr(0, first_slash), chunk.first_position + positions, line);
+
+		if (first_slash == std::string_view::npos) {
+			return corner;
+		}
+
+		const size_t second_slash = token.find('/', first_slash + 1);
+		const std::string_view uv = token.substr(first_slash + 1, second_slash - first_slash - 1);
+
+		if (!uv.empty()) {
+			corner.uv = parseObjIndex(uv, chunk.first_uv + uvs, line);
+		}
+
+		if (second_slash != std::string_view::npos) {
+			corner.normal = parseObjIndex(token.substr(second_slash + 1), chunk.first_normal + normals, line);
+		}
+
+		return corner;
+	}
+
+	// NOTE: Corners without vn get normal of their face, so they are never shared.
+	//       Returns local vertex of corner, true in added when it wasn't seen before
+	uint32_t findObjVertex(ObjCornerMap& map, const ObjCorner& corner,
+	                       uint32_t& vertex_count, bool& added) {
+		added = true;
+
+		if (corner.normal == obj_missing) {
+			return vertex_count++;
+		}
+
+		const auto [it, inserted] = map.emplace(corner, vertex_count);
+
+		if (!inserted) {
+			added = false;
+			return it->second;
+		}
+
+		return vertex_count++;
+	}
+
+	// NOTE: Splits at line boundaries, every chunk but the last ends right after a newline
+	std::vector<ObjChunk> splitObj(const char* data, size_t size, size_t chunk_size) {
+		std::vector<ObjChunk> chunks;
+
+		const char* begin = data;
+		const char* end = data + size;
+
+		while (begin < end) {
+			const char* split = begin + std::min(std::max(chunk_size, size_t(1)), size_t(end - begin));
+
+			if (split < end) {
+				const char* newline = static_cast<const char*>(std::memchr(split, '\n', size_t(end - split)));
+				split = newline ? newline + 1 : end;
+			}
+
+			chunks.push_back(ObjChunk{.begin = begin, .end = split, .bad_line = UINT64_MAX});
+			begin = split;
+		}
+
+		return chunks;
+	}
+
+	void countObj(ObjChunk& chunk) {
+		forEachLine(chunk.begin, chunk.end, [&](std::string_view line) {
+			const std::string_view tag = nextToken(line);
+
+			if (tag == "v") {
+				++chunk.positions;
+			} else if (tag == "vt") {
+				++chunk.uvs;
+			} else if (tag == "vn") {
+				++chunk.normals;
+			} else if (tag == "f") {
+				uint64_t corners = 0;
+
+				while (!nextToken(line).empty()) {
+					++corners;
+				}
+
+				// NOTE: Line numbers are known only once every chunk is counted
+				if (corners < 3) {
+					chunk.bad_line = std::min(chunk.bad_line, chunk.lines);
+					corners = 3;
+				}
+
+				chunk.vertices += corners;
+				chunk.indices += (corners - 2) * 3;
+			}
+
+			++chunk.lines;
+		});
+	}
+
+	struct ObjPools {
+		std::vector<vec3> positions;
+		std::vector<vec2> uvs;
+		std::vector<vec3> normals;
+	};
+
+	void readObjAttributes(ObjChunk& chunk, ObjPools& pools, bool mirror_y) {
+		vec3* positions = pools.positions.data() + chunk.first_position;
+		vec2* uvs = pools.uvs.data() + chunk.first_uv;
+		vec3* normals = pools.normals.data() + chunk.first_normal;
+
+		chunk.min = vec3{no_bounds, no_bounds, no_bounds};
+		chunk.max = vec3{-no_bounds, -no_bounds, -no_bounds};
+
+		uint64_t line_index = chunk.first_line;
+
+		ObjCornerMap map;
+		map.reserve(chunk.vertices);
+
+		uint32_t vertex_count = 0;
+
+		forEachLine(chunk.begin, chunk.end, [&](std::string_view line) {
+			const std::string_view tag = nextToken(line);
+
+			if (tag == "v" || tag == "vn") {
+				vec3 value;
+
+				for (size_t i = 0; i < 3; ++i) {
+					value[i] = parseFloat(nextToken(line), line_index);
+				}
+
+				if (tag == "v") {
+					*positions++ = value;
+					growBounds(chunk.min, chunk.max, mirrored(value, mirror_y));
+				} else {
+					*normals++ = value;
+				}
+			} else if (tag == "vt") {
+				// NOTE: V is optional, origin of OBJ UVs is at bottom left
+				const float u = parseFloat(nextToken(line), line_index);
+				const std::string_view v = nextToken(line);
+
+				*uvs++ = vec2{u, 1.0f - (v.empty() ? 0.0f : parseFloat(v, line_index))};
+			} else if (tag == "f") {
+				const uint64_t seen_positions = uint64_t(positions - pools.positions.data()) - chunk.first_position;
+				const uint64_t seen_uvs = uint64_t(uvs - pools.uvs.data()) - chunk.first_uv;
+				const uint64_t seen_normals = uint64_t(normals - pools.normals.data()) - chunk.first_normal;
+
+				for (std::string_view token = nextToken(line); !token.empty(); token = nextToken(line)) {
+					const ObjCorner corner = parseObjCorner(token, chunk, seen_positions, seen_uvs,
+					                                        seen_normals, line_index);
+
+					bool added;
+					findObjVertex(map, corner, vertex_count, added);
+				}
+			}
+
+			++line_index;
+		});
+
+		chunk.vertices = vertex_count;
+	}
+
+	void emitObjFaces(const ObjChunk& chunk, const ObjPools& pools, const MeshImportTarget& target,
+	                  const MeshImportOptions& options) {
+		// NOTE: Sized by earlier passes, so output of a chunk is its only allocation
+		//       besides corner map, which numbers corners the same way second pass did
+		std::vector<ImportedVertex> vertices(chunk.vertices);
+		std::vector<uint32_t> indices(chunk.indices);
+		std::vector<ObjCorner> corners;
+		std::vector<uint32_t> corner_vertices;
+
+		ObjCornerMap map;
+		map.reserve(chunk.vertices);
+
+		uint32_t vertex_count = 0;
+
+		uint64_t positions = 0;
+		uint64_t uvs = 0;
+		uint64_t normals = 0;
+
+		uint64_t line_index = chunk.first_line;
+
+		uint32_t* index = indices.data();
+
+		forEachLine(chunk.begin, chunk.end, [&](std::string_view line) {
+			const std::string_view tag = nextToken(line);
+
+			if (tag == "v") {
+				++positions;
+			} else if (tag == "vt") {
+				++uvs;
+			} else if (tag == "vn") {
+				++normals;
+			} else if (tag == "f") {
+				corners.clear();
+
+				for (std::string_view token = nextToken(line); !token.empty(); token = nextToken(line)) {
+					corners.push_back(parseObjCorner(token, chunk, positions, uvs, normals, line_index));
+				}
+
+				// NOTE: Counting pass already rejected shorter faces
+
+				// NOTE: Newell's method, works for non-planar polygons too.
+				//       Counter-clockwise front faces of OBJ make it point outwards
+				vec3 face_normal{};
+
+				for (size_t i = 0; i < corners.size(); ++i) {
+					const vec3& a = pools.positions[corners[i].position];
+					const vec3& b = pools.positions[corners[(i + 1) % corners.size()].position];
+
+					face_normal.x += (a.y - b.y) * (a.z + b.z);
+					face_normal.y += (a.z - b.z) * (a.x + b.x);
+					face_normal.z += (a.x - b.x) * (a.y + b.y);
+				}
+
+				face_normal = normalizedOrZero(face_normal);
+
+				corner_vertices.clear();
+
+				for (const ObjCorner& corner : corners) {
+					bool added;
+					const uint32_t local = findObjVertex(map, corner, vertex_count, added);
+
+					corner_vertices.push_back(uint32_t(chunk.first_vertex) + local);
+
+					if (!added) {
+						continue;
+					}
+
+					const vec3 normal = corner.normal == obj_missing ? face_normal : pools.normals[corner.normal];
+
+					vertices[local] = ImportedVertex{
+						.position = mirrored(pools.positions[corner.position], options.mirror_y),
+						.normal = mirrored(normal, options.mirror_y),
+						.uv = corner.uv == obj_missing ? vec2{} : pools.uvs[corner.uv],
+					};
+				}
+
+				for (size_t i = 2; i < corner_vertices.size(); ++i) {
+					*index++ = corner_vertices[0];
+					*index++ = corner_vertices[options.flip_winding ? i : i - 1];
+					*index++ = corner_vertices[options.flip_winding ? i - 1 : i];
+				}
+			}
+
+			++line_index;
+		});
+
+		target.write(MeshImportChunk{
+			.first_vertex = uint32_t(chunk.first_vertex),
+			.vertex_count = uint32_t(vertices.size()),
+			.vertices = vertices.data(),
+			.first_index = uint32_t(chunk.first_index),
+			.index_count = uint32_t(indices.size()),
+			.indices = indices.data(),
+		});
+	}
+
+	void importObj(const char* path, const MeshImportTarget& target, const MeshImportOptions& options) {
+		MappedFile file(path);
+		ImportErrors errors;
+
+		std::vector<ObjChunk> chunks = splitObj(static_cast<const char*>(file.data()), file.size(),
+		                                        options.chunk_size);
+
+		runParallel(chunks.size(), errors, [&](size_t i) { countObj(chunks[i]); });
+		errors.rethrow(path);
+
+		ObjChunk total{};
+
+		for (ObjChunk& chunk : chunks) {
+			chunk.first_line = total.lines;
+			chunk.first_position = total.positions;
+			chunk.first_uv = total.uvs;
+			chunk.first_normal = total.normals;
+			chunk.first_index = total.indices;
+
+			total.lines += chunk.lines;
+			total.positions += chunk.positions;
+			total.uvs += chunk.uvs;
+			total.normals += chunk.normals;
+			total.indices += chunk.indices;
+
+			if (chunk.bad_line != UINT64_MAX) {
+				throw std::runtime_error(std::string("Failed to import ") + path + ": " +
+				                         lineError(chunk.first_line + chunk.bad_line,
+				                                   "face with less than 3 corners"));
+			}
+		}
+
+		if (total.positions > UINT32_MAX || total.uvs > UINT32_MAX || total.normals > UINT32_MAX) {
+			throw std::runtime_error(std::string("Too many elements in ") + path);
+		}
+
+		ObjPools pools{
+			.positions = std::vector<vec3>(total.positions),
+			.uvs = std::vector<vec2>(total.uvs),
+			.normals = std::vector<vec3>(total.normals),
+		};
+
+		runParallel(chunks.size(), errors, [&](size_t i) {
+			readObjAttributes(chunks[i], pools, options.mirror_y);
+		});
+		errors.rethrow(path);
+
+		vec3 min{no_bounds, no_bounds, no_bounds};
+		vec3 max{-no_bounds, -no_bounds, -no_bounds};
+
+		for (ObjChunk& chunk : chunks) {
+			chunk.first_vertex = total.vertices;
+			total.vertices += chunk.vertices;
+
+			for (size_t i = 0; i < 3; ++i) {
+				min[i] = std::min(min[i], chunk.min[i]);
+				max[i] = std::max(max[i], chunk.max[i]);
+			}
+		}
+
+		beginImport(target, total.vertices, total.indices, min, max);
+
+		runParallel(chunks.size(), errors, [&](size_t i) {
+			emitObjFaces(chunks[i], pools, target, options);
+		});
+		errors.rethrow(path);
+	}
+
+	// -------------------------------------------------------------------------
+	// NOTE: Minimal JSON reader for glTF documents, which are small next to their buffers
+
+	struct JsonValue {
+		enum class Type { null, boolean, number, string, array, object };
+
+		Type type = Type::null;
+		bool boolean = false;
+		double number = 0.0;
+		std::string string;
+		std::vector<JsonValue> array;
+		std::vector<std::pair<std::string, JsonValue>> object;
+
+		const JsonValue* find(std::string_view key) const {
+			for (const auto& [name, value] : object) {
+				if (name == key) {
+					return &value;
+				}
+			}
+
+			return nullptr;
+		}
+
+		bool isNumber() const { return type == Type::number; }
+	};
+
+	class JsonParser {
+	public:
+		JsonParser(const char* begin, const char* end) : cursor{begin}, end{end} {}
+
+		JsonValue parseDocument() {
+			JsonValue value = parseValue(0);
+			skipSpace();
+
+			if (cursor != end) {
+				fail("trailing data");
+			}
+
+			return value;
+		}
+
+	private:
+		// NOTE: Deeply nested input must not overflow the stack
+		static constexpr uint32_t max_depth = 64;
+
+		[[noreturn]] void fail(const char* what) {
+			throw std::runtime_error(std::string("invalid JSON, ") + what);
+		}
+
+		void skipSpace() {
+			while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) {
+				++cursor;
+			}
+		}
+
+		void expect(char character) {
+			skipSpace();
+
+			if (cursor == end || *cursor != character) {
+				fail("unexpected character");
+			}
+
+			++cursor;
+		}
+
+		bool consume(std::string_view word) {
+			if (size_t(end - cursor) >= word.size() && std::string_view(cursor, word.size()) == word) {
+				cursor += word.size();
+				return true;
+			}
+
+			return false;
+		}
+
+		bool consumeComma() {
+			skipSpace();
+			return consume(",");
+		}
+
+		JsonValue parseValue(uint32_t depth) {
+			if (depth > max_depth) {
+				fail("nested too deep");
+			}
+
+			skipSpace();
+
+			if (cursor == end) {
+				fail("unexpected end");
+			}
+
+			JsonValue value;
+
+			switch (*cursor) {
+				case '{': {
+					value.type = JsonValue::Type::object;
+					++cursor;
+					skipSpace();
+
+					if (cursor < end && *cursor == '}') {
+						++cursor;
+						break;
+					}
+
+					do {
+						skipSpace();
+						std::string key = parseString();
+						expect(':');
+						value.object.emplace_back(std::move(key), parseValue(depth + 1));
+					} while (consumeComma());
+
+					expect('}');
+					break;
+				}
+
+				case '[': {
+					value.type = JsonValue::Type::array;
+					++cursor;
+					skipSpace();
+
+					if (cursor < end && *cursor == ']') {
+						++cursor;
+						break;
+					}
+
+					do {
+						value.array.push_back(parseValue(depth + 1));
+					} while (consumeComma());
+
+					expect(']');
+					break;
+				}
+
+				case '"':
+					value.type = JsonValue::Type::string;
+					value.string = parseString();
+					break;
+
+				default:
+					if (consume("true")) {
+						value.type = JsonValue::Type::boolean;
+						value.boolean = true;
+					} else if (consume("false")) {
+						value.type = JsonValue::Type::boolean;
+					} else if (!consume("null")) {
+						value.type = JsonValue::Type::number;
+						value.number = parseNumber();
+					}
+			}
+
+			return value;
+		}
+
+		double parseNumber() {
+			double number = 0.0;
+			const auto [next, error] = std::from_chars(cursor, end, number);
+
+			if (error != std::errc()) {
+				fail("invalid number");
+			}
+
+			cursor = next;
+			return number;
+		}
+
+		uint32_t parseHex() {
+			if (end - cursor < 4) {
+				fail("truncated escape");
+			}
+
+			uint32_t code = 0;
+			const auto [next, error] = std::from_chars(cursor, cursor + 4, code, 16);
+
+			if (error != std::errc() || next != cursor + 4) {
+				fail("invalid escape");
+			}
+
+			cursor = next;
+			return code;
+		}
+
+		void appendUtf8(std::string& out, uint32_t code) {
+			if (code < 0x80) {
+				out += char(code);
+			} else if (code < 0x800) {
+				out += char(0xc0 | (code >> 6));
+				out += char(0x80 | (code & 0x3f));
+			} else if (code < 0x10000) {
+				out += char(0xe0 | (code >> 12));
+				out += char(0x80 | ((code >> 6) & 0x3f));
+				out += char(0x80 | (code & 0x3f));
+			} else {
+				out += char(0xf0 | (code >> 18));
+				out += char(0x80 | ((code >> 12) & 0x3f));
+				out += char(0x80 | ((code >> 6) & 0x3f));
+				out += char(0x80 | (code & 0x3f));
+			}
+		}
+
+		std::string parseString() {
+			if (cursor == end || *cursor != '"') {
+				fail("expected string");
+			}
+
+			++cursor;
+
+			std::string out;
+
+			while (cursor < end && *cursor != '"') {
+				const char character = *cursor++;
+
+				if (character != '\\') {
+					out += character;
+					continue;
+				}
+
+				if (cursor == end) {
+					fail("truncated escape");
+				}
+
+				switch (*cursor++) {
+					case '"': out += '"'; break;
+					case '\\': out += '\\'; break;
+					case '/': out += '/'; break;
+					case 'b': out += '\b'; break;
+					case 'f': out += '\f'; break;
+					case 'n': out += '\n'; break;
+					case 'r': out += '\r'; break;
+					case 't': out += '\t'; break;
+
+					case 'u': {
+						uint32_t code = parseHex();
+
+						// NOTE: Characters outside of basic plane come as surrogate pairs
+						if (code >= 0xd800 && code < 0xdc00 && consume("\\u")) {
+							const uint32_t low = parseHex();
+							code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+						}
+
+						appendUtf8(out, code);
+						break;
+					}
+
+					default:
+						fail("invalid escape");
+				}
+			}
+
+			if (cursor == end) {
+				fail("unterminated string");
+			}
+
+			++cursor;
+			return out;
+		}
+
+		const char* cursor;
+		const char* end;
+	};
+
+	// -------------------------------------------------------------------------
+	// NOTE: glTF accessors are read straight from mapped buffers
+
+	constexpr uint32_t gltf_byte = 5120;
+	constexpr uint32_t gltf_unsigned_byte = 5121;
+	constexpr uint32_t gltf_short = 5122;
+	constexpr uint32_t gltf_unsigned_short = 5123;
+	constexpr uint32_t gltf_unsigned_int = 5125;
+	constexpr uint32_t gltf_float = 5126;
+
+	constexpr uint32_t gltf_triangles = 4;
+
+	constexpr uint32_t glb_magic = 0x46546c67; // NOTE: "glTF"
+	constexpr uint32_t glb_json = 0x4e4f534a;  // NOTE: "JSON"
+	constexpr uint32_t glb_binary = 0x004e4942; // NOTE: "BIN\0"
+
+	struct GltfBuffer {
+		const uint8_t* data;
+		size_t size;
+	};
+
+	struct GltfAccessor {
+		const uint8_t* data; // NOTE: nullptr when primitive lacks the attribute
+		size_t stride;
+		uint32_t count;
+		uint32_t component_type;
+		uint32_t components;
+		bool normalized;
+	};
+
+	struct GltfPrimitive {
+		GltfAccessor positions;
+		GltfAccessor normals;
+		GltfAccessor uvs;
+		GltfAccessor indices;
+
+		uint32_t first_vertex;
+		uint32_t first_index;
+		uint32_t index_count;
+
+		// NOTE: Only for primitives without normals, accumulated from their triangles
+		std::vector<vec3> generated_normals;
+	};
+
+	// NOTE: Piece of one primitive converted by a single job
+	struct GltfTask {
+		uint32_t primitive;
+		bool indices;
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	const JsonValue& member(const JsonValue& object, std::string_view key) {
+		const JsonValue* value = object.find(key);
+
+		if (!value) {
+			throw std::runtime_error("missing " + std::string(key));
+		}
+
+		return *value;
+	}
+
+	uint64_t integerOf(const JsonValue& value, std::string_view what) {
+		if (!value.isNumber() || value.number < 0.0 || value.number > double(UINT64_MAX / 2) ||
+		    value.number != std::floor(value.number)) {
+			throw std::runtime_error("invalid " + std::string(what));
+		}
+
+		return uint64_t(value.number);
+	}
+
+	uint64_t integerOr(const JsonValue& object, std::string_view key, uint64_t fallback) {
+		const JsonValue* value = object.find(key);
+		return value ? integerOf(*value, key) : fallback;
+	}
+
+	const JsonValue& element(const JsonValue& document, std::string_view array, uint64_t index) {
+		const JsonValue& values = member(document, array);
+
+		if (values.type != JsonValue::Type::array || index >= values.array.size()) {
+			throw std::runtime_error(std::string(array) + " index out of range");
+		}
+
+		return values.array[index];
+	}
+
+	uint32_t componentSize(uint32_t component_type) {
+		switch (component_type) {
+			case gltf_byte:
+			case gltf_unsigned_byte: return 1;
+			case gltf_short:
+			case gltf_unsigned_short: return 2;
+			case gltf_unsigned_int:
+			case gltf_float: return 4;
+			default: throw std::runtime_error("unknown component type");
+		}
+	}
+
+	uint32_t componentCount(const std::string& type) {
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		throw std::runtime_error("unsupported accessor type " + type);
+	}
+
+	GltfAccessor loadAccessor(const JsonValue& document, const std::vector<GltfBuffer>& buffers,
+	                          uint64_t index) {
+		const JsonValue& accessor = element(document, "accessors", index);
+
+		if (accessor.find("sparse")) {
+			throw std::runtime_error("sparse accessors are not supported");
+		}
+
+		GltfAccessor result{
+			.count = uint32_t(std::min(integerOf(member(accessor, "count"), "count"), uint64_t(UINT32_MAX))),
+			.component_type = uint32_t(integerOf(member(accessor, "componentType"), "componentType")),
+			.components = componentCount(member(accessor, "type").string),
+		};
+
+		const JsonValue* normalized = accessor.find("normalized");
+		result.normalized = normalized && normalized->boolean;
+
+		const size_t element_size = size_t(componentSize(result.component_type)) * result.components;
+
+		const JsonValue* view_index = accessor.find("bufferView");
+
+		if (!view_index) {
+			throw std::runtime_error("accessors without buffer view are not supported");
+		}
+
+		const JsonValue& view = element(document, "bufferViews", integerOf(*view_index, "bufferView"));
+		const uint64_t buffer_index = integerOf(member(view, "buffer"), "buffer");
+
+		if (buffer_index >= buffers.size()) {
+			throw std::runtime_error("buffer index out of range");
+		}
+
+		const GltfBuffer& buffer = buffers[buffer_index];
+
+		const uint64_t view_offset = integerOr(view, "byteOffset", 0);
+		const uint64_t view_length = integerOf(member(view, "byteLength"), "byteLength");
+		const uint64_t accessor_offset = integerOr(accessor, "byteOffset", 0);
+
+		result.stride = size_t(integerOr(view, "byteStride", element_size));
+
+		// NOTE: Offsets come from the file, everything read must lie inside view and buffer
+		if (view_offset > buffer.size || view_length > buffer.size - view_offset ||
+		    result.stride < element_size) {
+			throw std::runtime_error("buffer view out of buffer");
+		}
+
+		if (accessor_offset > view_length) {
+			throw std::runtime_error("accessor out of buffer view");
+		}
+
+		const uint64_t available = view_length - accessor_offset;
+
+		if (result.count > 0 &&
+		    (available < element_size || uint64_t(result.count - 1) > (available - element_size) / result.stride)) {
+			throw std::runtime_error("accessor out of buffer view");
+		}
+
+		result.data = buffer.data + view_offset + accessor_offset;
+
+		return result;
+	}
+
+	float readComponent(const uint8_t* data, uint32_t component_type, bool normalized) {
+		switch (component_type) {
+			case gltf_float: {
+				float value;
+				std::memcpy(&value, data, sizeof(value));
+				return value;
+			}
+
+			case gltf_unsigned_byte: return normalized ? float(data[0]) / 255.0f : float(data[0]);
+
+			case gltf_unsigned_short: {
+				uint16_t value;
+				std::memcpy(&value, data, sizeof(value));
+				return normalized ? float(value) / 65535.0f : float(value);
+			}
+
+			case gltf_byte: {
+				const float value = float(int8_t(data[0]));
+				return normalized ? std::max(value / 127.0f, -1.0f) : value;
+			}
+
+			case gltf_short: {
+				int16_t value;
+				std::memcpy(&value, data, sizeof(value));
+				return normalized ? std::max(float(value) / 32767.0f, -1.0f) : float(value);
+			}
+
+			default: {
+				uint32_t value;
+				std::memcpy(&value, data, sizeof(value));
+				return float(value);
+			}
+		}
+	}
+
+	template <size_t count>
+	void readElement(const GltfAccessor& accessor, uint32_t index, float (&out)[count]) {
+		const uint8_t* data = accessor.data + size_t(index) * accessor.stride;
+		const uint32_t size = componentSize(accessor.component_type);
+
+		for (size_t i = 0; i < count; ++i) {
+			out[i] = readComponent(data + i * size, accessor.component_type, accessor.normalized);
+		}
+	}
+
+	vec3 readVec3(const GltfAccessor& accessor, uint32_t index) {
+		float values[3];
+		readElement(accessor, index, values);
+		return vec3{values[0], values[1], values[2]};
+	}
+
+	// NOTE: Non-indexed primitives draw vertices in order
+	uint32_t readIndex(const GltfAccessor& accessor, uint32_t index) {
+		if (!accessor.data) {
+			return index;
+		}
+
+		const uint8_t* data = accessor.data + size_t(index) * accessor.stride;
+
+		switch (accessor.component_type) {
+			case gltf_unsigned_byte: return data[0];
+
+			case gltf_unsigned_short: {
+				uint16_t value;
+				std::memcpy(&value, data, sizeof(value));
+				return value;
+			}
+
+			default: {
+				uint32_t value;
+				std::memcpy(&value, data, sizeof(value));
+				return value;
+			}
+		}
+	}
+
+	void checkAccessor(const GltfAccessor& accessor, uint32_t components,
+	                   std::initializer_list<uint32_t> component_types, const char* what) {
+		if (accessor.components != components ||
+		    std::find(component_types.begin(), component_types.end(),
+		              accessor.component_type) == component_types.end()) {
+			throw std::runtime_error(std::string("unsupported format of ") + what);
+		}
+	}
+
+	// NOTE: Percent escapes are decoded, anything else is a path relative to document
+	std::string resolveUri(const char* document_path, const std::string& uri) {
+		if (uri.rfind("data:", 0) == 0) {
+			throw std::runtime_error("embedded data URIs are not supported, use .glb");
+		}
+
+		std::string decoded;
+
+		for (size_t i = 0; i < uri.size(); ++i) {
+			uint32_t code = 0;
+
+			if (uri[i] == '%' && i + 2 < uri.size() &&
+			    std::from_chars(uri.data() + i + 1, uri.data() + i + 3, code, 16).ptr == uri.data() + i + 3) {
+				decoded += char(code);
+				i += 2;
+			} else {
+				decoded += uri[i];
+			}
+		}
+
+		const std::string_view path(document_path);
+		const size_t slash = path.find_last_of("/\\");
+
+		return slash == std::string_view::npos ? decoded : std::string(path.substr(0, slash + 1)) + decoded;
+	}
+
+	void accumulateNormals(GltfPrimitive& primitive) {
+		primitive.generated_normals.assign(primitive.positions.count, vec3{});
+
+		for (uint32_t i = 0; i + 2 < primitive.index_count; i += 3) {
+			const uint32_t a = readIndex(primitive.indices, i + 0);
+			const uint32_t b = readIndex(primitive.indices, i + 1);
+			const uint32_t c = readIndex(primitive.indices, i + 2);
+
+			const vec3 pa = readVec3(primitive.positions, a);
+
+			// NOTE: Counter-clockwise front faces of glTF, area weighted
+			const vec3 normal = vec3::cross(readVec3(primitive.positions, b) - pa,
+			                                readVec3(primitive.positions, c) - pa);
+
+			primitive.generated_normals[a] += normal;
+			primitive.generated_normals[b] += normal;
+			primitive.generated_normals[c] += normal;
+		}
+	}
+
+	void emitGltfTask(const GltfTask& task, const GltfPrimitive& primitive,
+	                  const MeshImportTarget& target, const MeshImportOptions& options) {
+		if (task.indices) {
+			std::vector<uint32_t> indices(task.end - task.begin);
+
+			for (uint32_t i = task.begin; i < task.end; i += 3) {
+				uint32_t triangle[3] = {
+					readIndex(primitive.indices, i + 0),
+					readIndex(primitive.indices, i + 1),
+					readIndex(primitive.indices, i + 2),
+				};
+
+				if (options.flip_winding) {
+					std::swap(triangle[1], triangle[2]);
+				}
+
+				for (uint32_t j = 0; j < 3; ++j) {
+					indices[i - task.begin + j] = primitive.first_vertex + triangle[j];
+				}
+			}
+
+			target.write(MeshImportChunk{
+				.first_index = primitive.first_index + task.begin,
+				.index_count = uint32_t(indices.size()),
+				.indices = indices.data(),
+			});
+
+			return;
+		}
+
+		std::vector<ImportedVertex> vertices(task.end - task.begin);
+
+		for (uint32_t i = task.begin; i < task.end; ++i) {
+			ImportedVertex& vertex = vertices[i - task.begin];
+
+			vertex.position = mirrored(readVec3(primitive.positions, i), options.mirror_y);
+
+			const vec3 normal = primitive.normals.data ? readVec3(primitive.normals, i)
+			                                           : primitive.generated_normals[i];
+			vertex.normal = mirrored(normalizedOrZero(normal), options.mirror_y);
+
+			if (primitive.uvs.data) {
+				float uv[2];
+				readElement(primitive.uvs, i, uv);
+				vertex.uv = vec2{uv[0], uv[1]};
+			}
+		}
+
+		target.write(MeshImportChunk{
+			.first_vertex = primitive.first_vertex + task.begin,
+			.vertex_count = uint32_t(vertices.size()),
+			.vertices = vertices.data(),
+		});
+	}
+
+	void importGltf(const char* path, const MeshImportTarget& target, const MeshImportOptions& options) {
+		MappedFile file(path);
+
+		const uint8_t* bytes = static_cast<const uint8_t*>(file.data());
+
+		std::string_view json(static_cast<const char*>(file.data()), file.size());
+		GltfBuffer binary{};
+
+		if (hasExtension(path, ".glb")) {
+			uint32_t header[3];
+
+			if (file.size() < sizeof(header) + 8) {
+				throw std::runtime_error(std::string("Truncated glTF file ") + path);
+			}
+
+			std::memcpy(header, bytes, sizeof(header));
+
+			if (header[0] != glb_magic || header[1] != 2 || header[2] > file.size()) {
+				throw std::runtime_error(std::string("Invalid glTF binary header in ") + path);
+			}
+
+			// NOTE: JSON chunk comes first, optional binary chunk right after
+			size_t offset = sizeof(header);
+			json = {};
+
+			while (offset + 8 <= header[2]) {
+				uint32_t chunk[2];
+				std::memcpy(chunk, bytes + offset, sizeof(chunk));
+
+				offset += sizeof(chunk);
+
+				if (chunk[0] > header[2] - offset) {
+					throw std::runtime_error(std::string("Truncated glTF chunk in ") + path);
+				}
+
+				if (chunk[1] == glb_json && json.empty()) {
+					json = std::string_view(reinterpret_cast<const char*>(bytes + offset), chunk[0]);
+				} else if (chunk[1] == glb_binary && !binary.data) {
+					binary = GltfBuffer{bytes + offset, chunk[0]};
+				}
+
+				offset += (size_t(chunk[0]) + 3) & ~size_t(3);
+			}
+		}
+
+		JsonValue document;
+		std::vector<MappedFile> external;
+		std::vector<GltfBuffer> buffers;
+		std::vector<GltfPrimitive> primitives;
+
+		uint64_t vertex_count = 0;
+		uint64_t index_count = 0;
+
+		vec3 min{no_bounds, no_bounds, no_bounds};
+		vec3 max{-no_bounds, -no_bounds, -no_bounds};
+
+		try {
+			document = JsonParser(json.data(), json.data() + json.size()).parseDocument();
+
+			if (const JsonValue* values = document.find("buffers")) {
+				for (const JsonValue& buffer : values->array) {
+					const JsonValue* uri = buffer.find("uri");
+
+					if (!uri) {
+						buffers.push_back(binary);
+						continue;
+					}
+
+					external.emplace_back(resolveUri(path, uri->string).c_str());
+					buffers.push_back(GltfBuffer{static_cast<const uint8_t*>(external.back().data()),
+					                             external.back().size()});
+				}
+			}
+
+			const JsonValue* meshes = document.find("meshes");
+			const std::vector<JsonValue> no_meshes;
+
+			for (const JsonValue& mesh : meshes ? meshes->array : no_meshes) {
+				for (const JsonValue& source : member(mesh, "primitives").array) {
+					if (integerOr(source, "mode", gltf_triangles) != gltf_triangles) {
+						continue;
+					}
+
+					const JsonValue& attributes = member(source, "attributes");
+
+					GltfPrimitive primitive{};
+
+					primitive.positions = loadAccessor(document, buffers, integerOf(member(attributes, "POSITION"), "POSITION"));
+					checkAccessor(primitive.positions, 3, {gltf_float}, "POSITION");
+
+					if (const JsonValue* normals = attributes.find("NORMAL")) {
+						primitive.normals = loadAccessor(document, buffers, integerOf(*normals, "NORMAL"));
+						checkAccessor(primitive.normals, 3, {gltf_float}, "NORMAL");
+
+						if (primitive.normals.count < primitive.positions.count) {
+							throw std::runtime_error("NORMAL has less elements than POSITION");
+						}
+					}
+
+					if (const JsonValue* uvs = attributes.find("TEXCOORD_0")) {
+						primitive.uvs = loadAccessor(document, buffers, integerOf(*uvs, "TEXCOORD_0"));
+						checkAccessor(primitive.uvs, 2, {gltf_float, gltf_unsigned_byte, gltf_unsigned_short},
+						              "TEXCOORD_0");
+
+						if (primitive.uvs.count < primitive.positions.count) {
+							throw std::runtime_error("TEXCOORD_0 has less elements than POSITION");
+						}
+					}
+
+					primitive.index_count = primitive.positions.count;
+
+					if (const JsonValue* indices = source.find("indices")) {
+						primitive.indices = loadAccessor(document, buffers, integerOf(*indices, "indices"));
+						checkAccessor(primitive.indices, 1,
+						              {gltf_unsigned_byte, gltf_unsigned_short, gltf_unsigned_int}, "indices");
+
+						primitive.index_count = primitive.indices.count;
+					}
+
+					if (primitive.index_count % 3 != 0) {
+						throw std::runtime_error("triangle list with incomplete triangle");
+					}
+
+					primitive.first_vertex = uint32_t(std::min(vertex_count, uint64_t(UINT32_MAX)));
+					primitive.first_index = uint32_t(std::min(index_count, uint64_t(UINT32_MAX)));
+
+					vertex_count += primitive.positions.count;
+					index_count += primitive.index_count;
+
+					// NOTE: Bounds are required by glTF, computed from positions only when missing
+					const JsonValue& accessor = element(document, "accessors",
+					                                    integerOf(member(attributes, "POSITION"), "POSITION"));
+					const JsonValue* accessor_min = accessor.find("min");
+					const JsonValue* accessor_max = accessor.find("max");
+
+					if (accessor_min && accessor_max &&
+					    accessor_min->array.size() == 3 && accessor_max->array.size() == 3) {
+						for (const JsonValue* corner : {accessor_min, accessor_max}) {
+							growBounds(min, max, mirrored(vec3{float(corner->array[0].number),
+							                                   float(corner->array[1].number),
+							                                   float(corner->array[2].number)},
+							                              options.mirror_y));
+						}
+					} else {
+						for (uint32_t i = 0; i < primitive.positions.count; ++i) {
+							growBounds(min, max, mirrored(readVec3(primitive.positions, i), options.mirror_y));
+						}
+					}
+
+					primitives.push_back(std::move(primitive));
+				}
+			}
+		} catch (const std::exception& error) {
+			throw std::runtime_error(std::string("Failed to import ") + path + ": " + error.what());
+		}
+
+		ImportErrors errors;
+
+		// NOTE: Indices are checked before anything is written, so a broken file
+		//       never reaches the target. Normals are generated in the same pass
+		runParallel(primitives.size(), errors, [&](size_t i) {
+			GltfPrimitive& primitive = primitives[i];
+
+			if (primitive.indices.data) {
+				for (uint32_t j = 0; j < primitive.index_count; ++j) {
+					if (readIndex(primitive.indices, j) >= primitive.positions.count) {
+						throw std::runtime_error("index out of range");
+					}
+				}
+			}
+
+			if (!primitive.normals.data) {
+				accumulateNormals(primitive);
+			}
+		});
+		errors.rethrow(path);
+
+		beginImport(target, vertex_count, index_count, min, max);
+
+		// NOTE: Tasks are sized by converted bytes, index ones hold whole triangles
+		const uint32_t vertices_per_task = uint32_t(std::clamp(options.chunk_size / sizeof(ImportedVertex),
+		                                                       size_t(1), size_t(UINT32_MAX)));
+		const uint32_t indices_per_task = uint32_t(std::clamp(options.chunk_size / sizeof(uint32_t) / 3 * 3,
+		                                                      size_t(3), size_t(UINT32_MAX / 3 * 3)));
+
+		std::vector<GltfTask> tasks;
+
+		for (uint32_t i = 0; i < primitives.size(); ++i) {
+			const GltfPrimitive& primitive = primitives[i];
+
+			for (uint32_t begin = 0; begin < primitive.positions.count;) {
+				const uint32_t end = begin + std::min(vertices_per_task, primitive.positions.count - begin);
+				tasks.push_back(GltfTask{.primitive = i, .indices = false, .begin = begin, .end = end});
+				begin = end;
+			}
+
+			for (uint32_t begin = 0; begin < primitive.index_count;) {
+				const uint32_t end = begin + std::min(indices_per_task, primitive.index_count - begin);
+				tasks.push_back(GltfTask{.primitive = i, .indices = true, .begin = begin, .end = end});
+				begin = end;
+			}
+		}
+
+		runParallel(tasks.size(), errors, [&](size_t i) {
+			emitGltfTask(tasks[i], primitives[tasks[i].primitive], target, options);
+		});
+		errors.rethrow(path);
+	}
+
+} // namespace
+
+void importMesh(const char* path, const MeshImportTarget& target, const MeshImportOptions& options) {
+	if (hasExtension(path, ".obj")) {
+		importObj(path, target, options);
+	} else if (hasExtension(path, ".gltf") || hasExtension(path, ".glb")) {
+		importGltf(path, target, options);
+	} else {
+		throw std::runtime_error(std::string("Unknown mesh format of ") + path);
+	}
+}
+
+} // namespace veekay::graphics
@@ -0,0 +1,423 @@
+#include <veekay/mesh_optimizer.hpp>
+
+#include <vector>
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace veekay::graphics {
+
+namespace {
+
+	constexpr uint32_t unused = UINT32_MAX;
+
+	// NOTE: Triangles using each vertex, as offsets into a flat list
+	struct Adjacency {
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+
+		Adjacency(const uint32_t* indices, size_t index_count, size_t vertex_count)
+		: offsets(vertex_count + 1, 0), triangles(index_count) {
+			for (size_t i = 0; i < index_count; ++i) {
+				++offsets[indices[i] + 1];
+			}
+
+			std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+			std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+
+			for (size_t i = 0; i < index_count; ++i) {
+				triangles[cursor[indices[i]]++] = uint32_t(i / 3);
+			}
+		}
+
+		uint32_t count(uint32_t vertex) const {
+			return offsets[vertex + 1] - offsets[vertex];
+		}
+	};
+
+	void validate(const uint32_t* indices, size_t index_count, size_t vertex_count) {
+		if (index_count % 3 != 0) {
+			throw std::runtime_error("Index count must be a multiple of three");
+		}
+
+		for (size_t i = 0; i < index_count; ++i) {
+			if (indices[i] >= vertex_count) {
+				throw std::runtime_error("Mesh index is out of vertex range");
+			}
+		}
+	}
+
+	// NOTE: FNV-1a over vertex bytes
+	struct VertexHasher {
+		const char* vertices;
+		size_t stride;
+
+		size_t operator()(uint32_t index) const {
+			const char* bytes = vertices + size_t(index) * stride;
+			uint64_t hash = 14695981039346656037ull;
+
+			for (size_t i = 0; i < stride; ++i) {
+				hash = (hash ^ uint8_t(bytes[i])) * 1099511628211ull;
+			}
+
+			return size_t(hash);
+		}
+	};
+
+	struct VertexEqual {
+		const char* vertices;
+		size_t stride;
+
+		bool operator()(uint32_t lhs, uint32_t rhs) const {
+			return std::memcmp(vertices + size_t(lhs) * stride,
+			                   vertices + size_t(rhs) * stride, stride) == 0;
+		}
+	};
+
+	const vec3& positionOf(const vec3* positions, size_t stride, uint32_t vertex) {
+		return *reinterpret_cast<const vec3*>(reinterpret_cast<const char*>(positions) +
+		                                      size_t(vertex) * stride);
+	}
+
+} // namespace
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t index_count,
+                                    size_t vertex_count, uint32_t cache_size) {
+	// NOTE: Vertex is in cache while fewer than cache_size misses happened since it was loaded
+	std::vector<uint32_t> loaded_at(vertex_count, 0);
+	uint32_t time = cache_size + 1;
+
+	VertexCacheStats stats{};
+
+	for (size_t i = 0; i < index_count; ++i) {
+		const uint32_t vertex = indices[i];
+
+		if (time - loaded_at[vertex] > cache_size) {
+			loaded_at[vertex] = time++;
+			++stats.misses;
+		}
+	}
+
+	const size_t triangle_count = index_count / 3;
+
+	stats.acmr = triangle_count ? float(stats.misses) / float(triangle_count) : 0.0f;
+	stats.atvr = vertex_count ? float(stats.misses) / float(vertex_count) : 0.0f;
+
+	return stats;
+}
+
+size_t generateVertexRemap(uint32_t* remap, const void* vertices,
+                           size_t vertex_count, size_t stride) {
+	const char* bytes = static_cast<const char*>(vertices);
+
+	std::unordered_map<uint32_t, uint32_t, VertexHasher, VertexEqual> unique(
+		vertex_count, VertexHasher{bytes, stride}, VertexEqual{bytes, stride});
+
+	uint32_t next = 0;
+
+	for (uint32_t i = 0; i < uint32_t(vertex_count); ++i) {
+		auto [it, inserted] = unique.try_emplace(i, next);
+
+		if (inserted) {
+			++next;
+		}
+
+		remap[i] = it->second;
+	}
+
+	return next;
+}
+
+void remapVertices(void* destination, const void* vertices, size_t vertex_count,
+                   size_t stride, const uint32_t* remap) {
+	const char* source = static_cast<const char*>(vertices);
+	char* target = static_cast<char*>(destination);
+
+	for (size_t i = 0; i < vertex_count; ++i) {
+		if (remap[i] != unused) {
+			std::memcpy(target + size_t(remap[i]) * stride, source + i * stride, stride);
+		}
+	}
+}
+
+void remapIndices(uint32_t* destination, const uint32_t* indices, size_t index_count,
+                  const uint32_t* remap) {
+	for (size_t i = 0; i < index_count; ++i) {
+		destination[i] = remap[indices[i]];
+	}
+}
+
+void optimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t index_count,
+                         size_t vertex_count, uint32_t cache_size) {
+	validate(indices, index_count, vertex_count);
+
+	const std::vector<uint32_t> source(indices, indices + index_count);
+	const Adjacency adjacency(source.data(), index_count, vertex_count);
+
+	std::vector<uint32_t> live(vertex_count);
+	std::vector<uint32_t> loaded_at(vertex_count, 0);
+	std::vector<bool> emitted(index_count / 3, false);
+
+	for (uint32_t v = 0; v < vertex_count; ++v) {
+		live[v] = adjacency.count(v);
+	}
+
+	std::vector<uint32_t> dead_end;
+	std::vector<uint32_t> candidates;
+
+	uint32_t time = cache_size + 1;
+	uint32_t cursor = 0;
+	size_t output = 0;
+
+	int64_t fan = vertex_count > 0 ? 0 : -1;
+
+	while (fan >= 0) {
+		candidates.clear();
+
+		// NOTE: Emit every remaining triangle around fanning vertex
+		for (uint32_t k = adjacency.offsets[fan]; k < adjacency.offsets[fan + 1]; ++k) {
+			const uint32_t triangle = adjacency.triangles[k];
+
+			if (emitted[triangle]) {
+				continue;
+			}
+
+			emitted[triangle] = true;
+
+			for (uint32_t j = 0; j < 3; ++j) {
+				const uint32_t vertex = source[triangle * 3 + j];
+
+				destination[output++] = vertex;
+				dead_end.push_back(vertex);
+				candidates.push_back(vertex);
+				--live[vertex];
+
+				if (time - loaded_at[vertex] > cache_size) {
+					loaded_at[vertex] = time++;
+				}
+			}
+		}
+
+		// NOTE: Prefer a candidate that stays in cache while its fan is emitted
+		fan = -1;
+		int64_t best = -1;
+
+		for (uint32_t vertex : candidates) {
+			if (live[vertex] == 0) {
+				continue;
+			}
+
+			int64_t priority = 0;
+
+			if (time - loaded_at[vertex] + 2 * live[vertex] <= cache_size) {
+				priority = time - loaded_at[vertex];
+			}
+
+			if (priority > best) {
+				best = priority;
+				fan = vertex;
+			}
+		}
+
+		if (fan >= 0) {
+			continue;
+		}
+
+		// NOTE: Dead end, go back to recently used vertices, then scan for any left
+		while (!dead_end.empty() && fan < 0) {
+			const uint32_t vertex = dead_end.back();
+			dead_end.pop_back();
+
+			if (live[vertex] > 0) {
+				fan = vertex;
+			}
+		}
+
+		while (cursor < vertex_count && fan < 0) {
+			if (live[cursor] > 0) {
+				fan = cursor;
+			}
+
+			++cursor;
+		}
+	}
+}
+
+void optimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t index_count,
+                      const vec3* positions, size_t vertex_count, size_t position_stride,
+                      uint32_t cache_size) {
+	validate(indices, index_count, vertex_count);
+
+	const std::vector<uint32_t> source(indices, indices + index_count);
+	const size_t triangle_count = index_count / 3;
+
+	if (triangle_count == 0) {
+		return;
+	}
+
+	// NOTE: Cluster starts with a triangle that misses all of its vertices
+	std::vector<uint32_t> cluster_starts;
+
+	{
+		std::vector<uint32_t> loaded_at(vertex_count, 0);
+		uint32_t time = cache_size + 1;
+
+		for (size_t t = 0; t < triangle_count; ++t) {
+			uint32_t misses = 0;
+
+			for (size_t j = 0; j < 3; ++j) {
+				const uint32_t vertex = source[t * 3 + j];
+
+				if (time - loaded_at[vertex] > cache_size) {
+					loaded_at[vertex] = time++;
+					++misses;
+				}
+			}
+
+			if (misses == 3 || t == 0) {
+				cluster_starts.push_back(uint32_t(t));
+			}
+		}
+
+		cluster_starts.push_back(uint32_t(triangle_count));
+	}
+
+	const size_t cluster_count = cluster_starts.size() - 1;
+
+	// NOTE: Area weighted centroids and normals
+	std::vector<vec3> centroids(cluster_count, vec3{});
+	std::vector<vec3> normals(cluster_count, vec3{});
+
+	vec3 mesh_centroid = {};
+	float mesh_area = 0.0f;
+
+	for (size_t c = 0; c < cluster_count; ++c) {
+		float cluster_area = 0.0f;
+
+		for (uint32_t t = cluster_starts[c]; t < cluster_starts[c + 1]; ++t) {
+			const vec3& a = positionOf(positions, position_stride, source[t * 3 + 0]);
+			const vec3& b = positionOf(positions, position_stride, source[t * 3 + 1]);
+			const vec3& c_ = positionOf(positions, position_stride, source[t * 3 + 2]);
+
+			// NOTE: Clockwise front faces, so this one points outside
+			const vec3 normal = vec3::cross(c_ - a, b - a);
+			const float area = vec3::length(normal);
+			const vec3 center = (a + b + c_) / 3.0f;
+
+			centroids[c] += center * area;
+			normals[c] += normal;
+			cluster_area += area;
+		}
+
+		mesh_centroid += centroids[c];
+		mesh_area += cluster_area;
+
+		if (cluster_area > 0.0f) {
+			centroids[c] /= cluster_area;
+		}
+	}
+
+	if (mesh_area > 0.0f) {
+		mesh_centroid /= mesh_area;
+	}
+
+	std::vector<float> sort_keys(cluster_count);
+
+	for (size_t c = 0; c < cluster_count; ++c) {
+		const float length = vec3::length(normals[c]);
+		const vec3 normal = length > 0.0f ? normals[c] / length : vec3{};
+
+		sort_keys[c] = vec3::dot(centroids[c] - mesh_centroid, normal);
+	}
+
+	std::vector<uint32_t> order(cluster_count);
+	std::iota(order.begin(), order.end(), 0);
+
+	std::stable_sort(order.begin(), order.end(), [&sort_keys](uint32_t lhs, uint32_t rhs) {
+		return sort_keys[lhs] > sort_keys[rhs];
+	});
+
+	size_t output = 0;
+
+	for (uint32_t c : order) {
+		for (uint32_t t = cluster_starts[c]; t < cluster_starts[c + 1]; ++t) {
+			destination[output++] = source[t * 3 + 0];
+			destination[output++] = source[t * 3 + 1];
+			destination[output++] = source[t * 3 + 2];
+		}
+	}
+
+	// NOTE: Vertices left in cache by a cluster's new predecessor differ from the old
+	//       ones, which usually only saves misses, but nothing guarantees it
+	const uint32_t misses_before = analyzeVertexCache(source.data(), index_count,
+	                                                  vertex_count, cache_size).misses;
+	const uint32_t misses_after = analyzeVertexCache(destination, index_count,
+	                                                 vertex_count, cache_size).misses;
+
+	if (misses_after > misses_before) {
+		std::copy(source.begin(), source.end(), destination);
+	}
+}
+
+size_t optimizeVertexFetch(void* destination, uint32_t* indices, size_t index_count,
+                           const void* vertices, size_t vertex_count, size_t stride) {
+	validate(indices, index_count, vertex_count);
+
+	std::vector<uint32_t> remap(vertex_count, unused);
+	uint32_t next = 0;
+
+	for (size_t i = 0; i < index_count; ++i) {
+		uint32_t& target = remap[indices[i]];
+
+		if (target == unused) {
+			target = next++;
+		}
+
+		indices[i] = target;
+	}
+
+	remapVertices(destination, vertices, vertex_count, stride, remap.data());
+
+	return next;
+}
+
+MeshOptimizationReport optimizeMesh(void* vertices, size_t& vertex_count, size_t stride,
+                                    size_t position_offset,
+                                    uint32_t* indices, size_t index_count) {
+	validate(indices, index_count, vertex_count);
+
+	MeshOptimizationReport report{
+		.vertices_before = vertex_count,
+		.before = analyzeVertexCache(indices, index_count, vertex_count),
+	};
+
+	char* bytes = static_cast<char*>(vertices);
+	std::vector<char> scratch(bytes, bytes + vertex_count * stride);
+
+	{
+		std::vector<uint32_t> remap(vertex_count);
+		vertex_count = generateVertexRemap(remap.data(), scratch.data(), vertex_count, stride);
+
+		remapVertices(bytes, scratch.data(), remap.size(), stride, remap.data());
+		remapIndices(indices, indices, index_count, remap.data());
+	}
+
+	optimizeVertexCache(indices, indices, index_count, vertex_count);
+
+	const vec3* positions = reinterpret_cast<const vec3*>(bytes + position_offset);
+	optimizeOverdraw(indices, indices, index_count, positions, vertex_count, stride);
+
+	scratch.assign(bytes, bytes + vertex_count * stride);
+	vertex_count = optimizeVertexFetch(bytes, indices, index_count,
+	                                   scratch.data(), vertex_count, stride);
+
+	report.vertices_after = vertex_count;
+	report.after = analyzeVertexCache(indices, index_count, vertex_count);
+
+	return report;
+}
+
+} // namespace veekay::graphics
@@ -0,0 +1,748 @@
+#include <veekay/meshes.hpp>
+#include <veekay/vertices.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <veekay/application.hpp>
+#include <vulkan/vulkan_core.h>
+
+#include "free_list.hpp"
+
+namespace veekay::graphics {
+
+std::vector<uint32_t> readShader(const char* path);
+
+struct MeshArenaState {
+	uint32_t vertex_stride;
+
+	VkIndexType index_type;
+	uint32_t index_size;
+
+	Buffer* vertex_buffer;
+	Buffer* index_buffer;
+
+	// NOTE: Ranges are counted in vertices and indices, not bytes
+	FreeList vertices;
+	FreeList indices;
+
+	// NOTE: Bumped whenever meshes move, deferred frees of an older layout are dropped
+	uint64_t layout;
+
+	std::vector<MeshRange> ranges;
+	std::vector<bool> live;
+	std::vector<MeshId> free_ids;
+	uint32_t mesh_count;
+};
+
+namespace {
+
+	constexpr VkBufferUsageFlags vertex_usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+	                                            VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+	                                            VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	// NOTE: Storage for widen shader, which writes 32-bit indices
+	constexpr VkBufferUsageFlags index_usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+	                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+	                                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+	                                           VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	// NOTE: Regions per vkCmdCopyBuffer when widening indices without the shader
+	constexpr size_t widen_batch = 65536;
+
+	constexpr uint32_t widen_group_size = 256; // NOTE: Must match widen.comp
+	constexpr uint32_t max_group_count = 65535; // NOTE: Guaranteed per dimension
+
+	VkDescriptorSetLayout widen_descriptor_set_layout;
+	VkPipelineLayout widen_pipeline_layout;
+	VkPipeline widen_pipeline; // NOTE: VK_NULL_HANDLE when indices are widened by copies
+
+	// NOTE: Expands count packed 16-bit indices of source into 32-bit ones at the start
+	//       of destination. Source must be readable by compute shaders already
+	void recordWiden(VkCommandBuffer cmd, Buffer* source, Buffer* destination, uint32_t count) {
+		VkDevice& device = veekay::app.vk_device;
+
+		VkDescriptorPool pool;
+
+		{
+			VkDescriptorPoolSize size{
+				.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 2,
+			};
+
+			VkDescriptorPoolCreateInfo info{
+				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+				.maxSets = 1,
+				.poolSizeCount = 1,
+				.pPoolSizes = &size,
+			};
+
+			if (vkCreateDescriptorPool(device, &info, nullptr, &pool) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create Vulkan index widen descriptor pool");
+			}
+		}
+
+		VkDescriptorSet set;
+
+		{
+			VkDescriptorSetAllocateInfo info{
+				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+				.descriptorPool = pool,
+				.descriptorSetCount = 1,
+				.pSetLayouts = &widen_descriptor_set_layout,
+			};
+
+			if (vkAllocateDescriptorSets(device, &info, &set) != VK_SUCCESS) {
+				vkDestroyDescriptorPool(device, pool, nullptr);
+				throw std::runtime_error("Failed to allocate Vulkan index widen descriptor set");
+			}
+		}
+
+		{
+			VkDescriptorBufferInfo buffers[] = {
+				{.buffer = source->buffer, .offset = 0, .range = VK_WHOLE_SIZE},
+				{.buffer = destination->buffer, .offset = 0, .range = VK_WHOLE_SIZE},
+			};
+
+			VkWriteDescriptorSet writes[] = {
+				{
+					.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+					.dstSet = set,
+					.dstBinding = 0,
+					.descriptorCount = 1,
+					.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+					.pBufferInfo = &buffers[0],
+				},
+				{
+					.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+					.dstSet = set,
+					.dstBinding = 1,
+					.descriptorCount = 1,
+					.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+					.pBufferInfo = &buffers[1],
+				},
+			};
+
+			vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+		}
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, widen_pipeline);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, widen_pipeline_layout,
+		                        0, 1, &set, 0, nullptr);
+		vkCmdPushConstants(cmd, widen_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT,
+		                   0, sizeof(count), &count);
+
+		const uint32_t pairs = (count + 1) / 2;
+		const uint32_t groups = (pairs + widen_group_size - 1) / widen_group_size;
+		const uint32_t groups_x = std::min(groups, max_group_count);
+
+		vkCmdDispatch(cmd, groups_x, (groups + groups_x - 1) / groups_x, 1);
+
+		// NOTE: Draws and later relocations read widened indices
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_INDEX_READ_BIT |
+			                 VK_ACCESS_TRANSFER_READ_BIT |
+			                 VK_ACCESS_TRANSFER_WRITE_BIT,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		releaseAfterSubmit([source, pool] {
+			vkDestroyDescriptorPool(veekay::app.vk_device, pool, nullptr);
+			delete source;
+		});
+	}
+
+	Buffer* createBuffer(uint64_t size, VkBufferUsageFlags usage) {
+		return new Buffer(std::max(size, uint64_t(4)), nullptr, usage, BufferPlacement::device);
+	}
+
+	// NOTE: Copies into arena buffers become visible to draws and later relocations
+	void makeVisible(VkCommandBuffer cmd) {
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+			                 VK_ACCESS_INDEX_READ_BIT |
+			                 VK_ACCESS_TRANSFER_READ_BIT,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	// NOTE: Returns staging memory the copy reads from
+	void* recordCopy(VkCommandBuffer cmd, Buffer* buffer, VkDeviceSize offset,
+	                 VkDeviceSize size, VkDeviceSize alignment) {
+		StagingAllocation staging = allocateStaging(size, alignment);
+
+		VkBufferCopy region{
+			.srcOffset = staging.offset,
+			.dstOffset = offset,
+			.size = size,
+		};
+
+		vkCmdCopyBuffer(cmd, staging.buffer, buffer->buffer, 1, &region);
+
+		return staging.mapped;
+	}
+
+	// NOTE: Between 16 and 32-bit, indices must fit destination type
+	void convertIndices(const void* indices, VkIndexType type, uint32_t count,
+	                    VkIndexType out_type, void* out) {
+		if (type == out_type) {
+			std::copy(static_cast<const char*>(indices),
+			          static_cast<const char*>(indices) + size_t(count) * indexSize(type),
+			          static_cast<char*>(out));
+		} else if (type == VK_INDEX_TYPE_UINT16) {
+			const uint16_t* in = static_cast<const uint16_t*>(indices);
+			std::copy(in, in + count, static_cast<uint32_t*>(out));
+		} else {
+			packIndices(static_cast<const uint32_t*>(indices), count, out_type, out);
+		}
+	}
+
+	template <typename Index>
+	bool indicesInRange(const void* indices, uint32_t count, uint32_t vertex_count) {
+		const Index* in = static_cast<const Index*>(indices);
+
+		bool valid = true;
+
+		for (uint32_t i = 0; i < count; ++i) {
+			valid &= in[i] < vertex_count;
+		}
+
+		return valid;
+	}
+
+	float fragmentationOf(const FreeList& list) {
+		return list.freeBytes() == 0 ? 0.0f
+		       : 1.0f - float(list.largestRange()) / float(list.freeBytes());
+	}
+
+} // namespace
+
+MeshArena::MeshArena(uint32_t vertex_stride, uint32_t vertex_capacity, uint32_t index_capacity,
+                     VkIndexType index_type)
+: state{std::make_shared<MeshArenaState>()} {
+	if (vertex_stride == 0 || vertex_capacity == 0 || index_capacity == 0) {
+		throw std::runtime_error("Mesh arena must have non-zero stride and capacity");
+	}
+
+	state->vertex_stride = vertex_stride;
+	state->index_type = index_type;
+	state->index_size = indexSize(index_type);
+	state->vertex_buffer = createBuffer(uint64_t(vertex_capacity) * vertex_stride, vertex_usage);
+	state->index_buffer = createBuffer(uint64_t(index_capacity) * state->index_size, index_usage);
+	state->vertices.reset(vertex_capacity);
+	state->indices.reset(index_capacity);
+	state->layout = 0;
+	state->mesh_count = 0;
+}
+
+MeshArena::~MeshArena() {
+	// NOTE: Frames still in flight may draw from these
+	releaseAfterSubmit([vertex_buffer = state->vertex_buffer,
+	                    index_buffer = state->index_buffer] {
+		delete vertex_buffer;
+		delete index_buffer;
+	});
+}
+
+MeshId MeshArena::add(VkCommandBuffer cmd,
+                      const void* vertices, uint32_t vertex_count,
+                      const uint32_t* indices, uint32_t index_count) {
+	// NOTE: Checked upfront, so packing indices below can't fail halfway
+	for (uint32_t i = 0; i < index_count; ++i) {
+		if (indices[i] >= vertex_count) {
+			throw std::runtime_error("Mesh index is out of vertex range");
+		}
+	}
+
+	void* vertex_data;
+	void* index_data;
+
+	const MeshId id = reserve(cmd, vertex_count, index_count, vertex_data, index_data);
+
+	std::copy(static_cast<const char*>(vertices),
+	          static_cast<const char*>(vertices) + size_t(vertex_count) * state->vertex_stride,
+	          static_cast<char*>(vertex_data));
+
+	packIndices(indices, index_count, state->index_type, index_data);
+
+	return id;
+}
+
+MeshId MeshArena::add(VkCommandBuffer cmd, const MeshFile& file) {
+	const MeshFileHeader& header = file.header();
+
+	if (header.vertex_stride != state->vertex_stride) {
+		throw std::runtime_error("Mesh file layout doesn't match mesh arena");
+	}
+
+	const uint32_t vertex_count = header.vertex_count;
+	const uint32_t index_count = header.index_count;
+
+	// NOTE: File comes from disk, an out of range index must not reach the GPU
+	const bool valid = file.indexType() == VK_INDEX_TYPE_UINT16
+	                   ? indicesInRange<uint16_t>(file.indices(), index_count, vertex_count)
+	                   : indicesInRange<uint32_t>(file.indices(), index_count, vertex_count);
+
+	if (!valid) {
+		throw std::runtime_error("Mesh index is out of vertex range");
+	}
+
+	void* vertex_data;
+	void* index_data;
+
+	const MeshId id = reserve(cmd, vertex_count, index_count, vertex_data, index_data);
+
+	const char* vertices = static_cast<const char*>(file.vertices());
+
+	std::copy(vertices, vertices + size_t(vertex_count) * state->vertex_stride,
+	          static_cast<char*>(vertex_data));
+
+	// NOTE: Reserve widened arena if file needed it, otherwise every index fits
+	convertIndices(file.indices(), file.indexType(), index_count, state->index_type, index_data);
+
+	return id;
+}
+
+MeshId MeshArena::importFile(VkCommandBuffer cmd, const char* path, QuantizationBounds& quantization,
+                             const MeshImportOptions& options) {
+	if (state->vertex_stride != sizeof(QuantizedVertex)) {
+		throw std::runtime_error("Mesh arena must hold quantized vertices to import meshes");
+	}
+
+	MeshId id = 0;
+	bool reserved = false;
+
+	void* vertex_data = nullptr;
+	void* index_data = nullptr;
+
+	const MeshImportTarget target{
+		.begin = [&](const MeshImportInfo& info) {
+			quantization = quantizationBounds(info.bounds_min, info.bounds_max);
+			id = reserve(cmd, info.vertex_count, info.index_count, vertex_data, index_data);
+			reserved = true;
+		},
+
+		// NOTE: Runs on job threads, chunks write disjoint parts of staging memory
+		.write = [&](const MeshImportChunk& chunk) {
+			QuantizedVertex* vertices = static_cast<QuantizedVertex*>(vertex_data) + chunk.first_vertex;
+
+			for (uint32_t i = 0; i < chunk.vertex_count; ++i) {
+				const ImportedVertex& vertex = chunk.vertices[i];
+				vertices[i] = quantizeVertex(quantization, vertex.position, vertex.normal, vertex.uv);
+			}
+
+			packIndices(chunk.indices, chunk.index_count, state->index_type,
+			            static_cast<char*>(index_data) + size_t(chunk.first_index) * state->index_size);
+		},
+	};
+
+	try {
+		importMesh(path, target, options);
+	} catch (...) {
+		// NOTE: Copies are recorded already, but nothing draws a mesh that was never returned
+		if (reserved) {
+			remove(id);
+		}
+
+		throw;
+	}
+
+	return id;
+}
+
+MeshId MeshArena::reserve(VkCommandBuffer cmd, uint32_t vertex_count, uint32_t index_count,
+                          void*& vertex_data, void*& index_data) {
+	if (vertex_count == 0 || index_count == 0) {
+		throw std::runtime_error("Mesh must have vertices and indices");
+	}
+
+	if (state->index_type == VK_INDEX_TYPE_UINT16 && vertex_count > 65536) {
+		relocate(cmd, uint32_t(state->vertices.capacity()), uint32_t(state->indices.capacity()),
+		         VK_INDEX_TYPE_UINT32);
+	}
+
+	uint64_t vertex_offset = state->vertices.allocate(vertex_count);
+	uint64_t index_offset = state->indices.allocate(index_count);
+
+	if (vertex_offset == FreeList::invalid_offset || index_offset == FreeList::invalid_offset) {
+		if (vertex_offset != FreeList::invalid_offset) {
+			state->vertices.free(vertex_offset, vertex_count);
+		}
+
+		if (index_offset != FreeList::invalid_offset) {
+			state->indices.free(index_offset, index_count);
+		}
+
+		// NOTE: Relocation packs meshes, so room at the end is everything not used
+		const uint64_t vertex_capacity = std::max(state->vertices.capacity() * 2,
+		                                          state->vertices.usedBytes() + vertex_count);
+		const uint64_t index_capacity = std::max(state->indices.capacity() * 2,
+		                                         state->indices.usedBytes() + index_count);
+
+		if (vertex_capacity > INT32_MAX || index_capacity > UINT32_MAX) {
+			throw std::runtime_error("Mesh arena is too large");
+		}
+
+		relocate(cmd, uint32_t(vertex_capacity), uint32_t(index_capacity), state->index_type);
+
+		vertex_offset = state->vertices.allocate(vertex_count);
+		index_offset = state->indices.allocate(index_count);
+	}
+
+	// NOTE: Host writes before submission are visible to it, so staging may be filled later
+	vertex_data = recordCopy(cmd, state->vertex_buffer, vertex_offset * state->vertex_stride,
+	                         uint64_t(vertex_count) * state->vertex_stride, state->vertex_stride);
+	index_data = recordCopy(cmd, state->index_buffer, index_offset * state->index_size,
+	                        uint64_t(index_count) * state->index_size, state->index_size);
+
+	makeVisible(cmd);
+
+	const MeshRange range{
+		.first_index = uint32_t(index_offset),
+		.index_count = index_count,
+		.vertex_offset = int32_t(vertex_offset),
+		.vertex_count = vertex_count,
+	};
+
+	MeshId id;
+
+	if (state->free_ids.empty()) {
+		id = MeshId(state->ranges.size());
+		state->ranges.push_back(range);
+		state->live.push_back(true);
+	} else {
+		id = state->free_ids.back();
+		state->free_ids.pop_back();
+		state->ranges[id] = range;
+		state->live[id] = true;
+	}
+
+	++state->mesh_count;
+
+	return id;
+}
+
+void MeshArena::remove(MeshId id) {
+	if (id >= state->live.size() || !state->live[id]) {
+		throw std::runtime_error("Mesh is not in arena");
+	}
+
+	state->live[id] = false;
+	state->free_ids.push_back(id);
+	--state->mesh_count;
+
+	// NOTE: Arena may be gone by then, state outlives it only to drop the free
+	releaseAfterSubmit([weak = std::weak_ptr(state), layout = state->layout,
+	                    range = state->ranges[id]] {
+		auto state = weak.lock();
+
+		if (!state || state->layout != layout) {
+			return;
+		}
+
+		state->vertices.free(uint64_t(range.vertex_offset), range.vertex_count);
+		state->indices.free(range.first_index, range.index_count);
+	});
+}
+
+const MeshRange& MeshArena::range(MeshId id) const {
+	return state->ranges[id];
+}
+
+void MeshArena::compact(VkCommandBuffer cmd) {
+	relocate(cmd, uint32_t(state->vertices.capacity()), uint32_t(state->indices.capacity()),
+	         state->index_type);
+}
+
+void MeshArena::relocate(VkCommandBuffer cmd, uint32_t vertex_capacity, uint32_t index_capacity,
+                         VkIndexType index_type) {
+	const uint32_t stride = state->vertex_stride;
+	const uint32_t old_index_size = state->index_size;
+	const uint32_t index_size = indexSize(index_type);
+
+	// NOTE: Only ever 16 to 32-bit
+	const bool widen = index_size != old_index_size;
+
+	Buffer* vertex_buffer = createBuffer(uint64_t(vertex_capacity) * stride, vertex_usage);
+	Buffer* index_buffer = createBuffer(uint64_t(index_capacity) * index_size, index_usage);
+
+	// NOTE: With the shader, live indices are packed into scratch buffer with a copy
+	//       per mesh and expanded by one dispatch. Without it every index is copied
+	//       on its own over low half of a zeroed 32-bit one, little-endian
+	const bool widen_copies = widen && widen_pipeline == VK_NULL_HANDLE;
+
+	Buffer* scratch = nullptr;
+	Buffer* index_target = index_buffer;
+
+	if (widen && !widen_copies && state->mesh_count > 0) {
+		const uint64_t used = state->indices.usedBytes();
+
+		scratch = createBuffer((used + 1) / 2 * 4, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+		                                           VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		index_target = scratch;
+	}
+
+	if (state->mesh_count > 0) {
+		// NOTE: Earlier copies into old buffers may still be running
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+		};
+
+		if (widen_copies) {
+			vkCmdFillBuffer(cmd, index_buffer->buffer, 0, VK_WHOLE_SIZE, 0);
+		}
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	std::vector<VkBufferCopy> vertex_regions;
+	std::vector<VkBufferCopy> index_regions;
+
+	auto flush_widened = [&] {
+		if (widen_copies && !index_regions.empty()) {
+			vkCmdCopyBuffer(cmd, state->index_buffer->buffer, index_buffer->buffer,
+			                uint32_t(index_regions.size()), index_regions.data());
+			index_regions.clear();
+		}
+	};
+
+	// NOTE: Offsets are packed in mesh order, removed meshes are left behind
+	uint32_t vertex_offset = 0;
+	uint32_t index_offset = 0;
+
+	for (size_t id = 0; id < state->ranges.size(); ++id) {
+		if (!state->live[id]) {
+			continue;
+		}
+
+		MeshRange& range = state->ranges[id];
+
+		vertex_regions.push_back(VkBufferCopy{
+			.srcOffset = uint64_t(range.vertex_offset) * stride,
+			.dstOffset = uint64_t(vertex_offset) * stride,
+			.size = uint64_t(range.vertex_count) * stride,
+		});
+
+		if (widen_copies) {
+			for (uint32_t i = 0; i < range.index_count; ++i) {
+				index_regions.push_back(VkBufferCopy{
+					.srcOffset = uint64_t(range.first_index + i) * old_index_size,
+					.dstOffset = uint64_t(index_offset + i) * index_size,
+					.size = old_index_size,
+				});
+
+				if (index_regions.size() == widen_batch) {
+					flush_widened();
+				}
+			}
+		} else {
+			index_regions.push_back(VkBufferCopy{
+				.srcOffset = uint64_t(range.first_index) * old_index_size,
+				.dstOffset = uint64_t(index_offset) * old_index_size,
+				.size = uint64_t(range.index_count) * old_index_size,
+			});
+		}
+
+		// NOTE: Indices are relative to first vertex, so they stay as they are
+		range.vertex_offset = int32_t(vertex_offset);
+		range.first_index = index_offset;
+
+		vertex_offset += range.vertex_count;
+		index_offset += range.index_count;
+	}
+
+	flush_widened();
+
+	if (!vertex_regions.empty()) {
+		vkCmdCopyBuffer(cmd, state->vertex_buffer->buffer, vertex_buffer->buffer,
+		                uint32_t(vertex_regions.size()), vertex_regions.data());
+
+		if (!index_regions.empty()) {
+			vkCmdCopyBuffer(cmd, state->index_buffer->buffer, index_target->buffer,
+			                uint32_t(index_regions.size()), index_regions.data());
+		}
+
+		makeVisible(cmd);
+	}
+
+	if (scratch) {
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+		};
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		recordWiden(cmd, scratch, index_buffer, index_offset);
+	}
+
+	releaseAfterSubmit([old_vertex_buffer = state->vertex_buffer,
+	                    old_index_buffer = state->index_buffer] {
+		delete old_vertex_buffer;
+		delete old_index_buffer;
+	});
+
+	state->vertex_buffer = vertex_buffer;
+	state->index_buffer = index_buffer;
+
+	state->index_type = index_type;
+	state->index_size = index_size;
+
+	state->vertices.reset(vertex_capacity);
+	state->indices.reset(index_capacity);
+
+	if (vertex_offset > 0) {
+		state->vertices.allocate(vertex_offset);
+		state->indices.allocate(index_offset);
+	}
+
+	++state->layout;
+}
+
+void MeshArena::bind(VkCommandBuffer cmd) const {
+	VkDeviceSize zero_offset = 0;
+
+	vkCmdBindVertexBuffers(cmd, 0, 1, &state->vertex_buffer->buffer, &zero_offset);
+	vkCmdBindIndexBuffer(cmd, state->index_buffer->buffer, zero_offset, state->index_type);
+}
+
+Buffer* MeshArena::vertexBuffer() const {
+	return state->vertex_buffer;
+}
+
+Buffer* MeshArena::indexBuffer() const {
+	return state->index_buffer;
+}
+
+VkIndexType MeshArena::indexType() const {
+	return state->index_type;
+}
+
+uint32_t MeshArena::meshCount() const {
+	return state->mesh_count;
+}
+
+float MeshArena::fragmentation() const {
+	return std::max(fragmentationOf(state->vertices), fragmentationOf(state->indices));
+}
+
+// NOTE: Missing shader just means 16-bit indices are widened by copies
+void initMeshes(const char* shader_path) {
+	VkDevice& device = veekay::app.vk_device;
+
+	const std::vector<uint32_t> code = readShader(shader_path);
+
+	if (code.empty()) {
+		return;
+	}
+
+	{
+		VkDescriptorSetLayoutBinding bindings[] = {
+			{
+				.binding = 0,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+			{
+				.binding = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+		};
+
+		VkDescriptorSetLayoutCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.bindingCount = sizeof(bindings) / sizeof(bindings[0]),
+			.pBindings = bindings,
+		};
+
+		if (vkCreateDescriptorSetLayout(device, &info, nullptr, &widen_descriptor_set_layout) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Vulkan index widen descriptor set layout");
+		}
+	}
+
+	{
+		VkPushConstantRange push_constants{
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.offset = 0,
+			.size = sizeof(uint32_t),
+		};
+
+		VkPipelineLayoutCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 1,
+			.pSetLayouts = &widen_descriptor_set_layout,
+			.pushConstantRangeCount = 1,
+			.pPushConstantRanges = &push_constants,
+		};
+
+		if (vkCreatePipelineLayout(device, &info, nullptr, &widen_pipeline_layout) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Vulkan index widen pipeline layout");
+		}
+	}
+
+	VkShaderModule module;
+
+	{
+		VkShaderModuleCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+			.codeSize = code.size() * sizeof(uint32_t),
+			.pCode = code.data(),
+		};
+
+		if (vkCreateShaderModule(device, &info, nullptr, &module) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Vulkan index widen shader module");
+		}
+	}
+
+	{
+		// NOTE: Arenas may widen during init, so it's compiled right away
+		VkComputePipelineCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			.stage = {
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+				.module = module,
+				.pName = "main",
+			},
+			.layout = widen_pipeline_layout,
+		};
+
+		if (vkCreateComputePipelines(device, veekay::app.vk_pipeline_cache, 1, &info,
+		                             nullptr, &widen_pipeline) != VK_SUCCESS) {
+			widen_pipeline = VK_NULL_HANDLE;
+		}
+	}
+
+	vkDestroyShaderModule(device, module, nullptr);
+}
+
+void shutdownMeshes() {
+	VkDevice& device = veekay::app.vk_device;
+
+	vkDestroyPipeline(device, widen_pipeline, nullptr);
+	vkDestroyPipelineLayout(device, widen_pipeline_layout, nullptr);
+	vkDestroyDescriptorSetLayout(device, widen_descriptor_set_layout, nullptr);
+
+	widen_pipeline = VK_NULL_HANDLE;
+}
+
+} // namespace veekay::graphics
@@ -0,0 +1,457 @@
+#include <veekay/graphics.hpp>
+
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include <veekay/application.hpp>
+#include <vulkan/vulkan_core.h>
+
+namespace veekay::graphics {
+
+void blitMips(VkCommandBuffer cmd, const Texture& texture);
+
+// NOTE: Objects used by recorded mip dispatches, freed once they complete
+struct MipBatch {
+	Buffer* counters;
+	VkDescriptorPool descriptor_pool;
+	std::vector<VkImageView> views;
+};
+
+namespace {
+
+	constexpr uint32_t tile_size = 32;
+	constexpr uint32_t max_levels = 16; // NOTE: Must match mips.comp
+
+	struct MipParameters {
+		uint32_t width;
+		uint32_t height;
+		uint32_t level_count;
+		uint32_t srgb;
+	};
+
+	VkDescriptorSetLayout descriptor_set_layout;
+	VkPipelineLayout pipeline_layout;
+	VkPipeline pipeline; // NOTE: VK_NULL_HANDLE when mips are blitted
+
+	VkDeviceSize counter_alignment;
+
+	uint32_t tileCount(uint32_t size, uint32_t level) {
+		return (std::max(size >> level, 1u) + tile_size - 1) / tile_size;
+	}
+
+	// NOTE: Shader keeps a counter per tile of levels 2 and above
+	VkDeviceSize counterSize(const Texture& texture) {
+		VkDeviceSize count = 0;
+
+		for (uint32_t i = 2; i < texture.mip_levels; ++i) {
+			count += tileCount(texture.width, i) * tileCount(texture.height, i);
+		}
+
+		return std::max(count, VkDeviceSize(1)) * sizeof(uint32_t);
+	}
+
+	bool isSrgb(VkFormat format) {
+		return format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_B8G8R8A8_SRGB;
+	}
+
+} // namespace
+
+// NOTE: Empty when file is missing or unreadable
+std::vector<uint32_t> readShader(const char* path) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+	if (!file) {
+		return {};
+	}
+
+	const size_t size = size_t(file.tellg());
+	std::vector<uint32_t> code(size / sizeof(uint32_t));
+
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(code.data()), std::streamsize(code.size() * sizeof(uint32_t)));
+
+	return file ? code : std::vector<uint32_t>{};
+}
+
+// NOTE: Shader works on UNORM views, so channel order doesn't matter
+//       and sRGB variants work too
+bool computesMips(VkFormat format) {
+	if (pipeline == VK_NULL_HANDLE) {
+		return false;
+	}
+
+	switch (format) {
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_UNORM:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+uint32_t maxComputedMipLevels() {
+	return max_levels;
+}
+
+// NOTE: Returns nullptr when every texture was blitted
+MipBatch* recordMips(VkCommandBuffer cmd, const Texture* const* textures, size_t count) {
+	VkDevice& device = veekay::app.vk_device;
+
+	std::vector<const Texture*> computed;
+
+	for (size_t i = 0; i < count; ++i) {
+		const Texture* texture = textures[i];
+
+		if (texture->storage && texture->mip_levels <= max_levels) {
+			computed.push_back(texture);
+		} else {
+			blitMips(cmd, *texture);
+		}
+	}
+
+	if (computed.empty()) {
+		return nullptr;
+	}
+
+	MipBatch* batch = new MipBatch{};
+
+	std::vector<VkDeviceSize> counter_offsets(computed.size());
+	VkDeviceSize counters_size = 0;
+
+	for (size_t i = 0; i < computed.size(); ++i) {
+		counter_offsets[i] = counters_size;
+		counters_size += (counterSize(*computed[i]) + counter_alignment - 1) / counter_alignment * counter_alignment;
+	}
+
+	batch->counters = new Buffer(counters_size, nullptr,
+	                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+	                             BufferPlacement::device);
+
+	{
+		VkDescriptorPoolSize sizes[] = {
+			{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, uint32_t(computed.size()) * max_levels},
+			{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, uint32_t(computed.size())},
+		};
+
+		VkDescriptorPoolCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+			.maxSets = uint32_t(computed.size()),
+			.poolSizeCount = sizeof(sizes) / sizeof(sizes[0]),
+			.pPoolSizes = sizes,
+		};
+
+		if (vkCreateDescriptorPool(device, &info, nullptr, &batch->descriptor_pool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Vulkan mip descriptor pool");
+		}
+	}
+
+	std::vector<VkDescriptorSet> sets(computed.size());
+
+	{
+		std::vector<VkDescriptorSetLayout> layouts(computed.size(), descriptor_set_layout);
+
+		VkDescriptorSetAllocateInfo info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+			.descriptorPool = batch->descriptor_pool,
+			.descriptorSetCount = uint32_t(sets.size()),
+			.pSetLayouts = layouts.data(),
+		};
+
+		if (vkAllocateDescriptorSets(device, &info, sets.data()) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate Vulkan mip descriptor sets");
+		}
+	}
+
+	for (size_t i = 0; i < computed.size(); ++i) {
+		const Texture& texture = *computed[i];
+
+		VkDescriptorImageInfo image_infos[max_levels];
+
+		for (uint32_t level = 0; level < texture.mip_levels; ++level) {
+			VkImageViewCreateInfo info{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+				.image = texture.image,
+				.viewType = VK_IMAGE_VIEW_TYPE_2D,
+				.format = VK_FORMAT_R8G8B8A8_UNORM,
+				.subresourceRange = {
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					.baseMipLevel = level,
+					.levelCount = 1,
+					.baseArrayLayer = 0,
+					.layerCount = 1,
+				},
+			};
+
+			VkImageView view;
+
+			if (vkCreateImageView(device, &info, nullptr, &view) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create Vulkan mip level view");
+			}
+
+			batch->views.push_back(view);
+
+			image_infos[level] = VkDescriptorImageInfo{
+				.imageView = view,
+				.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+			};
+		}
+
+		// NOTE: Every element must be valid, unused ones repeat the last level
+		for (uint32_t level = texture.mip_levels; level < max_levels; ++level) {
+			image_infos[level] = image_infos[texture.mip_levels - 1];
+		}
+
+		VkDescriptorBufferInfo buffer_info{
+			.buffer = batch->counters->buffer,
+			.offset = counter_offsets[i],
+			.range = counterSize(texture),
+		};
+
+		VkWriteDescriptorSet writes[] = {
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = sets[i],
+				.dstBinding = 0,
+				.dstArrayElement = 0,
+				.descriptorCount = max_levels,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.pImageInfo = image_infos,
+			},
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = sets[i],
+				.dstBinding = 1,
+				.dstArrayElement = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.pBufferInfo = &buffer_info,
+			},
+		};
+
+		vkUpdateDescriptorSets(device, sizeof(writes) / sizeof(writes[0]), writes, 0, nullptr);
+	}
+
+	vkCmdFillBuffer(cmd, batch->counters->buffer, 0, VK_WHOLE_SIZE, 0);
+
+	// NOTE: One barrier for every texture of the batch, instead of two per level
+	std::vector<VkImageMemoryBarrier> image_barriers(computed.size());
+
+	for (size_t i = 0; i < computed.size(); ++i) {
+		image_barriers[i] = VkImageMemoryBarrier{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.newLayout = VK_IMAGE_LAYOUT_GENERAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = computed[i]->image,
+			.subresourceRange = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = computed[i]->mip_levels,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+		};
+	}
+
+	{
+		VkBufferMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.buffer = batch->counters->buffer,
+			.offset = 0,
+			.size = VK_WHOLE_SIZE,
+		};
+
+		vkCmdPipelineBarrier(cmd,
+		                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     0, 0, nullptr, 1, &barrier,
+		                     uint32_t(image_barriers.size()), image_barriers.data());
+	}
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+	for (size_t i = 0; i < computed.size(); ++i) {
+		const Texture& texture = *computed[i];
+
+		MipParameters parameters{
+			.width = texture.width,
+			.height = texture.height,
+			.level_count = texture.mip_levels,
+			.srgb = isSrgb(texture.format),
+		};
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout,
+		                        0, 1, &sets[i], 0, nullptr);
+		vkCmdPushConstants(cmd, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT,
+		                   0, sizeof(parameters), &parameters);
+
+		// NOTE: One workgroup per tile of level 1, they build the rest between themselves
+		vkCmdDispatch(cmd, tileCount(texture.width, 1), tileCount(texture.height, 1), 1);
+	}
+
+	for (VkImageMemoryBarrier& barrier : image_barriers) {
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+
+	vkCmdPipelineBarrier(cmd,
+	                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+	                     0, 0, nullptr, 0, nullptr,
+	                     uint32_t(image_barriers.size()), image_barriers.data());
+
+	return batch;
+}
+
+void releaseMips(MipBatch* batch) {
+	if (!batch) {
+		return;
+	}
+
+	VkDevice& device = veekay::app.vk_device;
+
+	for (VkImageView view : batch->views) {
+		vkDestroyImageView(device, view, nullptr);
+	}
+
+	vkDestroyDescriptorPool(device, batch->descriptor_pool, nullptr);
+	delete batch->counters;
+	delete batch;
+}
+
+void generateMips(VkCommandBuffer cmd, const Texture* const* textures, size_t count) {
+	MipBatch* batch = recordMips(cmd, textures, count);
+
+	if (batch) {
+		releaseAfterSubmit([batch] { releaseMips(batch); });
+	}
+}
+
+// NOTE: Missing shader or device feature just means mips are blitted,
+//       for power of two textures only
+void initMips(const char* shader_path) {
+	VkDevice& device = veekay::app.vk_device;
+
+	{
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(veekay::app.vk_physical_device, &props);
+
+		counter_alignment = std::max(props.limits.minStorageBufferOffsetAlignment, VkDeviceSize(4));
+	}
+
+	if (!veekay::app.storage_image_array_indexing) {
+		return;
+	}
+
+	const std::vector<uint32_t> code = readShader(shader_path);
+
+	if (code.empty()) {
+		return;
+	}
+
+	{
+		VkDescriptorSetLayoutBinding bindings[] = {
+			{
+				.binding = 0,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.descriptorCount = max_levels,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+			{
+				.binding = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+		};
+
+		VkDescriptorSetLayoutCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.bindingCount = sizeof(bindings) / sizeof(bindings[0]),
+			.pBindings = bindings,
+		};
+
+		if (vkCreateDescriptorSetLayout(device, &info, nullptr, &descriptor_set_layout) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Vulkan mip descriptor set layout");
+		}
+	}
+
+	{
+		VkPushConstantRange push_constants{
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.offset = 0,
+			.size = sizeof(MipParameters),
+		};
+
+		VkPipelineLayoutCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 1,
+			.pSetLayouts = &descriptor_set_layout,
+			.pushConstantRangeCount = 1,
+			.pPushConstantRanges = &push_constants,
+		};
+
+		if (vkCreatePipelineLayout(device, &info, nullptr, &pipeline_layout) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Vulkan mip pipeline layout");
+		}
+	}
+
+	VkShaderModule module;
+
+	{
+		VkShaderModuleCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+			.codeSize = code.size() * sizeof(uint32_t),
+			.pCode = code.data(),
+		};
+
+		if (vkCreateShaderModule(device, &info, nullptr, &module) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Vulkan mip shader module");
+		}
+	}
+
+	{
+		// NOTE: Needed before first texture is created, so it's compiled right away
+		VkComputePipelineCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			.stage = {
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+				.module = module,
+				.pName = "main",
+			},
+			.layout = pipeline_layout,
+		};
+
+		if (vkCreateComputePipelines(device, veekay::app.vk_pipeline_cache, 1, &info,
+		                             nullptr, &pipeline) != VK_SUCCESS) {
+			pipeline = VK_NULL_HANDLE;
+		}
+	}
+
+	vkDestroyShaderModule(device, module, nullptr);
+}
+
+void shutdownMips() {
+	VkDevice& device = veekay::app.vk_device;
+
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+	vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
+
+	pipeline = VK_NULL_HANDLE;
+}
+
+} // namespace veekay::graphics
@@ -0,0 +1,379 @@
+#include <veekay/pipelines.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <string>
+#include <stdexcept>
+
+#include <veekay/jobs.hpp>
+#include <veekay/application.hpp>
+#include <vulkan/vulkan_core.h>
+
+namespace veekay::graphics {
+
+// NOTE: Lives at a fixed address, so pointers inside info stay valid
+struct PipelineBuild {
+	VkGraphicsPipelineCreateInfo info;
+	VkComputePipelineCreateInfo compute_info;
+	bool compute;
+
+	std::vector<VkPipelineShaderStageCreateInfo> stages;
+	std::vector<std::string> entry_points;
+	std::vector<VkSpecializationInfo> specializations;
+	std::vector<std::vector<VkSpecializationMapEntry>> specialization_entries;
+	std::vector<std::vector<char>> specialization_data;
+
+	VkPipelineVertexInputStateCreateInfo vertex_input;
+	std::vector<VkVertexInputBindingDescription> vertex_bindings;
+	std::vector<VkVertexInputAttributeDescription> vertex_attributes;
+
+	VkPipelineInputAssemblyStateCreateInfo input_assembly;
+	VkPipelineTessellationStateCreateInfo tessellation;
+
+	VkPipelineViewportStateCreateInfo viewport;
+	std::vector<VkViewport> viewports;
+	std::vector<VkRect2D> scissors;
+
+	VkPipelineRasterizationStateCreateInfo rasterization;
+
+	VkPipelineMultisampleStateCreateInfo multisample;
+	std::vector<VkSampleMask> sample_mask;
+
+	VkPipelineDepthStencilStateCreateInfo depth_stencil;
+
+	VkPipelineColorBlendStateCreateInfo color_blend;
+	std::vector<VkPipelineColorBlendAttachmentState> blend_attachments;
+
+	VkPipelineDynamicStateCreateInfo dynamic;
+	std::vector<VkDynamicState> dynamic_states;
+
+	VkPipeline pipeline;
+	std::atomic<uint32_t> state;
+	jobs::Handle job;
+};
+
+namespace {
+
+	constexpr uint32_t build_pending = 0;
+	constexpr uint32_t build_ready = 1;
+	constexpr uint32_t build_failed = 2;
+
+	std::string cache_path;
+
+	// NOTE: Data written by a different driver or GPU is rejected by most drivers,
+	//       but some crash or silently misbehave on it, so check header ourselves
+	bool isCompatible(const std::vector<char>& data) {
+		VkPipelineCacheHeaderVersionOne header;
+
+		if (data.size() < sizeof(header)) {
+			return false;
+		}
+
+		std::memcpy(&header, data.data(), sizeof(header));
+
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(veekay::app.vk_physical_device, &props);
+
+		return header.headerSize >= sizeof(header) &&
+		       header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		       header.vendorID == props.vendorID &&
+		       header.deviceID == props.deviceID &&
+		       std::memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+
+	std::vector<char> readCache(const std::string& path) {
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+		if (!file.is_open()) {
+			return {};
+		}
+
+		std::vector<char> data(size_t(file.tellg()));
+		file.seekg(0);
+		file.read(data.data(), std::streamsize(data.size()));
+
+		if (!file || !isCompatible(data)) {
+			return {};
+		}
+
+		return data;
+	}
+
+	void rejectExtensions(const void* next) {
+		if (next) {
+			throw std::runtime_error("Extension structures are not supported by compilePipeline");
+		}
+	}
+
+	template <typename T>
+	const T* copyState(T& storage, const T* source) {
+		if (!source) {
+			return nullptr;
+		}
+
+		rejectExtensions(source->pNext);
+		storage = *source;
+
+		return &storage;
+	}
+
+	// NOTE: Null source stays null, e.g. viewports set through dynamic state
+	template <typename T>
+	const T* copyArray(std::vector<T>& storage, const T* source, size_t count) {
+		if (!source || count == 0) {
+			return nullptr;
+		}
+
+		storage.assign(source, source + count);
+
+		return storage.data();
+	}
+
+	void copyStages(PipelineBuild& build, const VkPipelineShaderStageCreateInfo* stages,
+	                uint32_t count) {
+		// NOTE: Sized upfront, vectors must not reallocate once pointers are taken
+		build.stages.assign(stages, stages + count);
+		build.entry_points.resize(count);
+		build.specializations.resize(count);
+		build.specialization_entries.resize(count);
+		build.specialization_data.resize(count);
+
+		for (uint32_t i = 0; i < count; ++i) {
+			VkPipelineShaderStageCreateInfo& stage = build.stages[i];
+
+			rejectExtensions(stage.pNext);
+
+			build.entry_points[i] = stage.pName;
+			stage.pName = build.entry_points[i].c_str();
+
+			if (const VkSpecializationInfo* source = stage.pSpecializationInfo) {
+				VkSpecializationInfo& specialization = build.specializations[i];
+				specialization = *source;
+
+				specialization.pMapEntries = copyArray(build.specialization_entries[i],
+				                                       source->pMapEntries, source->mapEntryCount);
+
+				const char* data = static_cast<const char*>(source->pData);
+				specialization.pData = copyArray(build.specialization_data[i], data, source->dataSize);
+
+				stage.pSpecializationInfo = &specialization;
+			}
+		}
+	}
+
+	void copyCreateInfo(PipelineBuild& build, const VkGraphicsPipelineCreateInfo& info) {
+		rejectExtensions(info.pNext);
+
+		build.info = info;
+
+		copyStages(build, info.pStages, info.stageCount);
+		build.info.pStages = build.stages.data();
+
+		if (copyState(build.vertex_input, info.pVertexInputState)) {
+			VkPipelineVertexInputStateCreateInfo& state = build.vertex_input;
+
+			state.pVertexBindingDescriptions = copyArray(build.vertex_bindings,
+			                                             state.pVertexBindingDescriptions,
+			                                             state.vertexBindingDescriptionCount);
+			state.pVertexAttributeDescriptions = copyArray(build.vertex_attributes,
+			                                               state.pVertexAttributeDescriptions,
+			                                               state.vertexAttributeDescriptionCount);
+
+			build.info.pVertexInputState = &state;
+		}
+
+		build.info.pInputAssemblyState = copyState(build.input_assembly, info.pInputAssemblyState);
+		build.info.pTessellationState = copyState(build.tessellation, info.pTessellationState);
+
+		if (copyState(build.viewport, info.pViewportState)) {
+			VkPipelineViewportStateCreateInfo& state = build.viewport;
+
+			state.pViewports = copyArray(build.viewports, state.pViewports, state.viewportCount);
+			state.pScissors = copyArray(build.scissors, state.pScissors, state.scissorCount);
+
+			build.info.pViewportState = &state;
+		}
+
+		build.info.pRasterizationState = copyState(build.rasterization, info.pRasterizationState);
+
+		if (copyState(build.multisample, info.pMultisampleState)) {
+			VkPipelineMultisampleStateCreateInfo& state = build.multisample;
+
+			// NOTE: One 32-bit word per 32 samples
+			const size_t words = (size_t(state.rasterizationSamples) + 31) / 32;
+			state.pSampleMask = copyArray(build.sample_mask, state.pSampleMask, words);
+
+			build.info.pMultisampleState = &state;
+		}
+
+		build.info.pDepthStencilState = copyState(build.depth_stencil, info.pDepthStencilState);
+
+		if (copyState(build.color_blend, info.pColorBlendState)) {
+			VkPipelineColorBlendStateCreateInfo& state = build.color_blend;
+
+			state.pAttachments = copyArray(build.blend_attachments, state.pAttachments,
+			                               state.attachmentCount);
+
+			build.info.pColorBlendState = &state;
+		}
+
+		if (copyState(build.dynamic, info.pDynamicState)) {
+			VkPipelineDynamicStateCreateInfo& state = build.dynamic;
+
+			state.pDynamicStates = copyArray(build.dynamic_states, state.pDynamicStates,
+			                                 state.dynamicStateCount);
+
+			build.info.pDynamicState = &state;
+		}
+	}
+
+} // namespace
+
+// NOTE: Handles that never got a build, e.g. when init failed early, are never ready
+bool PipelineHandle::ready() const {
+	return build && build->state.load(std::memory_order_acquire) == build_ready;
+}
+
+bool PipelineHandle::failed() const {
+	return build && build->state.load(std::memory_order_acquire) == build_failed;
+}
+
+VkPipeline PipelineHandle::pipeline() const {
+	return ready() ? build->pipeline : VK_NULL_HANDLE;
+}
+
+namespace {
+
+	PipelineHandle submitBuild(PipelineBuild* build) {
+		build->state.store(build_pending, std::memory_order_relaxed);
+
+		// NOTE: Pipeline cache is internally synchronized, so builds may run side by side
+		build->job = jobs::submitBackground([build] {
+			VkDevice device = veekay::app.vk_device;
+			VkPipelineCache cache = veekay::app.vk_pipeline_cache;
+
+			VkResult result = build->compute
+			                  ? vkCreateComputePipelines(device, cache, 1, &build->compute_info,
+			                                             nullptr, &build->pipeline)
+			                  : vkCreateGraphicsPipelines(device, cache, 1, &build->info,
+			                                              nullptr, &build->pipeline);
+
+			build->state.store(result == VK_SUCCESS ? build_ready : build_failed,
+			                   std::memory_order_release);
+		});
+
+		return PipelineHandle{build};
+	}
+
+} // namespace
+
+PipelineHandle compilePipeline(const VkGraphicsPipelineCreateInfo& info) {
+	PipelineBuild* build = new PipelineBuild{};
+
+	try {
+		copyCreateInfo(*build, info);
+	} catch (...) {
+		delete build;
+		throw;
+	}
+
+	return submitBuild(build);
+}
+
+PipelineHandle compilePipeline(const VkComputePipelineCreateInfo& info) {
+	PipelineBuild* build = new PipelineBuild{};
+
+	try {
+		rejectExtensions(info.pNext);
+
+		build->compute = true;
+		build->compute_info = info;
+
+		copyStages(*build, &info.stage, 1);
+		build->compute_info.stage = build->stages[0];
+	} catch (...) {
+		delete build;
+		throw;
+	}
+
+	return submitBuild(build);
+}
+
+void destroyPipeline(PipelineHandle handle) {
+	PipelineBuild* build = handle.build;
+
+	if (!build) {
+		return;
+	}
+
+	jobs::wait(build->job);
+
+	if (build->state.load(std::memory_order_acquire) == build_ready) {
+		vkDestroyPipeline(veekay::app.vk_device, build->pipeline, nullptr);
+	}
+
+	delete build;
+}
+
+// NOTE: Missing or stale cache file just means a cold start
+void initPipelineCache(const char* path) {
+	cache_path = path;
+
+	std::vector<char> data = readCache(cache_path);
+
+	VkPipelineCacheCreateInfo info{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = data.size(),
+		.pInitialData = data.empty() ? nullptr : data.data(),
+	};
+
+	if (vkCreatePipelineCache(veekay::app.vk_device, &info, nullptr,
+	                          &veekay::app.vk_pipeline_cache) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Vulkan pipeline cache");
+	}
+}
+
+// NOTE: Returns false when cache could not be written, it's destroyed either way
+bool shutdownPipelineCache() {
+	VkDevice& device = veekay::app.vk_device;
+	VkPipelineCache& cache = veekay::app.vk_pipeline_cache;
+
+	bool saved = false;
+
+	size_t size = 0;
+	std::vector<char> data;
+
+	if (vkGetPipelineCacheData(device, cache, &size, nullptr) == VK_SUCCESS) {
+		data.resize(size);
+		saved = vkGetPipelineCacheData(device, cache, &size, data.data()) == VK_SUCCESS;
+		data.resize(size);
+	}
+
+	vkDestroyPipelineCache(device, cache, nullptr);
+	cache = VK_NULL_HANDLE;
+
+	if (!saved) {
+		return false;
+	}
+
+	// NOTE: Write next to the old file and swap, so a crash never leaves a torn cache
+	const std::string temp_path = cache_path + ".tmp";
+
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		file.write(data.data(), std::streamsize(data.size()));
+
+		if (!file) {
+			return false;
+		}
+	}
+
+	std::remove(cache_path.c_str());
+
+	return std::rename(temp_path.c_str(), cache_path.c_str()) == 0;
+}
+
+} // namespace veekay::graphics
@@ -0,0 +1,353 @@
+#include <veekay/profiler.hpp>
+
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include <stdexcept>
+
+#include <vulkan/vulkan_core.h>
+#include <imgui.h>
+
+#include <veekay/application.hpp>
+#include <veekay/graphics.hpp>
+
+namespace veekay::profiler {
+
+namespace {
+
+	using clock = std::chrono::steady_clock;
+
+	constexpr size_t phase_count = static_cast<size_t>(Phase::count);
+	constexpr size_t gpu_phase_count = static_cast<size_t>(GpuPhase::count);
+
+	// NOTE: Frame begin, render callback end and frame end
+	constexpr uint32_t queries_per_frame = 3;
+
+	constexpr double smoothing_factor = 0.05;
+	constexpr size_t history_size = 120;
+
+	const char* const phase_names[phase_count] = {
+		"Frame limit", "Input", "Events", "Update", "ImGui render", "Fence wait",
+		"Acquire", "Render", "ImGui record", "Readback", "Submit", "Present",
+	};
+
+	const char* const gpu_phase_names[gpu_phase_count] = {
+		"Frame", "Render", "Overlay",
+	};
+
+	Timing cpu_timings[phase_count];
+	Timing gpu_timings[gpu_phase_count];
+	Timing frame_timing;
+
+	// NOTE: Zones of a current frame, folded into timings at the next frame
+	clock::time_point zone_starts[phase_count];
+	double zone_times[phase_count];
+
+	clock::time_point frame_start;
+	bool frame_started;
+
+	float frame_history[history_size];
+	size_t frame_history_cursor;
+
+	bool overlay_visible;
+
+	bool gpu_supported;
+	double timestamp_period; // NOTE: Nanoseconds per tick
+	uint64_t timestamp_mask;
+
+	VkQueryPool query_pool;
+	VkCommandPool command_pool;
+	std::vector<VkCommandBuffer> command_buffers;
+	std::vector<bool> queries_written;
+
+	void accumulate(Timing& timing, double milliseconds) {
+		timing.last = milliseconds;
+		timing.average = timing.average > 0.0
+		                 ? timing.average + (milliseconds - timing.average) * smoothing_factor
+		                 : milliseconds;
+	}
+
+	double elapsed(clock::time_point from, clock::time_point to) {
+		return std::chrono::duration<double, std::milli>(to - from).count();
+	}
+
+	double ticksToMilliseconds(uint64_t from, uint64_t to) {
+		return double((to - from) & timestamp_mask) * timestamp_period / 1'000'000.0;
+	}
+
+} // namespace
+
+Timing cpuTiming(Phase phase) {
+	return cpu_timings[static_cast<size_t>(phase)];
+}
+
+Timing gpuTiming(GpuPhase phase) {
+	return gpu_timings[static_cast<size_t>(phase)];
+}
+
+Timing frameTiming() {
+	return frame_timing;
+}
+
+const char* phaseName(Phase phase) {
+	return phase_names[static_cast<size_t>(phase)];
+}
+
+const char* phaseName(GpuPhase phase) {
+	return gpu_phase_names[static_cast<size_t>(phase)];
+}
+
+bool isGpuSupported() {
+	return gpu_supported;
+}
+
+void setOverlayVisible(bool visible) {
+	overlay_visible = visible;
+}
+
+bool isOverlayVisible() {
+	return overlay_visible;
+}
+
+void init(uint32_t frames_in_flight, uint32_t queue_family) {
+	VkDevice& device = veekay::app.vk_device;
+	VkPhysicalDevice& physical_device = veekay::app.vk_physical_device;
+
+	{
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(physical_device, &props);
+
+		uint32_t count;
+		vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &count, nullptr);
+
+		std::vector<VkQueueFamilyProperties> families(count);
+		vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &count, families.data());
+
+		const uint32_t valid_bits = families[queue_family].timestampValidBits;
+
+		timestamp_period = props.limits.timestampPeriod;
+		timestamp_mask = valid_bits >= 64 ? ~uint64_t(0) : (uint64_t(1) << valid_bits) - 1;
+		gpu_supported = valid_bits > 0;
+	}
+
+	if (gpu_supported) {
+		VkQueryPoolCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_TIMESTAMP,
+			.queryCount = frames_in_flight * queries_per_frame,
+		};
+
+		if (vkCreateQueryPool(device, &info, nullptr, &query_pool) != VK_SUCCESS) {
+			gpu_supported = false;
+		}
+	}
+
+	{
+		VkCommandPoolCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+			.queueFamilyIndex = queue_family,
+		};
+
+		if (vkCreateCommandPool(device, &info, nullptr, &command_pool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Vulkan profiler command pool");
+		}
+	}
+
+	{
+		command_buffers.resize(frames_in_flight);
+		queries_written.assign(frames_in_flight, false);
+
+		VkCommandBufferAllocateInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = command_pool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = frames_in_flight,
+		};
+
+		if (vkAllocateCommandBuffers(device, &info, command_buffers.data()) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate Vulkan profiler command buffers");
+		}
+	}
+}
+
+void shutdown() {
+	VkDevice& device = veekay::app.vk_device;
+
+	vkDestroyCommandPool(device, command_pool, nullptr);
+
+	if (gpu_supported) {
+		vkDestroyQueryPool(device, query_pool, nullptr);
+	}
+}
+
+void newFrame() {
+	const clock::time_point now = clock::now();
+
+	if (frame_started) {
+		const double frame_time = elapsed(frame_start, now);
+
+		accumulate(frame_timing, frame_time);
+
+		frame_history[frame_history_cursor] = float(frame_time);
+		frame_history_cursor = (frame_history_cursor + 1) % history_size;
+
+		for (size_t i = 0; i < phase_count; ++i) {
+			accumulate(cpu_timings[i], zone_times[i]);
+			zone_times[i] = 0.0;
+		}
+	}
+
+	frame_start = now;
+	frame_started = true;
+}
+
+void beginZone(Phase phase) {
+	zone_starts[static_cast<size_t>(phase)] = clock::now();
+}
+
+void endZone(Phase phase) {
+	const size_t index = static_cast<size_t>(phase);
+	zone_times[index] += elapsed(zone_starts[index], clock::now());
+}
+
+// NOTE: Must be called once fence of a frame slot has been waited on
+void collectGpu(uint32_t frame) {
+	if (!gpu_supported || !queries_written[frame]) {
+		return;
+	}
+
+	uint64_t results[queries_per_frame];
+
+	VkResult result = vkGetQueryPoolResults(veekay::app.vk_device, query_pool,
+	                                        frame * queries_per_frame, queries_per_frame,
+	                                        sizeof(results), results, sizeof(uint64_t),
+	                                        VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS) {
+		return;
+	}
+
+	accumulate(gpu_timings[static_cast<size_t>(GpuPhase::frame)],
+	           ticksToMilliseconds(results[0], results[2]));
+	accumulate(gpu_timings[static_cast<size_t>(GpuPhase::render)],
+	           ticksToMilliseconds(results[0], results[1]));
+	accumulate(gpu_timings[static_cast<size_t>(GpuPhase::overlay)],
+	           ticksToMilliseconds(results[1], results[2]));
+}
+
+// NOTE: Command buffer that must be submitted before application commands
+VkCommandBuffer recordGpuBegin(uint32_t frame) {
+	VkCommandBuffer cmd = command_buffers[frame];
+
+	vkResetCommandBuffer(cmd, 0);
+
+	{
+		VkCommandBufferBeginInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		};
+
+		vkBeginCommandBuffer(cmd, &info);
+	}
+
+	if (gpu_supported) {
+		const uint32_t first = frame * queries_per_frame;
+
+		vkCmdResetQueryPool(cmd, query_pool, first, queries_per_frame);
+
+		// NOTE: Written at the stage the submit waits on for the acquired image, so time
+		//       blocked on acquire isn't counted towards the frame. Compute work recorded
+		//       before the render pass, e.g. testbed culling, may start earlier and isn't measured
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, query_pool, first);
+
+		queries_written[frame] = true;
+	}
+
+	vkEndCommandBuffer(cmd);
+
+	return cmd;
+}
+
+// NOTE: Recorded first thing after application commands
+void writeGpuRenderEnd(VkCommandBuffer cmd, uint32_t frame) {
+	if (gpu_supported) {
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		                    query_pool, frame * queries_per_frame + 1);
+	}
+}
+
+// NOTE: Recorded last thing in a frame
+void writeGpuFrameEnd(VkCommandBuffer cmd, uint32_t frame) {
+	if (gpu_supported) {
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		                    query_pool, frame * queries_per_frame + 2);
+	}
+}
+
+void drawOverlay() {
+	if (!overlay_visible) {
+		return;
+	}
+
+	ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_FirstUseEver);
+
+	if (!ImGui::Begin("Profiler", &overlay_visible)) {
+		ImGui::End();
+		return;
+	}
+
+	const double frame_average = frame_timing.average;
+
+	ImGui::Text("Frame: %.2f ms (%.1f FPS)", frame_average,
+	            frame_average > 0.0 ? 1000.0 / frame_average : 0.0);
+
+	ImGui::PlotLines("##frame_history", frame_history, int(history_size),
+	                 int(frame_history_cursor), nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+
+	auto table = [](const char* id, const char* title, const Timing* timings,
+	                const char* const* names, size_t count) {
+		if (!ImGui::BeginTable(id, 3, ImGuiTableFlags_RowBg)) {
+			return;
+		}
+
+		ImGui::TableSetupColumn(title);
+		ImGui::TableSetupColumn("Last, ms");
+		ImGui::TableSetupColumn("Average, ms");
+		ImGui::TableHeadersRow();
+
+		for (size_t i = 0; i < count; ++i) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(names[i]);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", timings[i].last);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", timings[i].average);
+		}
+
+		ImGui::EndTable();
+	};
+
+	table("##cpu", "CPU phase", cpu_timings, phase_names, phase_count);
+
+	if (gpu_supported) {
+		table("##gpu", "GPU phase", gpu_timings, gpu_phase_names, gpu_phase_count);
+	} else {
+		ImGui::TextUnformatted("GPU timestamps are not supported");
+	}
+
+	{
+		const graphics::MemoryStats memory = graphics::memoryStats();
+		const double mebibyte = 1024.0 * 1024.0;
+
+		ImGui::Text("Device memory: %.1f / %.1f MiB, %u blocks, %u allocations",
+		            double(memory.used_bytes) / mebibyte, double(memory.block_bytes) / mebibyte,
+		            memory.block_count, memory.allocation_count);
+		ImGui::Text("Fragmentation: %.1f%%", memory.fragmentation * 100.0f);
+	}
+
+	ImGui::End();
+}
+
+} // namespace veekay::profiler
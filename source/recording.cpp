@@ -0,0 +1,168 @@
+#include <veekay/recording.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <veekay/jobs.hpp>
+#include <veekay/application.hpp>
+#include <vulkan/vulkan_core.h>
+
+namespace veekay::jobs {
+
+int32_t currentWorker();
+
+} // namespace veekay::jobs
+
+namespace veekay::recording {
+
+namespace {
+
+	// NOTE: Fewer draws than that aren't worth a secondary command buffer
+	constexpr size_t min_chunk_draws = 64;
+
+	// NOTE: Command buffers of a single worker for a single frame in flight,
+	//       pool is reset as a whole once the frame's fence is signaled
+	struct ThreadFrame {
+		VkCommandPool pool;
+		std::vector<VkCommandBuffer> buffers;
+		size_t used;
+	};
+
+	uint32_t thread_count;
+	uint32_t frames_in_flight;
+	uint32_t current_frame;
+
+	// NOTE: Indexed by [worker * frames_in_flight + frame], worker 0 is the main thread
+	std::vector<ThreadFrame> thread_frames;
+
+	// NOTE: Only ever called on the worker owning the pool
+	VkCommandBuffer acquire() {
+		const uint32_t worker = uint32_t(veekay::jobs::currentWorker());
+		ThreadFrame& frame = thread_frames[worker * frames_in_flight + current_frame];
+
+		if (frame.used == frame.buffers.size()) {
+			VkCommandBufferAllocateInfo info{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+				.commandPool = frame.pool,
+				.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+				.commandBufferCount = 1,
+			};
+
+			VkCommandBuffer cmd;
+
+			if (vkAllocateCommandBuffers(veekay::app.vk_device, &info, &cmd) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to allocate Vulkan secondary command buffer");
+			}
+
+			frame.buffers.push_back(cmd);
+		}
+
+		return frame.buffers[frame.used++];
+	}
+
+	VkCommandBuffer recordChunk(VkFramebuffer framebuffer, RecordFunc func,
+	                            size_t begin, size_t end) {
+		VkCommandBuffer cmd = acquire();
+
+		VkCommandBufferInheritanceInfo inheritance{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+			.renderPass = veekay::app.vk_render_pass,
+			.subpass = 0,
+			.framebuffer = framebuffer,
+		};
+
+		VkCommandBufferBeginInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+			         VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+			.pInheritanceInfo = &inheritance,
+		};
+
+		vkBeginCommandBuffer(cmd, &info);
+		func(cmd, begin, end);
+		vkEndCommandBuffer(cmd);
+
+		return cmd;
+	}
+
+} // namespace
+
+void recordParallel(VkCommandBuffer cmd, VkFramebuffer framebuffer,
+                    size_t count, RecordFunc func) {
+	if (count == 0) {
+		return;
+	}
+
+	if (veekay::jobs::currentWorker() < 0) {
+		throw std::runtime_error("Parallel recording is only possible from main thread or jobs");
+	}
+
+	const size_t chunk_count = std::clamp(count / min_chunk_draws, size_t(1), size_t(thread_count));
+
+	std::vector<VkCommandBuffer> results(chunk_count);
+
+	auto handle = veekay::jobs::parallelFor(chunk_count, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			results[i] = recordChunk(framebuffer, func,
+			                         count * i / chunk_count,
+			                         count * (i + 1) / chunk_count);
+		}
+	});
+
+	veekay::jobs::wait(handle);
+
+	vkCmdExecuteCommands(cmd, uint32_t(chunk_count), results.data());
+}
+
+uint32_t threadCount() {
+	return thread_count;
+}
+
+void init(uint32_t frame_count, uint32_t queue_family) {
+	frames_in_flight = frame_count;
+	current_frame = 0;
+
+	// NOTE: Every job worker may end up recording a chunk
+	thread_count = veekay::jobs::workerCount();
+
+	thread_frames.resize(thread_count * frames_in_flight);
+
+	for (ThreadFrame& frame : thread_frames) {
+		VkCommandPoolCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+			.queueFamilyIndex = queue_family,
+		};
+
+		if (vkCreateCommandPool(veekay::app.vk_device, &info, nullptr, &frame.pool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Vulkan recording command pool");
+		}
+
+		frame.used = 0;
+	}
+}
+
+// NOTE: Must be called once fence of given frame slot is signaled
+void beginFrame(uint32_t frame) {
+	current_frame = frame;
+
+	for (uint32_t i = 0; i < thread_count; ++i) {
+		ThreadFrame& thread_frame = thread_frames[i * frames_in_flight + frame];
+
+		vkResetCommandPool(veekay::app.vk_device, thread_frame.pool, 0);
+		thread_frame.used = 0;
+	}
+}
+
+// NOTE: Device must be idle
+void shutdown() {
+	// NOTE: Destroying pools frees their command buffers too
+	for (ThreadFrame& frame : thread_frames) {
+		vkDestroyCommandPool(veekay::app.vk_device, frame.pool, nullptr);
+	}
+
+	thread_frames.clear();
+}
+
+} // namespace veekay::recording
@@ -0,0 +1,229 @@
+#include <veekay/graphics.hpp>
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+
+#include <veekay/application.hpp>
+#include <vulkan/vulkan_core.h>
+
+namespace veekay::graphics {
+
+namespace {
+
+	constexpr VkDeviceSize ring_size = 64ull << 20;
+
+	// NOTE: Ring bytes of one allocation including alignment and wrap padding.
+	//       Released ones go back to the ring only in allocation order
+	struct Region {
+		VkDeviceSize bytes;
+		bool released;
+	};
+
+	// NOTE: Staging memory handed out between two retireStaging calls,
+	//       all of it becomes free once the fence is signaled
+	struct Batch {
+		VkFence fence;
+		std::vector<uint64_t> regions;
+		std::vector<Buffer*> fallbacks;
+		std::vector<std::function<void()>> releases;
+	};
+
+	std::mutex mutex;
+
+	Buffer* ring;
+	VkDeviceSize head;
+	VkDeviceSize used;
+
+	std::deque<Region> regions;
+	uint64_t first_region = 1; // NOTE: Number of regions.front(), 0 stands for none
+
+	Batch current;
+	std::deque<Batch> in_flight;
+
+	void releaseRegion(uint64_t region) {
+		regions[region - first_region].released = true;
+
+		while (!regions.empty() && regions.front().released) {
+			used -= regions.front().bytes;
+			regions.pop_front();
+			first_region += 1;
+		}
+	}
+
+	void release(Batch& batch) {
+		for (uint64_t region : batch.regions) {
+			releaseRegion(region);
+		}
+
+		for (Buffer* buffer : batch.fallbacks) {
+			delete buffer;
+		}
+
+		for (auto& release : batch.releases) {
+			release();
+		}
+	}
+
+	// NOTE: Takes bytes from the ring, false when it's too full
+	bool take(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint64_t& region) {
+		if (used == 0) {
+			head = 0;
+		}
+
+		VkDeviceSize begin = (head + alignment - 1) / alignment * alignment;
+		VkDeviceSize padding = begin - head;
+
+		// NOTE: Allocations are contiguous, tail of the ring is skipped when too short
+		if (begin + size > ring_size) {
+			begin = 0;
+			padding = ring_size - head;
+		}
+
+		const VkDeviceSize consumed = padding + size;
+
+		if (size > ring_size || used + consumed > ring_size) {
+			return false;
+		}
+
+		offset = begin;
+		head = (begin + size) % ring_size;
+		used += consumed;
+
+		region = first_region + regions.size();
+		regions.push_back(Region{.bytes = consumed, .released = false});
+
+		return true;
+	}
+
+	StagingBlock allocate(VkDeviceSize size, VkDeviceSize alignment) {
+		if (!ring) {
+			ring = new Buffer(ring_size, nullptr, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+		}
+
+		VkDeviceSize offset;
+		uint64_t region;
+
+		if (take(size, alignment, offset, region)) {
+			return StagingBlock{
+				.allocation = {
+					.buffer = ring->buffer,
+					.offset = offset,
+					.mapped = static_cast<char*>(ring->mapped_region) + offset,
+				},
+				.region = region,
+				.fallback = nullptr,
+			};
+		}
+
+		// NOTE: Too big or ring is full of uploads still in flight, use a temporary buffer
+		Buffer* buffer = new Buffer(size, nullptr, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+
+		return StagingBlock{
+			.allocation = {
+				.buffer = buffer->buffer,
+				.offset = 0,
+				.mapped = buffer->mapped_region,
+			},
+			.region = 0,
+			.fallback = buffer,
+		};
+	}
+
+} // namespace
+
+StagingAllocation allocateStaging(VkDeviceSize size, VkDeviceSize alignment) {
+	std::lock_guard lock(mutex);
+
+	StagingBlock block = allocate(size, alignment);
+
+	if (block.fallback) {
+		current.fallbacks.push_back(block.fallback);
+	} else {
+		current.regions.push_back(block.region);
+	}
+
+	return block.allocation;
+}
+
+StagingBlock allocateStagingBlock(VkDeviceSize size, VkDeviceSize alignment) {
+	std::lock_guard lock(mutex);
+	return allocate(size, alignment);
+}
+
+void freeStagingBlock(const StagingBlock& block) {
+	std::lock_guard lock(mutex);
+
+	if (block.fallback) {
+		delete block.fallback;
+	} else if (block.region != 0) {
+		releaseRegion(block.region);
+	}
+}
+
+void releaseAfterSubmit(std::function<void()> release) {
+	std::lock_guard lock(mutex);
+	current.releases.push_back(std::move(release));
+}
+
+// NOTE: Ties staging memory allocated so far to a submission signaling fence,
+//       VK_NULL_HANDLE means the submission has already completed
+void retireStaging(VkFence fence) {
+	std::lock_guard lock(mutex);
+
+	if (current.regions.empty() && current.fallbacks.empty() && current.releases.empty()) {
+		return;
+	}
+
+	current.fence = fence;
+
+	if (fence == VK_NULL_HANDLE) {
+		release(current);
+	} else {
+		in_flight.push_back(std::move(current));
+	}
+
+	current = Batch{};
+}
+
+// NOTE: Must be called before fences of retired batches get reset
+void reclaimStaging() {
+	std::lock_guard lock(mutex);
+
+	while (!in_flight.empty()) {
+		Batch& batch = in_flight.front();
+
+		if (vkGetFenceStatus(veekay::app.vk_device, batch.fence) != VK_SUCCESS) {
+			break;
+		}
+
+		release(batch);
+		in_flight.pop_front();
+	}
+}
+
+// NOTE: Device must be idle
+void shutdownStaging() {
+	std::lock_guard lock(mutex);
+
+	for (Batch& batch : in_flight) {
+		release(batch);
+	}
+
+	in_flight.clear();
+
+	release(current);
+	current = Batch{};
+
+	// NOTE: Blocks still held are leaked by their owners, forget them
+	first_region += regions.size();
+	regions.clear();
+	used = 0;
+
+	delete ring;
+	ring = nullptr;
+}
+
+} // namespace veekay::graphics
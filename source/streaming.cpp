@@ -0,0 +1,429 @@
+#include <veekay/streaming.hpp>
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+
+#include <veekay/uploads.hpp>
+#include <veekay/texture_file.hpp>
+#include <veekay/application.hpp>
+#include <vulkan/vulkan_core.h>
+
+namespace veekay::graphics {
+
+namespace {
+
+	constexpr uint32_t default_tail_size = 64;
+	constexpr VkDeviceSize default_upload_bytes = 16ull << 20;
+	constexpr uint32_t default_unused_updates = 120;
+
+	constexpr VkDeviceSize no_budget = UINT64_MAX;
+
+	struct StreamedTexture {
+		std::unique_ptr<TextureFile> file; // NOTE: nullptr for removed ones
+
+		Texture* texture;  // NOTE: Holds levels from resident onwards
+		uint32_t resident; // NOTE: Level count of file while nothing is resident
+
+		// NOTE: Replacement being uploaded, swapped in once handle is ready
+		Texture* pending;
+		uint32_t pending_level;
+		UploadHandle handle;
+
+		uint32_t tail; // NOTE: First level that always stays resident
+		uint32_t wanted;
+
+		float usage; // NOTE: Largest screen size reported since last update
+		uint64_t last_used;
+		uint64_t generation;
+	};
+
+	// NOTE: Bytes of levels from first onwards, close to what their image takes
+	VkDeviceSize levelBytes(const TextureFile& file, uint32_t first) {
+		VkDeviceSize bytes = 0;
+
+		for (uint32_t i = first; i < file.levelCount(); ++i) {
+			bytes += textureLevelSize(file.format(), file.width(), file.height(), i);
+		}
+
+		return bytes;
+	}
+
+	// NOTE: How much device local memory streamed textures may grow to, others'
+	//       usage is taken as is. Without VK_EXT_memory_budget there's no limit
+	VkDeviceSize deviceBudget(VkDeviceSize own_bytes) {
+		if (!veekay::app.memory_budget) {
+			return no_budget;
+		}
+
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
+		};
+
+		VkPhysicalDeviceMemoryProperties2 props{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+			.pNext = &budget,
+		};
+
+		vkGetPhysicalDeviceMemoryProperties2(veekay::app.vk_physical_device, &props);
+
+		VkDeviceSize heap_budget = 0;
+		VkDeviceSize heap_usage = 0;
+
+		for (uint32_t i = 0; i < props.memoryProperties.memoryHeapCount; ++i) {
+			if (props.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+				heap_budget += budget.heapBudget[i];
+				heap_usage += budget.heapUsage[i];
+			}
+		}
+
+		if (heap_usage > heap_budget) {
+			return own_bytes - std::min(own_bytes, heap_usage - heap_budget);
+		}
+
+		return own_bytes + (heap_budget - heap_usage);
+	}
+
+} // namespace
+
+struct TextureStreamerState {
+	StreamingOptions options;
+
+	std::vector<StreamedTexture> textures;
+	std::vector<StreamedTextureId> free_ids;
+
+	uint64_t updates;
+	VkDeviceSize budget;
+
+	// NOTE: Usage at last failed allocation, nothing grows past it until a texture is removed
+	VkDeviceSize failure_cap;
+
+	VkDeviceSize residentBytes() const {
+		VkDeviceSize bytes = 0;
+
+		for (const StreamedTexture& streamed : textures) {
+			if (streamed.texture) {
+				bytes += streamed.texture->allocation.size;
+			}
+
+			if (streamed.pending) {
+				bytes += streamed.pending->allocation.size;
+			}
+		}
+
+		return bytes;
+	}
+
+	// NOTE: Bytes streamed textures take once pending ones are swapped in
+	VkDeviceSize swappedBytes() const {
+		VkDeviceSize bytes = 0;
+
+		for (const StreamedTexture& streamed : textures) {
+			if (streamed.pending) {
+				bytes += streamed.pending->allocation.size;
+			} else if (streamed.texture) {
+				bytes += streamed.texture->allocation.size;
+			}
+		}
+
+		return bytes;
+	}
+
+	// NOTE: Out of memory degrades quality instead of failing. Levels both textures
+	//       share are copied from resident one, only new ones come from the file
+	bool request(StreamedTexture& streamed, uint32_t level) {
+		const TextureFile& file = *streamed.file;
+
+		const uint32_t uploaded = streamed.texture ? std::max(streamed.resident, level) - level
+		                                           : file.levelCount() - level;
+		const uint32_t source_level = level > streamed.resident ? level - streamed.resident : 0;
+
+		try {
+			streamed.pending = uploadTexture(std::max(file.width() >> level, 1u),
+			                                 std::max(file.height() >> level, 1u),
+			                                 file.format(), file.levelCount() - level,
+			                                 file.levels() + level, uploaded,
+			                                 streamed.texture, source_level, streamed.handle);
+		} catch (const std::runtime_error&) {
+			failure_cap = residentBytes();
+			return false;
+		}
+
+		streamed.pending_level = level;
+
+		return true;
+	}
+
+	StreamedTexture& at(StreamedTextureId id) {
+		if (id >= textures.size() || !textures[id].file) {
+			throw std::runtime_error("Invalid streamed texture id");
+		}
+
+		return textures[id];
+	}
+};
+
+TextureStreamer::TextureStreamer(const StreamingOptions& options)
+: state{std::make_unique<TextureStreamerState>()} {
+	state->options = options;
+
+	if (state->options.tail_size == 0) {
+		state->options.tail_size = default_tail_size;
+	}
+
+	if (state->options.upload_bytes_per_update == 0) {
+		state->options.upload_bytes_per_update = default_upload_bytes;
+	}
+
+	if (state->options.unused_updates == 0) {
+		state->options.unused_updates = default_unused_updates;
+	}
+
+	state->budget = no_budget;
+	state->failure_cap = no_budget;
+}
+
+TextureStreamer::~TextureStreamer() {
+	for (StreamedTextureId id = 0; id < state->textures.size(); ++id) {
+		if (state->textures[id].file) {
+			remove(id);
+		}
+	}
+}
+
+StreamedTextureId TextureStreamer::add(const char* path) {
+	auto file = std::make_unique<TextureFile>(path);
+
+	if (!isFormatSampled(file->format())) {
+		throw std::runtime_error(std::string("Texture format of ") + path + " is not supported by Vulkan device");
+	}
+
+	StreamedTextureId id;
+
+	if (state->free_ids.empty()) {
+		id = StreamedTextureId(state->textures.size());
+		state->textures.emplace_back();
+	} else {
+		id = state->free_ids.back();
+		state->free_ids.pop_back();
+	}
+
+	StreamedTexture& streamed = state->textures[id];
+	streamed = StreamedTexture{};
+
+	streamed.tail = file->levelCount() - 1;
+
+	while (streamed.tail > 0 &&
+	       std::max(file->width() >> (streamed.tail - 1), file->height() >> (streamed.tail - 1)) <= state->options.tail_size) {
+		streamed.tail -= 1;
+	}
+
+	streamed.resident = file->levelCount();
+	streamed.wanted = streamed.tail;
+	streamed.last_used = state->updates;
+	streamed.file = std::move(file);
+
+	// NOTE: Tail is what texture falls back to, so it's never left out
+	if (!state->request(streamed, streamed.tail)) {
+		streamed.file.reset();
+		state->free_ids.push_back(id);
+
+		throw std::runtime_error(std::string("Failed to allocate streamed texture ") + path);
+	}
+
+	return id;
+}
+
+void TextureStreamer::remove(StreamedTextureId id) {
+	StreamedTexture& streamed = state->at(id);
+
+	if (streamed.pending) {
+		streamed.handle.wait();
+
+		Texture* pending = streamed.pending;
+		releaseAfterSubmit([pending] { delete pending; });
+	}
+
+	if (streamed.texture) {
+		Texture* texture = streamed.texture;
+		releaseAfterSubmit([texture] { delete texture; });
+	}
+
+	streamed = StreamedTexture{};
+	state->free_ids.push_back(id);
+
+	state->failure_cap = no_budget;
+}
+
+void TextureStreamer::reportUsage(StreamedTextureId id, float screen_size) {
+	StreamedTexture& streamed = state->at(id);
+
+	streamed.usage = std::max(streamed.usage, screen_size);
+}
+
+void TextureStreamer::update() {
+	state->updates += 1;
+
+	for (StreamedTexture& streamed : state->textures) {
+		if (!streamed.pending || !streamed.handle.ready()) {
+			continue;
+		}
+
+		if (streamed.texture) {
+			Texture* texture = streamed.texture;
+			releaseAfterSubmit([texture] { delete texture; });
+		}
+
+		streamed.texture = streamed.pending;
+		streamed.resident = streamed.pending_level;
+		streamed.pending = nullptr;
+		streamed.generation += 1;
+	}
+
+	// NOTE: Used is what streamed textures settle at once pending swaps land,
+	//       peak also counts textures they replace, alive until then
+	VkDeviceSize used = state->swappedBytes();
+	VkDeviceSize peak = state->residentBytes();
+
+	const VkDeviceSize device = std::min(deviceBudget(peak), state->failure_cap);
+
+	state->budget = std::min(state->options.budget > 0 ? state->options.budget : no_budget, device);
+
+	// NOTE: Mip level whose texel covers about a pixel, recently used textures
+	//       keep their levels until they go out of sight for a while
+	for (StreamedTexture& streamed : state->textures) {
+		if (!streamed.file) {
+			continue;
+		}
+
+		const TextureFile& file = *streamed.file;
+
+		if (streamed.usage > 0.0f) {
+			const float ratio = float(std::max(file.width(), file.height())) / streamed.usage;
+			const uint32_t level = ratio > 1.0f ? uint32_t(std::floor(std::log2(ratio))) : 0;
+
+			streamed.wanted = std::min(level, streamed.tail);
+			streamed.last_used = state->updates;
+		} else if (state->updates - streamed.last_used >= state->options.unused_updates) {
+			streamed.wanted = streamed.tail;
+		}
+
+		streamed.usage = 0.0f;
+	}
+
+	auto idle = [](const StreamedTexture& streamed) {
+		return streamed.file && streamed.texture && !streamed.pending;
+	};
+
+	// NOTE: Over budget, drop one level at a time from textures least in need of it:
+	//       sharper than wanted first, then the ones unused for longest
+	while (used > state->budget) {
+		StreamedTexture* victim = nullptr;
+
+		for (StreamedTexture& streamed : state->textures) {
+			if (!idle(streamed) || streamed.resident >= streamed.tail) {
+				continue;
+			}
+
+			if (!victim) {
+				victim = &streamed;
+				continue;
+			}
+
+			const bool sharper = streamed.resident < streamed.wanted;
+			const bool victim_sharper = victim->resident < victim->wanted;
+
+			if (sharper != victim_sharper ? sharper : streamed.last_used < victim->last_used) {
+				victim = &streamed;
+			}
+		}
+
+		if (!victim) {
+			break;
+		}
+
+		uint32_t level = victim->resident + 1;
+
+		// NOTE: Smaller texture is allocated before resident one goes away. Without
+		//       room for it, fall back to the tail, which takes next to nothing
+		if (peak + levelBytes(*victim->file, level) > device) {
+			level = victim->tail;
+		}
+
+		const VkDeviceSize resident_bytes = victim->texture->allocation.size;
+
+		if (!state->request(*victim, level)) {
+			break;
+		}
+
+		const VkDeviceSize pending_bytes = victim->pending->allocation.size;
+
+		used -= std::min(used, resident_bytes - std::min(resident_bytes, pending_bytes));
+		peak += pending_bytes;
+	}
+
+	// NOTE: One level at a time, most blurry first, so everything sharpens evenly
+	std::vector<StreamedTexture*> blurry;
+
+	for (StreamedTexture& streamed : state->textures) {
+		if (idle(streamed) && streamed.wanted < streamed.resident) {
+			blurry.push_back(&streamed);
+		}
+	}
+
+	std::sort(blurry.begin(), blurry.end(), [](const StreamedTexture* a, const StreamedTexture* b) {
+		return a->resident - a->wanted > b->resident - b->wanted;
+	});
+
+	VkDeviceSize uploaded = 0;
+
+	for (StreamedTexture* streamed : blurry) {
+		const TextureFile& file = *streamed->file;
+
+		const uint32_t level = streamed->resident - 1;
+
+		// NOTE: Only the new level is read from the file, the rest is copied on device
+		const VkDeviceSize staged = textureLevelSize(file.format(), file.width(), file.height(), level);
+
+		if (uploaded > 0 && uploaded + staged > state->options.upload_bytes_per_update) {
+			break;
+		}
+
+		// NOTE: Both textures are alive until the swap
+		if (peak + levelBytes(file, level) > state->budget) {
+			continue;
+		}
+
+		if (!state->request(*streamed, level)) {
+			break;
+		}
+
+		peak += streamed->pending->allocation.size;
+		uploaded += staged;
+	}
+}
+
+Texture* TextureStreamer::texture(StreamedTextureId id) const {
+	return state->at(id).texture;
+}
+
+uint64_t TextureStreamer::generation(StreamedTextureId id) const {
+	return state->at(id).generation;
+}
+
+uint32_t TextureStreamer::residentLevel(StreamedTextureId id) const {
+	return state->at(id).resident;
+}
+
+VkDeviceSize TextureStreamer::residentBytes() const {
+	return state->residentBytes();
+}
+
+VkDeviceSize TextureStreamer::budget() const {
+	return state->budget;
+}
+
+} // namespace veekay::graphics
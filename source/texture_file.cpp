@@ -0,0 +1,62 @@
+#include <veekay/texture_file.hpp>
+
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+#include <veekay/graphics.hpp>
+
+namespace veekay::graphics {
+
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout is fixed by specification");
+static_assert(sizeof(Ktx2Level) == 24);
+
+namespace {
+
+	void check(bool condition, const char* path, const char* what) {
+		if (!condition) {
+			throw std::runtime_error(std::string("Invalid KTX2 file ") + path + ": " + what);
+		}
+	}
+
+} // namespace
+
+TextureFile::TextureFile(const char* path)
+: file{path} {
+	check(file.size() >= sizeof(Ktx2Header), path, "too small");
+
+	head = static_cast<const Ktx2Header*>(file.data());
+
+	check(std::equal(std::begin(ktx2_identifier), std::end(ktx2_identifier), head->identifier),
+	      path, "not a KTX2 file");
+	check(head->supercompression_scheme == 0, path, "supercompression is not supported");
+	check(head->vk_format != VK_FORMAT_UNDEFINED, path, "Basis Universal textures are not supported");
+	check(formatBlock(format()).bytes != 0, path, "unsupported format");
+
+	check(head->pixel_width > 0 && head->pixel_height > 0, path, "not a 2D texture");
+	check(head->pixel_depth == 0, path, "3D textures are not supported");
+	check(head->layer_count == 0, path, "texture arrays are not supported");
+	check(head->face_count == 1, path, "cubemaps are not supported");
+
+	// NOTE: Only base level is stored when mips are left for loader to generate
+	const uint32_t count = std::max(head->level_count, 1u);
+
+	check(count <= 32 && (std::max(width(), height()) >> (count - 1)) > 0, path, "too many levels");
+	check(count <= (file.size() - sizeof(Ktx2Header)) / sizeof(Ktx2Level), path, "level index out of file");
+
+	const Ktx2Level* index = reinterpret_cast<const Ktx2Level*>(head + 1);
+	const uint8_t* base = static_cast<const uint8_t*>(file.data());
+
+	level_data.resize(count);
+
+	for (uint32_t i = 0; i < count; ++i) {
+		const Ktx2Level& level = index[i];
+
+		check(level.size == textureLevelSize(format(), width(), height(), i), path, "level size doesn't match format");
+		check(level.offset <= file.size() && level.size <= file.size() - level.offset, path, "level out of file");
+
+		level_data[i] = base + level.offset;
+	}
+}
+
+} // namespace veekay::graphics
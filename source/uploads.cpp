@@ -0,0 +1,691 @@
+#include <veekay/uploads.hpp>
+
+#include <deque>
+#include <mutex>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <veekay/application.hpp>
+#include <vulkan/vulkan_core.h>
+
+namespace veekay::graphics {
+
+struct MipBatch;
+MipBatch* recordMips(VkCommandBuffer cmd, const Texture* const* textures, size_t count);
+void releaseMips(MipBatch* batch);
+VkDeviceSize levelAlignment(VkFormat format);
+VkDeviceSize stagedLevelsSize(const Texture& texture, uint32_t level_count);
+void copyLevels(VkCommandBuffer cmd, const Texture& texture,
+                uint32_t level_count, const void* const* levels,
+                VkBuffer buffer, VkDeviceSize offset, void* mapped);
+void bufferConsumers(VkBufferUsageFlags usage,
+                     VkPipelineStageFlags& stages, VkAccessFlags& access);
+
+namespace {
+
+	// NOTE: Uploads requested during a frame, submitted together by processUploads
+	struct Batch {
+		uint64_t id;
+
+		VkCommandBuffer transfer_cmd; // NOTE: Copies, on transfer queue family
+		VkCommandBuffer graphics_cmd; // NOTE: Ownership acquire and mips, only with separate transfer queue
+
+		VkSemaphore semaphore; // NOTE: Orders graphics submission after transfer one
+		VkFence fence;         // NOTE: Signaled by last submission of a batch
+
+		std::vector<StagingBlock> staging;
+
+		// NOTE: Textures waiting for mips, all of them are generated right before submission
+		std::vector<const Texture*> mip_textures;
+		MipBatch* mips;
+	};
+
+	std::mutex mutex;
+
+	VkQueue transfer_queue;
+	uint32_t transfer_family;
+	VkQueue graphics_queue;
+	uint32_t graphics_family;
+
+	// NOTE: Transfer and graphics queues come from different families,
+	//       so resources have to change owner between them
+	bool separate;
+
+	VkCommandPool transfer_pool;
+	VkCommandPool graphics_pool;
+
+	std::unique_ptr<Batch> open_batch;
+	std::deque<std::unique_ptr<Batch>> in_flight;
+
+	uint64_t next_batch = 1;
+	uint64_t completed_batch = 0;
+
+	VkCommandBuffer beginCommandBuffer(VkCommandPool pool) {
+		VkDevice& device = veekay::app.vk_device;
+
+		VkCommandBuffer cmd;
+
+		{
+			VkCommandBufferAllocateInfo info{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+				.commandPool = pool,
+				.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+				.commandBufferCount = 1,
+			};
+
+			if (vkAllocateCommandBuffers(device, &info, &cmd) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to allocate Vulkan upload command buffer");
+			}
+		}
+
+		{
+			VkCommandBufferBeginInfo info{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+				.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+			};
+
+			vkBeginCommandBuffer(cmd, &info);
+		}
+
+		return cmd;
+	}
+
+	Batch& openBatch() {
+		if (!open_batch) {
+			open_batch = std::make_unique<Batch>();
+			open_batch->id = next_batch++;
+			open_batch->transfer_cmd = beginCommandBuffer(transfer_pool);
+
+			if (separate) {
+				open_batch->graphics_cmd = beginCommandBuffer(graphics_pool);
+			}
+		}
+
+		return *open_batch;
+	}
+
+	void submit(std::unique_ptr<Batch> batch) {
+		VkDevice& device = veekay::app.vk_device;
+
+		if (!batch->mip_textures.empty()) {
+			batch->mips = recordMips(separate ? batch->graphics_cmd : batch->transfer_cmd,
+			                         batch->mip_textures.data(), batch->mip_textures.size());
+		}
+
+		vkEndCommandBuffer(batch->transfer_cmd);
+
+		if (separate) {
+			vkEndCommandBuffer(batch->graphics_cmd);
+		}
+
+		{
+			VkFenceCreateInfo info{
+				.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+			};
+
+			if (vkCreateFence(device, &info, nullptr, &batch->fence) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create Vulkan upload fence");
+			}
+		}
+
+		if (separate) {
+			{
+				VkSemaphoreCreateInfo info{
+					.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+				};
+
+				if (vkCreateSemaphore(device, &info, nullptr, &batch->semaphore) != VK_SUCCESS) {
+					throw std::runtime_error("Failed to create Vulkan upload semaphore");
+				}
+			}
+
+			{
+				VkSubmitInfo info{
+					.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+					.commandBufferCount = 1,
+					.pCommandBuffers = &batch->transfer_cmd,
+					.signalSemaphoreCount = 1,
+					.pSignalSemaphores = &batch->semaphore,
+				};
+
+				vkQueueSubmit(transfer_queue, 1, &info, VK_NULL_HANDLE);
+			}
+
+			{
+				const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+				VkSubmitInfo info{
+					.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+					.waitSemaphoreCount = 1,
+					.pWaitSemaphores = &batch->semaphore,
+					.pWaitDstStageMask = &wait_stage,
+					.commandBufferCount = 1,
+					.pCommandBuffers = &batch->graphics_cmd,
+				};
+
+				vkQueueSubmit(graphics_queue, 1, &info, batch->fence);
+			}
+		} else {
+			VkSubmitInfo info{
+				.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+				.commandBufferCount = 1,
+				.pCommandBuffers = &batch->transfer_cmd,
+			};
+
+			vkQueueSubmit(transfer_queue, 1, &info, batch->fence);
+		}
+
+		in_flight.push_back(std::move(batch));
+	}
+
+	void complete(Batch& batch) {
+		VkDevice& device = veekay::app.vk_device;
+
+		for (const StagingBlock& block : batch.staging) {
+			freeStagingBlock(block);
+		}
+
+		releaseMips(batch.mips);
+
+		vkFreeCommandBuffers(device, transfer_pool, 1, &batch.transfer_cmd);
+
+		if (separate) {
+			vkFreeCommandBuffers(device, graphics_pool, 1, &batch.graphics_cmd);
+			vkDestroySemaphore(device, batch.semaphore, nullptr);
+		}
+
+		vkDestroyFence(device, batch.fence, nullptr);
+
+		completed_batch = batch.id;
+	}
+
+	void poll() {
+		while (!in_flight.empty()) {
+			Batch& batch = *in_flight.front();
+
+			if (vkGetFenceStatus(veekay::app.vk_device, batch.fence) != VK_SUCCESS) {
+				break;
+			}
+
+			complete(batch);
+			in_flight.pop_front();
+		}
+	}
+
+	// NOTE: Block stays with a batch until its fence is signaled
+	StagingAllocation stage(Batch& batch, size_t size, VkDeviceSize alignment) {
+		StagingBlock block = allocateStagingBlock(size, alignment);
+		batch.staging.push_back(block);
+
+		return block.allocation;
+	}
+
+} // namespace
+
+bool UploadHandle::ready() const {
+	std::lock_guard lock(mutex);
+
+	poll();
+
+	return batch <= completed_batch;
+}
+
+void UploadHandle::wait() const {
+	std::lock_guard lock(mutex);
+
+	if (open_batch && open_batch->id == batch) {
+		submit(std::move(open_batch));
+	}
+
+	while (completed_batch < batch && !in_flight.empty()) {
+		Batch& front = *in_flight.front();
+
+		vkWaitForFences(veekay::app.vk_device, 1, &front.fence, true, UINT64_MAX);
+
+		complete(front);
+		in_flight.pop_front();
+	}
+}
+
+Buffer* uploadBuffer(size_t size, const void* data,
+                     VkBufferUsageFlags usage, UploadHandle& handle) {
+	Buffer* buffer = new Buffer(size, nullptr, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+	                            BufferPlacement::device);
+
+	std::lock_guard lock(mutex);
+
+	Batch& batch = openBatch();
+	StagingAllocation staging = stage(batch, size, 16);
+
+	std::memcpy(staging.mapped, data, size);
+
+	{
+		VkBufferCopy region{
+			.srcOffset = staging.offset,
+			.dstOffset = 0,
+			.size = size,
+		};
+
+		vkCmdCopyBuffer(batch.transfer_cmd, staging.buffer, buffer->buffer, 1, &region);
+	}
+
+	VkPipelineStageFlags stages;
+	VkAccessFlags access;
+	bufferConsumers(usage, stages, access);
+
+	VkBufferMemoryBarrier barrier{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = access,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.buffer = buffer->buffer,
+		.offset = 0,
+		.size = VK_WHOLE_SIZE,
+	};
+
+	if (separate) {
+		// NOTE: Release on transfer queue, then acquire on graphics queue
+		barrier.dstAccessMask = 0;
+		barrier.srcQueueFamilyIndex = transfer_family;
+		barrier.dstQueueFamilyIndex = graphics_family;
+
+		vkCmdPipelineBarrier(batch.transfer_cmd,
+		                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		                     0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = access;
+
+		vkCmdPipelineBarrier(batch.graphics_cmd,
+		                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, stages,
+		                     0, 0, nullptr, 1, &barrier, 0, nullptr);
+	} else {
+		vkCmdPipelineBarrier(batch.transfer_cmd,
+		                     VK_PIPELINE_STAGE_TRANSFER_BIT, stages,
+		                     0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+
+	handle.batch = batch.id;
+
+	return buffer;
+}
+
+Texture* uploadTexture(uint32_t width, uint32_t height,
+                       VkFormat format, const void* pixels,
+                       UploadHandle& handle) {
+	StagingBlock staging = createUploadStaging(width, height, format);
+	std::memcpy(staging.allocation.mapped, pixels, textureLevelSize(format, width, height, 0));
+
+	return uploadTexture(width, height, format, staging, handle);
+}
+
+StagingBlock createUploadStaging(uint32_t width, uint32_t height, VkFormat format) {
+	return allocateStagingBlock(textureLevelSize(format, width, height, 0), levelAlignment(format));
+}
+
+Texture* uploadTexture(uint32_t width, uint32_t height,
+                       VkFormat format, const StagingBlock& staging,
+                       UploadHandle& handle) {
+	Texture* texture;
+
+	try {
+		texture = new Texture(width, height, format);
+	} catch (...) {
+		freeStagingBlock(staging);
+		throw;
+	}
+
+	std::lock_guard lock(mutex);
+
+	try {
+		openBatch();
+	} catch (...) {
+		delete texture;
+		freeStagingBlock(staging);
+		throw;
+	}
+
+	Batch& batch = *open_batch;
+	batch.staging.push_back(staging);
+
+	VkImageMemoryBarrier barrier{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask = 0,
+		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = texture->image,
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = texture->mip_levels,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+
+	vkCmdPipelineBarrier(batch.transfer_cmd,
+	                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+	                     0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	{
+		VkBufferImageCopy region{
+			.bufferOffset = staging.allocation.offset,
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = 0,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+			.imageOffset = {0, 0, 0},
+			.imageExtent = {width, height, 1},
+		};
+
+		vkCmdCopyBufferToImage(batch.transfer_cmd, staging.allocation.buffer, texture->image,
+		                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+	}
+
+	if (separate) {
+		// NOTE: Transfer queues can't blit or dispatch, so image moves to graphics
+		//       queue still in TRANSFER_DST layout and mips are generated there
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = transfer_family;
+		barrier.dstQueueFamilyIndex = graphics_family;
+
+		vkCmdPipelineBarrier(batch.transfer_cmd,
+		                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		                     0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(batch.graphics_cmd,
+		                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	}
+
+	batch.mip_textures.push_back(texture);
+
+	handle.batch = batch.id;
+
+	return texture;
+}
+
+Texture* uploadTexture(uint32_t width, uint32_t height,
+                       VkFormat format, uint32_t mip_levels,
+                       const void* const* levels, UploadHandle& handle) {
+	return uploadTexture(width, height, format, mip_levels, levels, mip_levels,
+	                     nullptr, 0, handle);
+}
+
+Texture* uploadTexture(uint32_t width, uint32_t height,
+                       VkFormat format, uint32_t mip_levels,
+                       const void* const* levels, uint32_t uploaded_levels,
+                       const Texture* source, uint32_t source_level,
+                       UploadHandle& handle) {
+	if (!isFormatSampled(format)) {
+		throw std::runtime_error("Texture format is not supported by Vulkan device");
+	}
+
+	Texture* texture = new Texture(width, height, format, mip_levels);
+
+	std::lock_guard lock(mutex);
+
+	StagingAllocation staging{};
+
+	// NOTE: Out of memory here must not leak texture, streaming retries with fewer levels
+	try {
+		if (uploaded_levels > 0) {
+			staging = stage(openBatch(), stagedLevelsSize(*texture, uploaded_levels),
+			                levelAlignment(format));
+		} else {
+			openBatch();
+		}
+	} catch (...) {
+		delete texture;
+		throw;
+	}
+
+	Batch& batch = *open_batch;
+
+	VkImageMemoryBarrier barrier{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask = 0,
+		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = texture->image,
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = uploaded_levels,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+
+	if (uploaded_levels > 0) {
+		vkCmdPipelineBarrier(batch.transfer_cmd,
+		                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		copyLevels(batch.transfer_cmd, *texture, uploaded_levels, levels,
+		           staging.buffer, staging.offset, staging.mapped);
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		if (separate) {
+			// NOTE: No mips to generate, layout changes as part of ownership transfer
+			barrier.dstAccessMask = 0;
+			barrier.srcQueueFamilyIndex = transfer_family;
+			barrier.dstQueueFamilyIndex = graphics_family;
+
+			vkCmdPipelineBarrier(batch.transfer_cmd,
+			                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			                     0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+			vkCmdPipelineBarrier(batch.graphics_cmd,
+			                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			                     0, 0, nullptr, 0, nullptr, 1, &barrier);
+		} else {
+			vkCmdPipelineBarrier(batch.transfer_cmd,
+			                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			                     0, 0, nullptr, 0, nullptr, 1, &barrier);
+		}
+	}
+
+	if (uploaded_levels < mip_levels) {
+		// NOTE: Source belongs to graphics queue and may be sampled by frames in flight,
+		//       so it's copied there and handed back in SHADER_READ_ONLY layout
+		VkCommandBuffer cmd = separate ? batch.graphics_cmd : batch.transfer_cmd;
+
+		const uint32_t copied_levels = mip_levels - uploaded_levels;
+
+		VkImageMemoryBarrier barriers[2]{
+			{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				.srcAccessMask = 0,
+				.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+				.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+				.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = texture->image,
+				.subresourceRange = {
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					.baseMipLevel = uploaded_levels,
+					.levelCount = copied_levels,
+					.baseArrayLayer = 0,
+					.layerCount = 1,
+				},
+			},
+			{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				.srcAccessMask = 0,
+				.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+				.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = source->image,
+				.subresourceRange = {
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					.baseMipLevel = source_level,
+					.levelCount = copied_levels,
+					.baseArrayLayer = 0,
+					.layerCount = 1,
+				},
+			},
+		};
+
+		vkCmdPipelineBarrier(cmd,
+		                     VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     0, 0, nullptr, 0, nullptr, 2, barriers);
+
+		std::vector<VkImageCopy> regions(copied_levels);
+
+		for (uint32_t i = 0; i < copied_levels; ++i) {
+			const uint32_t level = uploaded_levels + i;
+
+			regions[i] = VkImageCopy{
+				.srcSubresource = {
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					.mipLevel = source_level + i,
+					.baseArrayLayer = 0,
+					.layerCount = 1,
+				},
+				.srcOffset = {0, 0, 0},
+				.dstSubresource = {
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					.mipLevel = level,
+					.baseArrayLayer = 0,
+					.layerCount = 1,
+				},
+				.dstOffset = {0, 0, 0},
+				.extent = {
+					std::max(width >> level, 1u),
+					std::max(height >> level, 1u),
+					1,
+				},
+			};
+		}
+
+		vkCmdCopyImage(cmd,
+		               source->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		               texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		               uint32_t(regions.size()), regions.data());
+
+		barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		barriers[1].srcAccessMask = 0;
+		barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		vkCmdPipelineBarrier(cmd,
+		                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		                     0, 0, nullptr, 0, nullptr, 2, barriers);
+	}
+
+	handle.batch = batch.id;
+
+	return texture;
+}
+
+bool hasTransferQueue() {
+	return separate;
+}
+
+void initUploads(VkQueue transfer, uint32_t transfer_queue_family,
+                 VkQueue graphics, uint32_t graphics_queue_family) {
+	VkDevice& device = veekay::app.vk_device;
+
+	transfer_queue = transfer;
+	transfer_family = transfer_queue_family;
+	graphics_queue = graphics;
+	graphics_family = graphics_queue_family;
+
+	separate = transfer_family != graphics_family;
+
+	VkCommandPoolCreateInfo info{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+		.queueFamilyIndex = transfer_family,
+	};
+
+	if (vkCreateCommandPool(device, &info, nullptr, &transfer_pool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Vulkan upload command pool");
+	}
+
+	if (separate) {
+		info.queueFamilyIndex = graphics_family;
+
+		if (vkCreateCommandPool(device, &info, nullptr, &graphics_pool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Vulkan upload command pool");
+		}
+	}
+}
+
+// NOTE: Submits uploads requested since last call and retires finished ones,
+//       called once per frame from main thread
+void processUploads() {
+	std::lock_guard lock(mutex);
+
+	if (open_batch) {
+		submit(std::move(open_batch));
+	}
+
+	poll();
+}
+
+// NOTE: Device must be idle
+void shutdownUploads() {
+	std::lock_guard lock(mutex);
+
+	VkDevice& device = veekay::app.vk_device;
+
+	for (auto& batch : in_flight) {
+		complete(*batch);
+	}
+
+	in_flight.clear();
+
+	// NOTE: Never submitted, its resources were never uploaded either
+	if (open_batch) {
+		for (const StagingBlock& block : open_batch->staging) {
+			freeStagingBlock(block);
+		}
+
+		open_batch.reset();
+	}
+
+	vkDestroyCommandPool(device, transfer_pool, nullptr);
+
+	if (separate) {
+		vkDestroyCommandPool(device, graphics_pool, nullptr);
+	}
+}
+
+} // namespace veekay::graphics
@@ -3,6 +3,9 @@
 
 #include <iostream>
 #include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
 
 #include <vulkan/vulkan_core.h>
 
@@ -23,7 +26,18 @@ constexpr uint32_t window_default_width = 1280;
 constexpr uint32_t window_default_height = 720;
 constexpr char window_title[] = "Veekay";
 
-constexpr uint32_t max_frames_in_flight = 2;
+constexpr uint32_t default_frames_in_flight = 2;
+constexpr char default_pipeline_cache_path[] = "pipeline_cache.bin";
+constexpr char default_mip_shader_path[] = "./shaders/mips.comp.spv";
+constexpr char default_index_shader_path[] = "./shaders/widen.comp.spv";
+
+constexpr uint64_t no_readback_frame = UINT64_MAX;
+
+constexpr uint64_t present_wait_timeout = 100'000'000; // NOTE: Nanoseconds
+constexpr std::chrono::steady_clock::duration min_spin_margin = std::chrono::microseconds(500);
+
+uint32_t max_frames_in_flight;
+bool headless;
 
 GLFWwindow* window;
 
@@ -40,6 +54,8 @@ std::vector<VkImageView> vk_swapchain_image_views;
 
 VkQueue vk_graphics_queue;
 uint32_t vk_graphics_queue_family;
+VkQueue vk_transfer_queue;
+uint32_t vk_transfer_queue_family;
 
 // NOTE: ImGui rendering objects
 VkDescriptorPool imgui_descriptor_pool;
@@ -56,6 +72,14 @@ VkImageView vk_image_depth_view;
 VkRenderPass vk_render_pass;
 std::vector<VkFramebuffer> vk_framebuffers;
 
+// NOTE: Headless color targets and readback objects, one per frame in flight
+std::vector<VkImage> offscreen_images;
+std::vector<VkDeviceMemory> offscreen_image_memories;
+std::vector<VkImageView> offscreen_image_views;
+std::vector<VkCommandBuffer> readback_command_buffers;
+std::vector<veekay::graphics::Buffer*> readback_buffers;
+std::vector<uint64_t> readback_frames;
+
 std::vector<VkSemaphore> vk_render_semaphores;
 std::vector<VkSemaphore> vk_present_semaphores;
 std::vector<VkFence> vk_in_flight_fences;
@@ -64,6 +88,81 @@ uint32_t vk_current_frame;
 VkCommandPool vk_command_pool;
 std::vector<VkCommandBuffer> vk_command_buffers;
 
+uint32_t findMemoryType(uint32_t type_bits, VkMemoryPropertyFlags flags) {
+	VkPhysicalDeviceMemoryProperties properties;
+	vkGetPhysicalDeviceMemoryProperties(vk_physical_device, &properties);
+
+	for (uint32_t i = 0; i < properties.memoryTypeCount; ++i) {
+		const VkMemoryType& type = properties.memoryTypes[i];
+
+		if ((type_bits & (1 << i)) && (type.propertyFlags & flags) == flags) {
+			return i;
+		}
+	}
+
+	return UINT_MAX;
+}
+
+// NOTE: Frame limiter state
+std::chrono::steady_clock::time_point frame_deadline;
+std::chrono::steady_clock::duration spin_margin = std::chrono::milliseconds(1);
+
+PFN_vkWaitForPresentKHR vk_wait_for_present;
+uint64_t vk_present_id; // NOTE: Last one handed out, ids have to keep growing
+uint64_t vk_waited_present_id; // NOTE: Of the latest successful present, 0 before the first one
+
+VkPresentModeKHR vulkanPresentMode(veekay::PresentMode mode) {
+	switch (mode) {
+		case veekay::PresentMode::fifo_relaxed: return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+		case veekay::PresentMode::mailbox: return VK_PRESENT_MODE_MAILBOX_KHR;
+		case veekay::PresentMode::immediate: return VK_PRESENT_MODE_IMMEDIATE_KHR;
+		default: return VK_PRESENT_MODE_FIFO_KHR;
+	}
+}
+
+// NOTE: Holds the frame back until its deadline, deadlines are one period apart
+void limitFrameRate(double max_frame_rate) {
+	using std::chrono::steady_clock;
+
+	if (max_frame_rate <= 0.0) {
+		return;
+	}
+
+	const auto period = std::chrono::duration_cast<steady_clock::duration>(
+		std::chrono::duration<double>(1.0 / max_frame_rate));
+
+	// NOTE: Previous frame has to reach the display first, otherwise CPU runs
+	//       ahead and capped frames wait in the present queue adding latency
+	if (vk_wait_for_present && vk_waited_present_id > 0) {
+		vk_wait_for_present(vk_device, vk_swapchain, vk_waited_present_id, present_wait_timeout);
+	}
+
+	const steady_clock::time_point now = steady_clock::now();
+
+	// NOTE: Whole period behind, e.g. after a hitch or uncapping, pace from now
+	//       on instead of rushing through a burst of frames to catch up
+	if (now - frame_deadline > period) {
+		frame_deadline = now;
+	}
+
+	// NOTE: OS sleep wakes up late by up to a scheduler tick, so it stops short of
+	//       deadline by the longest recent oversleep and the rest is spun away
+	if (frame_deadline - now > spin_margin) {
+		const steady_clock::duration request = frame_deadline - now - spin_margin;
+
+		std::this_thread::sleep_for(request);
+
+		const steady_clock::duration overshoot = steady_clock::now() - now - request;
+		spin_margin = std::max({overshoot, spin_margin - spin_margin / 16, min_spin_margin});
+	}
+
+	while (steady_clock::now() < frame_deadline) {
+		std::this_thread::yield();
+	}
+
+	frame_deadline += period;
+}
+
 } // namespace
 
 namespace veekay {
@@ -80,50 +179,105 @@ namespace veekay {
 	namespace graphics {
 
 		void init();
+		void shutdown();
+		void retireStaging(VkFence fence);
+		void reclaimStaging();
+		void initUploads(VkQueue transfer_queue, uint32_t transfer_queue_family,
+		                 VkQueue graphics_queue, uint32_t graphics_queue_family);
+		void processUploads();
+		void initPipelineCache(const char* path);
+		bool shutdownPipelineCache();
+		void initMips(const char* shader_path);
+		void initMeshes(const char* shader_path);
 
 	} // namespace graphics
 
+	namespace jobs {
+
+		void init();
+		void shutdown();
+
+	} // namespace jobs
+
+	namespace recording {
+
+		void init(uint32_t frames_in_flight, uint32_t queue_family);
+		void beginFrame(uint32_t frame);
+		void shutdown();
+
+	} // namespace recording
+
+	namespace profiler {
+
+		void init(uint32_t frames_in_flight, uint32_t queue_family);
+		void shutdown();
+		void newFrame();
+		void beginZone(Phase phase);
+		void endZone(Phase phase);
+		void collectGpu(uint32_t frame);
+		VkCommandBuffer recordGpuBegin(uint32_t frame);
+		void writeGpuRenderEnd(VkCommandBuffer cmd, uint32_t frame);
+		void writeGpuFrameEnd(VkCommandBuffer cmd, uint32_t frame);
+		void drawOverlay();
+
+	} // namespace profiler
+
 } // namespace veekay
 
 int veekay::run(const veekay::ApplicationInfo& app_info) {
 	veekay::app.running = true;
-	
-	if (!glfwInit()) {
-		std::cerr << "Failed to initialize GLFW\n";
-		return 1;
-	}
 
-	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+	headless = app_info.headless;
+	veekay::app.headless = headless;
+	veekay::app.max_frame_rate = app_info.max_frame_rate;
+
+	max_frames_in_flight = app_info.frames_in_flight > 0 ? app_info.frames_in_flight
+	                                                     : default_frames_in_flight;
+
+	if (headless) {
+		app.window_width = app_info.headless_width > 0 ? app_info.headless_width
+		                                               : window_default_width;
+		app.window_height = app_info.headless_height > 0 ? app_info.headless_height
+		                                                 : window_default_height;
+	} else {
+		if (!glfwInit()) {
+			std::cerr << "Failed to initialize GLFW\n";
+			return 1;
+		}
 
-	window = glfwCreateWindow(window_default_width, window_default_height,
-	                          window_title, nullptr, nullptr);
-	if (!window) {
-		std::cerr << "Failed to create GLFW window\n";
-		return 1;
-	}
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
-	veekay::input::setup(window);
+		window = glfwCreateWindow(window_default_width, window_default_height,
+		                          window_title, nullptr, nullptr);
+		if (!window) {
+			std::cerr << "Failed to create GLFW window\n";
+			return 1;
+		}
 
-	/* NOTE:
-		needed because otherwise on macos everything will be rendered in the top
-		corner of the application window
-	*/
+		veekay::input::setup(window);
+
+		/* NOTE:
+			needed because otherwise on macos everything will be rendered in the top
+			corner of the application window
+		*/
 #if defined(__APPLE__) && defined(__MACH__)
-	int framebuffer_width, framebuffer_height;
-	glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+		int framebuffer_width, framebuffer_height;
+		glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
 
-	app.window_width = framebuffer_width;
-	app.window_height = framebuffer_height;
+		app.window_width = framebuffer_width;
+		app.window_height = framebuffer_height;
 #else
-	app.window_width = window_default_width;
-	app.window_height = window_default_height;
+		app.window_width = window_default_width;
+		app.window_height = window_default_height;
 #endif
+	}
 
-	{ // NOTE: Initialize Vulkan: grab device and create swapchain
+	{ // NOTE: Initialize Vulkan: grab instance and device
 		vkb::InstanceBuilder instance_builder;
 
 		auto builder_result = instance_builder.require_api_version(1, 2, 0)
+		                                      .set_headless(headless)
 		                                      .request_validation_layers()
 		                                      .use_default_debug_messenger()
 		                                      .build();
@@ -137,7 +291,7 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		vk_instance = instance.instance;
 		vk_debug_messenger = instance.debug_messenger;
 
-		if (glfwCreateWindowSurface(vk_instance, window, nullptr, &vk_surface) != VK_SUCCESS) {
+		if (!headless && glfwCreateWindowSurface(vk_instance, window, nullptr, &vk_surface) != VK_SUCCESS) {
 			const char* message;
 			glfwGetError(&message);
 			std::cerr << message << '\n';
@@ -155,8 +309,11 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			.dynamicRendering = true,
 		};
 
-		auto selector_result = physical_device_selector.set_surface(vk_surface)
-		                                               .set_required_features(device_features)
+		if (!headless) {
+			physical_device_selector.set_surface(vk_surface);
+		}
+
+		auto selector_result = physical_device_selector.set_required_features(device_features)
 		                                               .add_required_extension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)
 		                                               .add_required_extension_features(dyn_rendering)
 		                                               .select();
@@ -167,6 +324,71 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 
 		auto physical_device = selector_result.value();
 
+		{ // NOTE: Optional features, GPU-driven rendering has fallbacks without them
+			VkPhysicalDeviceFeatures features{
+				.multiDrawIndirect = true,
+			};
+
+			VkPhysicalDeviceFeatures first_instance{
+				.drawIndirectFirstInstance = true,
+			};
+
+			VkPhysicalDeviceVulkan12Features features_12{
+				.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+				.drawIndirectCount = true,
+			};
+
+			app.multi_draw_indirect = physical_device.enable_features_if_present(features);
+			app.draw_indirect_first_instance = physical_device.enable_features_if_present(first_instance);
+			app.draw_indirect_count = physical_device.enable_extension_features_if_present(features_12);
+		}
+
+		{ // NOTE: Texture compression, each family is checked on its own
+			VkPhysicalDeviceFeatures bc{.textureCompressionBC = true};
+			VkPhysicalDeviceFeatures etc2{.textureCompressionETC2 = true};
+			VkPhysicalDeviceFeatures astc{.textureCompressionASTC_LDR = true};
+
+			app.texture_compression_bc = physical_device.enable_features_if_present(bc);
+			app.texture_compression_etc2 = physical_device.enable_features_if_present(etc2);
+			app.texture_compression_astc = physical_device.enable_features_if_present(astc);
+		}
+
+		{
+			VkPhysicalDeviceFeatures features{
+				.shaderStorageImageArrayDynamicIndexing = true,
+			};
+
+			app.storage_image_array_indexing = physical_device.enable_features_if_present(features);
+		}
+
+		app.memory_budget = physical_device.enable_extension_if_present(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+		if (!headless) { // NOTE: Frame limiter waits on presents when these are around
+			VkPhysicalDevicePresentIdFeaturesKHR present_id{
+				.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+				.presentId = true,
+			};
+
+			VkPhysicalDevicePresentWaitFeaturesKHR present_wait{
+				.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+				.presentWait = true,
+			};
+
+			// NOTE: Present id is useless without present wait, so neither is enabled
+			//       unless both extensions and their features are there
+			app.present_wait = physical_device.is_extension_present(VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+			                   physical_device.is_extension_present(VK_KHR_PRESENT_WAIT_EXTENSION_NAME) &&
+			                   physical_device.are_extension_features_present(present_id) &&
+			                   physical_device.are_extension_features_present(present_wait);
+
+			if (app.present_wait) {
+				physical_device.enable_extension_if_present(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+				physical_device.enable_extension_if_present(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+				physical_device.enable_extension_features_if_present(present_id);
+				physical_device.enable_extension_features_if_present(present_wait);
+			}
+		}
+
 		{
 			vkb::DeviceBuilder device_builder(physical_device);
 
@@ -186,8 +408,42 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			
 			vk_graphics_queue = device.get_queue(queue_type).value();
 			vk_graphics_queue_family = device.get_queue_index(queue_type).value();
+
+			// NOTE: Prefer transfer-only family (DMA engine on discrete GPUs),
+			//       then any family other than graphics, then graphics itself
+			if (auto dedicated = device.get_dedicated_queue(vkb::QueueType::transfer)) {
+				vk_transfer_queue = dedicated.value();
+				vk_transfer_queue_family = device.get_dedicated_queue_index(vkb::QueueType::transfer).value();
+			} else if (auto separate = device.get_queue(vkb::QueueType::transfer)) {
+				vk_transfer_queue = separate.value();
+				vk_transfer_queue_family = device.get_queue_index(vkb::QueueType::transfer).value();
+			} else {
+				vk_transfer_queue = vk_graphics_queue;
+				vk_transfer_queue_family = vk_graphics_queue_family;
+			}
+		}
+
+		veekay::app.vk_device = vk_device;
+		veekay::app.vk_physical_device = vk_physical_device;
+
+		if (app.present_wait) {
+			vk_wait_for_present = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+				vkGetDeviceProcAddr(vk_device, "vkWaitForPresentKHR"));
 		}
+	}
 
+	graphics::init();
+	graphics::initUploads(vk_transfer_queue, vk_transfer_queue_family,
+	                      vk_graphics_queue, vk_graphics_queue_family);
+	graphics::initPipelineCache(app_info.pipeline_cache_path ? app_info.pipeline_cache_path
+	                                                         : default_pipeline_cache_path);
+	graphics::initMips(app_info.mip_shader_path ? app_info.mip_shader_path
+	                                            : default_mip_shader_path);
+	graphics::initMeshes(app_info.index_shader_path ? app_info.index_shader_path
+	                                                : default_index_shader_path);
+	profiler::init(max_frames_in_flight, vk_graphics_queue_family);
+
+	if (!headless) { // NOTE: Create swapchain
 		vkb::SwapchainBuilder swapchain_builder(vk_physical_device, vk_device, vk_surface);
 
 		vk_swapchain_format = VK_FORMAT_B8G8R8A8_UNORM;
@@ -198,7 +454,8 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		};
 
 		auto swapchain_result = swapchain_builder.set_desired_format(surface_format)
-		                                         .set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
+		                                         .set_desired_present_mode(vulkanPresentMode(app_info.present_mode))
+		                                         .add_fallback_present_mode(VK_PRESENT_MODE_FIFO_KHR)
 		                                         .set_desired_extent(app.window_width, app.window_height)
 		                                         .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
 		                                         .build();
@@ -211,14 +468,87 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		auto swapchain = swapchain_result.value();
 
 		vk_swapchain = swapchain.swapchain;
+		app.vk_present_mode = swapchain.present_mode;
 		vk_swapchain_images = swapchain.get_images().value();
 		vk_swapchain_image_views = swapchain.get_image_views().value();
+	} else { // NOTE: Create offscreen color images in place of a swapchain
+		vk_swapchain_format = VK_FORMAT_B8G8R8A8_UNORM;
 
-		veekay::app.vk_device = vk_device;
-		veekay::app.vk_physical_device = vk_physical_device;
-	}
+		offscreen_images.resize(max_frames_in_flight);
+		offscreen_image_memories.resize(max_frames_in_flight);
+		offscreen_image_views.resize(max_frames_in_flight);
 
-	graphics::init();
+		for (uint32_t i = 0; i < max_frames_in_flight; ++i) {
+			{
+				VkImageCreateInfo info{
+					.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+					.imageType = VK_IMAGE_TYPE_2D,
+					.format = vk_swapchain_format,
+					.extent = {app.window_width, app.window_height, 1},
+					.mipLevels = 1,
+					.arrayLayers = 1,
+					.samples = VK_SAMPLE_COUNT_1_BIT,
+					.tiling = VK_IMAGE_TILING_OPTIMAL,
+					.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+					         VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+				};
+
+				if (vkCreateImage(vk_device, &info, nullptr, &offscreen_images[i]) != VK_SUCCESS) {
+					std::cerr << "Failed to create Vulkan offscreen image " << i << '\n';
+					return 1;
+				}
+			}
+
+			{
+				VkMemoryRequirements requirements;
+				vkGetImageMemoryRequirements(vk_device, offscreen_images[i], &requirements);
+
+				uint32_t index = findMemoryType(requirements.memoryTypeBits,
+				                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+				if (index == UINT_MAX) {
+					std::cerr << "Failed to find required memory type for Vulkan offscreen image\n";
+					return 1;
+				}
+
+				VkMemoryAllocateInfo info{
+					.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+					.allocationSize = requirements.size,
+					.memoryTypeIndex = index,
+				};
+
+				if (vkAllocateMemory(vk_device, &info, nullptr, &offscreen_image_memories[i]) != VK_SUCCESS) {
+					std::cerr << "Failed to allocate memory for Vulkan offscreen image\n";
+					return 1;
+				}
+
+				if (vkBindImageMemory(vk_device, offscreen_images[i], offscreen_image_memories[i], 0) != VK_SUCCESS) {
+					std::cerr << "Failed to bind Vulkan offscreen image with device memory\n";
+					return 1;
+				}
+			}
+
+			{
+				VkImageViewCreateInfo info{
+					.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+					.image = offscreen_images[i],
+					.viewType = VK_IMAGE_VIEW_TYPE_2D,
+					.format = vk_swapchain_format,
+					.subresourceRange = {
+						.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+						.baseMipLevel = 0,
+						.levelCount = 1,
+						.baseArrayLayer = 0,
+						.layerCount = 1,
+					},
+				};
+
+				if (vkCreateImageView(vk_device, &info, nullptr, &offscreen_image_views[i]) != VK_SUCCESS) {
+					std::cerr << "Failed to create Vulkan offscreen image view\n";
+					return 1;
+				}
+			}
+		}
+	}
 
 	{ // NOTE: ImGui initialization
 		IMGUI_CHECKVERSION();
@@ -226,7 +556,14 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		ImGuiIO& io = ImGui::GetIO(); (void)io;
 
 		ImGui::StyleColorsDark();
+	}
+
+	if (headless) { // NOTE: ImGui still runs, but its draw data is never rendered
+		ImGuiIO& io = ImGui::GetIO();
 
+		io.DisplaySize = ImVec2(float(app.window_width), float(app.window_height));
+		io.Fonts->Build();
+	} else {
 		ImGui_ImplGlfw_InitForVulkan(window, true);
 
 		{
@@ -365,6 +702,8 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			.RenderPass = imgui_render_pass,
 		};
 
+		info.PipelineCache = veekay::app.vk_pipeline_cache;
+
 		ImGui_ImplVulkan_Init(&info);
 	}
 
@@ -411,20 +750,8 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		VkMemoryRequirements requirements;
 		vkGetImageMemoryRequirements(vk_device, vk_image_depth, &requirements);
 
-		VkPhysicalDeviceMemoryProperties properties;
-		vkGetPhysicalDeviceMemoryProperties(vk_physical_device, &properties);
-
-		uint32_t index = UINT_MAX;
-		for (uint32_t i = 0; i < properties.memoryTypeCount; ++i) {
-			const VkMemoryType& type = properties.memoryTypes[i];
-
-			if ((requirements.memoryTypeBits & (1 << i)) &&
-			    (type.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) {
-				index = i;
-				break;
-			}
-		}
-
+		uint32_t index = findMemoryType(requirements.memoryTypeBits,
+		                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 		if (index == UINT_MAX) {
 			std::cerr << "Failed to find required memory type for Vulkan depth image\n";
 			return 1;
@@ -481,7 +808,10 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 
 			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-			.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+
+			// NOTE: Headless frames are copied out instead of being presented
+			.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+			                        : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
 		};
 
 		VkAttachmentDescription depth_attachment{
@@ -546,7 +876,10 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		veekay::app.vk_render_pass = vk_render_pass;
 	}
 
-	{ // NOTE: Create framebuffer objects from swapchain images
+	{ // NOTE: Create framebuffer objects from swapchain or offscreen images
+		const std::vector<VkImageView>& color_views = headless ? offscreen_image_views
+		                                                       : vk_swapchain_image_views;
+
 		VkImageView attachments[] = {VK_NULL_HANDLE, vk_image_depth_view};
 
 		VkFramebufferCreateInfo info{
@@ -562,12 +895,12 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			.layers = 1,
 		};
 
-		const size_t count = vk_swapchain_images.size();
+		const size_t count = color_views.size();
 
 		vk_framebuffers.resize(count);
 
 		for (size_t i = 0; i < count; ++i) {
-			attachments[0] = vk_swapchain_image_views[i];
+			attachments[0] = color_views[i];
 			if (vkCreateFramebuffer(vk_device, &info, nullptr, &vk_framebuffers[i]) != VK_SUCCESS) {
 				std::cerr << "Failed to create Vulkan framebuffer " << i << '\n';
 				return 1;
@@ -629,6 +962,34 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		}
 	}
 
+	if (headless) { // NOTE: Allocate readback command buffers and host memory
+		readback_command_buffers.resize(max_frames_in_flight);
+		readback_buffers.resize(max_frames_in_flight);
+		readback_frames.resize(max_frames_in_flight, no_readback_frame);
+
+		VkCommandBufferAllocateInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = vk_command_pool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = max_frames_in_flight,
+		};
+
+		if (vkAllocateCommandBuffers(vk_device, &info, readback_command_buffers.data()) != VK_SUCCESS) {
+			std::cerr << "Failed to allocate Vulkan readback command buffers\n";
+			return 1;
+		}
+
+		if (app_info.readback) {
+			const size_t size = size_t(app.window_width) * app.window_height * 4;
+
+			for (uint32_t i = 0; i < max_frames_in_flight; ++i) {
+				readback_buffers[i] = new graphics::Buffer(size, nullptr,
+				                                           VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				                                           graphics::BufferPlacement::readback);
+			}
+		}
+	}
+
 	VkCommandBuffer onetime_command_buffer; {
 		VkCommandBufferAllocateInfo info{
 			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
@@ -652,6 +1013,10 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		vkBeginCommandBuffer(onetime_command_buffer, &info);
 	}
 
+	// NOTE: Worker threads are started last, so early error returns don't have to join them
+	jobs::init();
+	recording::init(max_frames_in_flight, vk_graphics_queue_family);
+
 	app_info.init(onetime_command_buffer);
 
 	{
@@ -666,40 +1031,125 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		vkQueueSubmit(vk_graphics_queue, 1, &info, VK_NULL_HANDLE);
 		vkQueueWaitIdle(vk_graphics_queue);
 
+		graphics::retireStaging(VK_NULL_HANDLE);
+
 		vkFreeCommandBuffers(vk_device, vk_command_pool, 1, &onetime_command_buffer);
 	}
 
-	while (veekay::app.running && !glfwWindowShouldClose(window)) {
+	// NOTE: Hands pixels of a finished headless frame over to application
+	auto deliver_readback = [&app_info](uint32_t slot) {
+		if (readback_frames.empty() || readback_frames[slot] == no_readback_frame) {
+			return;
+		}
+
+		app_info.readback(readback_frames[slot], readback_buffers[slot]->mapped_region);
+		readback_frames[slot] = no_readback_frame;
+	};
+
+	const auto start_time = std::chrono::steady_clock::now();
+	double previous_time = 0.0;
+	uint64_t frame_number = 0;
+
+	while (veekay::app.running) {
+		if (headless) {
+			if (app_info.headless_frames > 0 && frame_number >= app_info.headless_frames) {
+				break;
+			}
+		} else if (glfwWindowShouldClose(window)) {
+			break;
+		}
+
+		profiler::newFrame();
+
+		profiler::beginZone(profiler::Phase::frame_limit);
+		limitFrameRate(veekay::app.max_frame_rate);
+		profiler::endZone(profiler::Phase::frame_limit);
+
+		profiler::beginZone(profiler::Phase::input);
 		veekay::input::cache();
-		
-		glfwPollEvents();
-		double time = glfwGetTime();
+		profiler::endZone(profiler::Phase::input);
+
+		double time;
+
+		if (headless) {
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+			time = elapsed.count();
+
+			ImGuiIO& io = ImGui::GetIO();
+			io.DeltaTime = time > previous_time ? float(time - previous_time) : 1.0f / 60.0f;
+			previous_time = time;
+		} else {
+			profiler::beginZone(profiler::Phase::events);
+			glfwPollEvents();
+			profiler::endZone(profiler::Phase::events);
+
+			time = glfwGetTime();
+
+			ImGui_ImplVulkan_NewFrame();
+			ImGui_ImplGlfw_NewFrame();
+		}
 
-		ImGui_ImplVulkan_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
 
+		profiler::beginZone(profiler::Phase::update);
 		app_info.update(time);
+		profiler::endZone(profiler::Phase::update);
 
+		// NOTE: Kick off uploads requested during update, retire finished ones
+		graphics::processUploads();
+
+		profiler::drawOverlay();
+
+		profiler::beginZone(profiler::Phase::imgui_render);
 		ImGui::Render();
+		profiler::endZone(profiler::Phase::imgui_render);
 
 		// NOTE: Wait until the previous frame finishes
+		profiler::beginZone(profiler::Phase::fence_wait);
 		vkWaitForFences(vk_device, 1, &vk_in_flight_fences[vk_current_frame], true, UINT64_MAX);
+
+		// NOTE: Staging memory of finished frames goes back to the ring
+		graphics::reclaimStaging();
+
 		vkResetFences(vk_device, 1, &vk_in_flight_fences[vk_current_frame]);
 
+		// NOTE: Secondary command buffers of this frame slot are free to reuse
+		recording::beginFrame(vk_current_frame);
+		profiler::endZone(profiler::Phase::fence_wait);
+
+		profiler::collectGpu(vk_current_frame);
+
 		// NOTE: Get current swapchain framebuffer index
 		uint32_t swapchain_image_index = 0;
-		vkAcquireNextImageKHR(vk_device, vk_swapchain, UINT64_MAX,
-		                      vk_render_semaphores[vk_current_frame],
-		                      nullptr, &swapchain_image_index);
 
+		if (headless) {
+			// NOTE: Offscreen image of this frame slot is free again, read it out first
+			deliver_readback(vk_current_frame);
+			swapchain_image_index = vk_current_frame;
+		} else {
+			profiler::beginZone(profiler::Phase::acquire);
+			vkAcquireNextImageKHR(vk_device, vk_swapchain, UINT64_MAX,
+			                      vk_render_semaphores[vk_current_frame],
+			                      nullptr, &swapchain_image_index);
+			profiler::endZone(profiler::Phase::acquire);
+		}
+
+		VkCommandBuffer profiler_cmd = profiler::recordGpuBegin(vk_current_frame);
 		VkCommandBuffer cmd = vk_command_buffers[swapchain_image_index];
 
+		profiler::beginZone(profiler::Phase::render);
 		app_info.render(cmd, vk_framebuffers[swapchain_image_index]);
 
-		VkCommandBuffer imgui_cmd = imgui_command_buffers[swapchain_image_index];
-		{ // NOTE: Draw ImGui
-			vkResetCommandBuffer(imgui_cmd, 0);
+		// NOTE: Jobs spawned during the frame may still be writing data it uses
+		jobs::waitFrame();
+		profiler::endZone(profiler::Phase::render);
+
+		if (headless) {
+			profiler::beginZone(profiler::Phase::readback);
+
+			VkCommandBuffer readback_cmd = readback_command_buffers[vk_current_frame];
+
+			vkResetCommandBuffer(readback_cmd, 0);
 
 			{
 				VkCommandBufferBeginInfo info{
@@ -707,67 +1157,221 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 					.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
 				};
 
-				vkBeginCommandBuffer(imgui_cmd, &info);
+				vkBeginCommandBuffer(readback_cmd, &info);
 			}
 
-			{
-				VkRenderPassBeginInfo info{
-					.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-					.renderPass = imgui_render_pass,
-					.framebuffer = imgui_framebuffers[swapchain_image_index],
-					.renderArea = {
-						.extent = {app.window_width, app.window_height},
+			profiler::writeGpuRenderEnd(readback_cmd, vk_current_frame);
+
+			if (app_info.readback) { // NOTE: Copy rendered image into host visible memory
+				VkImageMemoryBarrier image_barrier{
+					.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+					.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+					.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+					.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.image = offscreen_images[vk_current_frame],
+					.subresourceRange = {
+						.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+						.baseMipLevel = 0,
+						.levelCount = 1,
+						.baseArrayLayer = 0,
+						.layerCount = 1,
 					},
 				};
 
-				vkCmdBeginRenderPass(imgui_cmd, &info, VK_SUBPASS_CONTENTS_INLINE);
+				vkCmdPipelineBarrier(readback_cmd,
+				                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+				                     0, 0, nullptr, 0, nullptr,
+				                     1, &image_barrier);
+
+				VkBufferImageCopy region{
+					.imageSubresource = {
+						.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+						.mipLevel = 0,
+						.baseArrayLayer = 0,
+						.layerCount = 1,
+					},
+					.imageExtent = {app.window_width, app.window_height, 1},
+				};
+
+				vkCmdCopyImageToBuffer(readback_cmd, offscreen_images[vk_current_frame],
+				                       VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				                       readback_buffers[vk_current_frame]->buffer,
+				                       1, &region);
+
+				VkBufferMemoryBarrier buffer_barrier{
+					.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+					.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+					.dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+					.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.buffer = readback_buffers[vk_current_frame]->buffer,
+					.offset = 0,
+					.size = VK_WHOLE_SIZE,
+				};
+
+				vkCmdPipelineBarrier(readback_cmd,
+				                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+				                     VK_PIPELINE_STAGE_HOST_BIT,
+				                     0, 0, nullptr,
+				                     1, &buffer_barrier,
+				                     0, nullptr);
+
+				readback_frames[vk_current_frame] = frame_number;
 			}
 
-			ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), imgui_cmd);
+			profiler::writeGpuFrameEnd(readback_cmd, vk_current_frame);
 
-			vkCmdEndRenderPass(imgui_cmd);
-			vkEndCommandBuffer(imgui_cmd);
-		}
+			vkEndCommandBuffer(readback_cmd);
 
-		{ // NOTE: Submit commands to graphics queue
-			VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			profiler::endZone(profiler::Phase::readback);
 
-			VkCommandBuffer buffers[] = { cmd, imgui_cmd };
+			{ // NOTE: Submit commands to graphics queue, nothing to wait for or present
+				profiler::beginZone(profiler::Phase::submit);
 
-			VkSubmitInfo info{
-				.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-				.waitSemaphoreCount = 1,
-				.pWaitSemaphores = &vk_render_semaphores[vk_current_frame],
-				.pWaitDstStageMask = &wait_stage,
-				.commandBufferCount = 2,
-				.pCommandBuffers = buffers,
-				.signalSemaphoreCount = 1,
-				.pSignalSemaphores = &vk_present_semaphores[swapchain_image_index],
-			};
+				VkCommandBuffer buffers[] = { profiler_cmd, cmd, readback_cmd };
 
-			vkQueueSubmit(vk_graphics_queue, 1, &info, vk_in_flight_fences[vk_current_frame]);
-		}
+				VkSubmitInfo info{
+					.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+					.commandBufferCount = 3,
+					.pCommandBuffers = buffers,
+				};
 
-		{ // NOTE: Present renderer frame
-			VkPresentInfoKHR info{
-				.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-				.waitSemaphoreCount = 1,
-				.pWaitSemaphores = &vk_present_semaphores[swapchain_image_index],
-				.swapchainCount = 1,
-				.pSwapchains = &vk_swapchain,
-				.pImageIndices = &swapchain_image_index,
-			};
+				vkQueueSubmit(vk_graphics_queue, 1, &info, vk_in_flight_fences[vk_current_frame]);
+				graphics::retireStaging(vk_in_flight_fences[vk_current_frame]);
+
+				profiler::endZone(profiler::Phase::submit);
+			}
+		} else {
+			VkCommandBuffer imgui_cmd = imgui_command_buffers[swapchain_image_index];
+			{ // NOTE: Draw ImGui
+				profiler::beginZone(profiler::Phase::imgui_record);
+
+				vkResetCommandBuffer(imgui_cmd, 0);
+
+				{
+					VkCommandBufferBeginInfo info{
+						.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+						.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+					};
+
+					vkBeginCommandBuffer(imgui_cmd, &info);
+				}
+
+				profiler::writeGpuRenderEnd(imgui_cmd, vk_current_frame);
+
+				{
+					VkRenderPassBeginInfo info{
+						.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+						.renderPass = imgui_render_pass,
+						.framebuffer = imgui_framebuffers[swapchain_image_index],
+						.renderArea = {
+							.extent = {app.window_width, app.window_height},
+						},
+					};
+
+					vkCmdBeginRenderPass(imgui_cmd, &info, VK_SUBPASS_CONTENTS_INLINE);
+				}
+
+				ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), imgui_cmd);
+
+				vkCmdEndRenderPass(imgui_cmd);
+
+				profiler::writeGpuFrameEnd(imgui_cmd, vk_current_frame);
+
+				vkEndCommandBuffer(imgui_cmd);
+
+				profiler::endZone(profiler::Phase::imgui_record);
+			}
+
+			{ // NOTE: Submit commands to graphics queue
+				profiler::beginZone(profiler::Phase::submit);
+
+				VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+				VkCommandBuffer buffers[] = { profiler_cmd, cmd, imgui_cmd };
+
+				VkSubmitInfo info{
+					.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+					.waitSemaphoreCount = 1,
+					.pWaitSemaphores = &vk_render_semaphores[vk_current_frame],
+					.pWaitDstStageMask = &wait_stage,
+					.commandBufferCount = 3,
+					.pCommandBuffers = buffers,
+					.signalSemaphoreCount = 1,
+					.pSignalSemaphores = &vk_present_semaphores[swapchain_image_index],
+				};
+
+				vkQueueSubmit(vk_graphics_queue, 1, &info, vk_in_flight_fences[vk_current_frame]);
+				graphics::retireStaging(vk_in_flight_fences[vk_current_frame]);
+
+				profiler::endZone(profiler::Phase::submit);
+			}
+
+			{ // NOTE: Present renderer frame
+				profiler::beginZone(profiler::Phase::present);
+
+				const uint64_t present_id = ++vk_present_id;
+
+				VkPresentIdKHR id_info{
+					.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+					.swapchainCount = 1,
+					.pPresentIds = &present_id,
+				};
+
+				VkPresentInfoKHR info{
+					.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+					.pNext = app.present_wait ? &id_info : nullptr,
+					.waitSemaphoreCount = 1,
+					.pWaitSemaphores = &vk_present_semaphores[swapchain_image_index],
+					.swapchainCount = 1,
+					.pSwapchains = &vk_swapchain,
+					.pImageIndices = &swapchain_image_index,
+				};
+
+				VkResult result = vkQueuePresentKHR(vk_graphics_queue, &info);
 
-			vkQueuePresentKHR(vk_graphics_queue, &info);
+				// NOTE: Failed present never completes, so it mustn't be waited on
+				if (app.present_wait && (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)) {
+					vk_waited_present_id = present_id;
+				}
 
-			vk_current_frame = (vk_current_frame + 1) % max_frames_in_flight;
+				profiler::endZone(profiler::Phase::present);
+			}
 		}
+
+		vk_current_frame = (vk_current_frame + 1) % max_frames_in_flight;
+		++frame_number;
 	}
 
+	// NOTE: Background jobs may still be queueing GPU work
+	jobs::shutdown();
+
 	vkDeviceWaitIdle(vk_device);
 
+	// NOTE: Deliver remaining headless frames, oldest first
+	for (uint32_t i = 0; i < max_frames_in_flight; ++i) {
+		deliver_readback((vk_current_frame + i) % max_frames_in_flight);
+	}
+
 	app_info.shutdown();
 
+	recording::shutdown();
+	profiler::shutdown();
+
+	for (graphics::Buffer* buffer : readback_buffers) {
+		delete buffer;
+	}
+
+	if (!graphics::shutdownPipelineCache()) {
+		std::cerr << "Failed to save Vulkan pipeline cache\n";
+	}
+
+	graphics::shutdown();
+
 	vkDestroyCommandPool(vk_device, vk_command_pool, nullptr);
 
 	for (size_t i = 0, e = vk_swapchain_images.size(); i != e; ++i) {
@@ -785,29 +1389,49 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 	vkFreeMemory(vk_device, vk_image_depth_memory, nullptr);
 	vkDestroyImage(vk_device, vk_image_depth, nullptr);
 
-	vkDestroyCommandPool(vk_device, imgui_command_pool, nullptr);
-	vkDestroyRenderPass(vk_device, imgui_render_pass, nullptr);
-
 	for (size_t i = 0, e = vk_framebuffers.size(); i != e; ++i) {
 		vkDestroyFramebuffer(vk_device, vk_framebuffers[i], nullptr);
-		vkDestroyFramebuffer(vk_device, imgui_framebuffers[i], nullptr);
-		vkDestroyImageView(vk_device, vk_swapchain_image_views[i], nullptr);
 	}
 
-	ImGui_ImplVulkan_Shutdown();
-	ImGui_ImplGlfw_Shutdown();
+	for (size_t i = 0, e = offscreen_images.size(); i != e; ++i) {
+		vkDestroyImageView(vk_device, offscreen_image_views[i], nullptr);
+		vkFreeMemory(vk_device, offscreen_image_memories[i], nullptr);
+		vkDestroyImage(vk_device, offscreen_images[i], nullptr);
+	}
+
+	if (!headless) {
+		vkDestroyCommandPool(vk_device, imgui_command_pool, nullptr);
+		vkDestroyRenderPass(vk_device, imgui_render_pass, nullptr);
+
+		for (size_t i = 0, e = imgui_framebuffers.size(); i != e; ++i) {
+			vkDestroyFramebuffer(vk_device, imgui_framebuffers[i], nullptr);
+			vkDestroyImageView(vk_device, vk_swapchain_image_views[i], nullptr);
+		}
+
+		ImGui_ImplVulkan_Shutdown();
+		ImGui_ImplGlfw_Shutdown();
+	}
+
 	ImGui::DestroyContext();
 
-	vkDestroyDescriptorPool(vk_device, imgui_descriptor_pool, nullptr);
-	
-	vkDestroySwapchainKHR(vk_device, vk_swapchain, nullptr);
+	if (!headless) {
+		vkDestroyDescriptorPool(vk_device, imgui_descriptor_pool, nullptr);
+		vkDestroySwapchainKHR(vk_device, vk_swapchain, nullptr);
+	}
+
 	vkDestroyDevice(vk_device, nullptr);
-	vkDestroySurfaceKHR(vk_instance, vk_surface, nullptr);
+
+	if (!headless) {
+		vkDestroySurfaceKHR(vk_instance, vk_surface, nullptr);
+	}
+
 	vkb::destroy_debug_utils_messenger(vk_instance, vk_debug_messenger);
 	vkDestroyInstance(vk_instance, nullptr);
 
-	glfwDestroyWindow(window);
-	glfwTerminate();
+	if (!headless) {
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
 	
 	return 0;
 }
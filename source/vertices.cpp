@@ -0,0 +1,165 @@
+#include <veekay/vertices.hpp>
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+namespace veekay::graphics {
+
+namespace {
+
+	// NOTE: Zero counts as positive, so both halves of the square are reachable
+	float signNotZero(float value) {
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+} // namespace
+
+mat4 QuantizationBounds::matrix() const {
+	return mat4::scaling({extent, extent, extent}) * mat4::translation(center);
+}
+
+QuantizationBounds quantizationBounds(const vec3* positions, size_t count, size_t stride) {
+	if (count == 0) {
+		return QuantizationBounds{.center = {}, .extent = 1.0f};
+	}
+
+	const char* bytes = reinterpret_cast<const char*>(positions);
+
+	vec3 min = positions[0];
+	vec3 max = positions[0];
+
+	for (size_t i = 0; i < count; ++i) {
+		const vec3& position = *reinterpret_cast<const vec3*>(bytes + i * stride);
+
+		for (size_t j = 0; j < 3; ++j) {
+			min[j] = std::min(min[j], position[j]);
+			max[j] = std::max(max[j], position[j]);
+		}
+	}
+
+	return quantizationBounds(min, max);
+}
+
+QuantizationBounds quantizationBounds(const vec3& min, const vec3& max) {
+	const vec3 size = max - min;
+	const float extent = std::max({size.x, size.y, size.z}) * 0.5f;
+
+	return QuantizationBounds{
+		.center = (min + max) * 0.5f,
+		.extent = extent > 0.0f ? extent : 1.0f,
+	};
+}
+
+QuantizedVertex quantizeVertex(const QuantizationBounds& bounds, const vec3& position,
+                               const vec3& normal, const vec2& uv) {
+	const vec3 local = (position - bounds.center) / bounds.extent;
+	const vec2 octahedral = encodeOctahedral(normal);
+
+	return QuantizedVertex{
+		.position = {packSnorm16(local.x), packSnorm16(local.y), packSnorm16(local.z), 0},
+		.normal = {packSnorm16(octahedral.x), packSnorm16(octahedral.y)},
+		.uv = {packUnorm16(uv.x), packUnorm16(uv.y)},
+	};
+}
+
+int16_t packSnorm16(float value) {
+	return int16_t(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+uint16_t packUnorm16(float value) {
+	return uint16_t(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+vec2 encodeOctahedral(const vec3& normal) {
+	const float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+
+	if (sum == 0.0f) {
+		return {0.0f, 0.0f};
+	}
+
+	vec2 result = {normal.x / sum, normal.y / sum};
+
+	// NOTE: Lower hemisphere is folded over the diagonals
+	if (normal.z < 0.0f) {
+		result = {
+			(1.0f - std::abs(result.y)) * signNotZero(result.x),
+			(1.0f - std::abs(result.x)) * signNotZero(result.y),
+		};
+	}
+
+	return result;
+}
+
+vec3 decodeOctahedral(const vec2& encoded) {
+	vec3 result = {encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y)};
+
+	const float fold = std::max(-result.z, 0.0f);
+
+	result.x += result.x >= 0.0f ? -fold : fold;
+	result.y += result.y >= 0.0f ? -fold : fold;
+
+	return vec3::normalized(result);
+}
+
+VkVertexInputBindingDescription quantizedVertexBinding(uint32_t binding) {
+	return VkVertexInputBindingDescription{
+		.binding = binding,
+		.stride = sizeof(QuantizedVertex),
+		.inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+	};
+}
+
+void quantizedVertexAttributes(uint32_t binding, VkVertexInputAttributeDescription (&attributes)[3]) {
+	attributes[0] = VkVertexInputAttributeDescription{
+		.location = 0,
+		.binding = binding,
+		.format = VK_FORMAT_R16G16B16A16_SNORM,
+		.offset = offsetof(QuantizedVertex, position),
+	};
+
+	attributes[1] = VkVertexInputAttributeDescription{
+		.location = 1,
+		.binding = binding,
+		.format = VK_FORMAT_R16G16_SNORM,
+		.offset = offsetof(QuantizedVertex, normal),
+	};
+
+	attributes[2] = VkVertexInputAttributeDescription{
+		.location = 2,
+		.binding = binding,
+		.format = VK_FORMAT_R16G16_UNORM,
+		.offset = offsetof(QuantizedVertex, uv),
+	};
+}
+
+VkIndexType smallestIndexType(uint32_t vertex_count) {
+	return vertex_count <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+uint32_t indexSize(VkIndexType type) {
+	switch (type) {
+		case VK_INDEX_TYPE_UINT16: return 2;
+		case VK_INDEX_TYPE_UINT32: return 4;
+		default: throw std::runtime_error("Unsupported Vulkan index type");
+	}
+}
+
+void packIndices(const uint32_t* indices, size_t count, VkIndexType type, void* out) {
+	if (type == VK_INDEX_TYPE_UINT32) {
+		std::copy(indices, indices + count, static_cast<uint32_t*>(out));
+		return;
+	}
+
+	uint16_t* packed = static_cast<uint16_t*>(out);
+
+	for (size_t i = 0; i < count; ++i) {
+		if (indices[i] > UINT16_MAX) {
+			throw std::runtime_error("Index doesn't fit into 16 bits");
+		}
+
+		packed[i] = uint16_t(indices[i]);
+	}
+}
+
+} // namespace veekay::graphics
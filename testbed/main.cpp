@@ -1,7 +1,9 @@
 #include <cstdint>
 #include <climits>
 #include <cstring>
+#include <iterator>
 #include <vector>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <cmath>
@@ -16,6 +18,7 @@ namespace {
 
 constexpr uint32_t max_models = 1024;
 
+// NOTE: Meshes are built from these, but stored as QuantizedVertex on GPU
 struct Vertex {
 	veekay::vec3 position;
 	veekay::vec3 normal;
@@ -27,15 +30,39 @@ struct SceneUniforms {
 	veekay::mat4 view_projection;
 };
 
-struct ModelUniforms {
+// NOTE: Per-instance data read from a storage buffer by gl_InstanceIndex
+struct ModelInstance {
 	veekay::mat4 model;
 	veekay::vec3 albedo_color; float _pad0;
 };
 
+// NOTE: One per model, read by cull shader to produce indirect draws
+struct ObjectRecord {
+	veekay::vec4 bounds; // NOTE: World space sphere, center in xyz and radius in w
+	uint32_t index_count;
+	uint32_t first_index;
+	int32_t vertex_offset;
+	uint32_t _pad0;
+};
+
+// NOTE: Frustum planes are normalized and point inside
+struct CullParameters {
+	veekay::vec4 planes[6];
+	uint32_t object_count;
+	uint32_t compact; // NOTE: Pack visible draws, needs draw count support
+	uint32_t first_instance; // NOTE: Object id goes into firstInstance, needs device support
+};
+
+// NOTE: Lives in mesh arena, look up its range before drawing
 struct Mesh {
-	veekay::graphics::Buffer* vertex_buffer;
-	veekay::graphics::Buffer* index_buffer;
-	uint32_t indices;
+	veekay::graphics::MeshId id;
+
+	// NOTE: Bounding sphere in model space
+	veekay::vec3 bounds_center;
+	float bounds_radius;
+
+	// NOTE: Restores quantized positions, applied before model matrix
+	veekay::graphics::QuantizationBounds quantization;
 };
 
 struct Transform {
@@ -85,20 +112,37 @@ inline namespace {
 inline namespace {
 	VkShaderModule vertex_shader_module;
 	VkShaderModule fragment_shader_module;
+	VkShaderModule cull_shader_module;
 
 	VkDescriptorPool descriptor_pool;
 	VkDescriptorSetLayout descriptor_set_layout;
 	VkDescriptorSet descriptor_set;
 
 	VkPipelineLayout pipeline_layout;
-	VkPipeline pipeline;
+	veekay::graphics::PipelineHandle pipeline;
+
+	VkDescriptorSetLayout cull_descriptor_set_layout;
+	VkDescriptorSet cull_descriptor_set;
+
+	VkPipelineLayout cull_pipeline_layout;
+	veekay::graphics::PipelineHandle cull_pipeline;
 
 	veekay::graphics::Buffer* scene_uniforms_buffer;
-	veekay::graphics::Buffer* model_uniforms_buffer;
+	veekay::graphics::Buffer* model_instances_buffer;
+
+	veekay::graphics::Buffer* object_records_buffer;
+	veekay::graphics::Buffer* draw_commands_buffer; // NOTE: Written by cull shader
+	veekay::graphics::Buffer* draw_count_buffer;    // NOTE: Visible draws when compacted
+
+	CullParameters cull_parameters;
+
+	veekay::graphics::MeshArena* mesh_arena;
 
 	Mesh plane_mesh;
 	Mesh cube_mesh;
 
+	const char* imported_mesh_path; // NOTE: OBJ or glTF file passed on command line
+
 	veekay::graphics::Texture* missing_texture;
 	VkSampler missing_texture_sampler;
 
@@ -157,6 +201,44 @@ VkShaderModule loadShaderModule(const char* path) {
 	return result;
 }
 
+// NOTE: Optimizes and quantizes vertices into mesh arena. Bounding sphere
+//       is around vertex bounding box, not the tightest one but cheap
+Mesh addMesh(VkCommandBuffer cmd, const char* name,
+             std::vector<Vertex> vertices, std::vector<uint32_t> indices) {
+	Mesh mesh{};
+
+	auto report = veekay::graphics::optimizeMesh(vertices, indices, offsetof(Vertex, position));
+
+	std::cout << name << " mesh: " << report.vertices_before << " -> " << report.vertices_after
+	          << " vertices, ACMR " << report.before.acmr << " -> " << report.after.acmr
+	          << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << '\n';
+
+	mesh.quantization = veekay::graphics::quantizationBounds(&vertices[0].position,
+	                                                         vertices.size(), sizeof(Vertex));
+
+	std::vector<veekay::graphics::QuantizedVertex> quantized(vertices.size());
+
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		const Vertex& vertex = vertices[i];
+
+		quantized[i] = veekay::graphics::quantizeVertex(mesh.quantization, vertex.position,
+		                                                vertex.normal, vertex.uv);
+	}
+
+	mesh.id = mesh_arena->add(cmd, quantized.data(), uint32_t(quantized.size()),
+	                          indices.data(), uint32_t(indices.size()));
+
+	mesh.bounds_center = mesh.quantization.center;
+	mesh.bounds_radius = 0.0f;
+
+	for (const Vertex& vertex : vertices) {
+		float distance = veekay::vec3::length(vertex.position - mesh.bounds_center);
+		mesh.bounds_radius = std::max(mesh.bounds_radius, distance);
+	}
+
+	return mesh;
+}
+
 void initialize(VkCommandBuffer cmd) {
 	VkDevice& device = veekay::app.vk_device;
 	VkPhysicalDevice& physical_device = veekay::app.vk_physical_device;
@@ -195,33 +277,13 @@ void initialize(VkCommandBuffer cmd) {
 		};
 
 		// NOTE: How many bytes does a vertex take?
-		VkVertexInputBindingDescription buffer_binding{
-			.binding = 0,
-			.stride = sizeof(Vertex),
-			.inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-		};
+		VkVertexInputBindingDescription buffer_binding =
+			veekay::graphics::quantizedVertexBinding(0);
 
-		// NOTE: Declare vertex attributes
-		VkVertexInputAttributeDescription attributes[] = {
-			{
-				.location = 0, // NOTE: First attribute
-				.binding = 0, // NOTE: First vertex buffer
-				.format = VK_FORMAT_R32G32B32_SFLOAT, // NOTE: 3-component vector of floats
-				.offset = offsetof(Vertex, position), // NOTE: Offset of "position" field in a Vertex struct
-			},
-			{
-				.location = 1,
-				.binding = 0,
-				.format = VK_FORMAT_R32G32B32_SFLOAT,
-				.offset = offsetof(Vertex, normal),
-			},
-			{
-				.location = 2,
-				.binding = 0,
-				.format = VK_FORMAT_R32G32_SFLOAT,
-				.offset = offsetof(Vertex, uv),
-			},
-		};
+		// NOTE: Declare vertex attributes, 16-bit normalized integers
+		//       are turned into floats by vertex fetch, see shader.vert
+		VkVertexInputAttributeDescription attributes[3];
+		veekay::graphics::quantizedVertexAttributes(0, attributes);
 
 		// NOTE: Describe inputs
 		VkPipelineVertexInputStateCreateInfo input_state_info{
@@ -317,7 +379,7 @@ void initialize(VkCommandBuffer cmd) {
 					.descriptorCount = 8,
 				},
 				{
-					.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+					.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 					.descriptorCount = 8,
 				},
 				{
@@ -328,7 +390,7 @@ void initialize(VkCommandBuffer cmd) {
 			
 			VkDescriptorPoolCreateInfo info{
 				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-				.maxSets = 1,
+				.maxSets = 2,
 				.poolSizeCount = sizeof(pools) / sizeof(pools[0]),
 				.pPoolSizes = pools,
 			};
@@ -352,9 +414,9 @@ void initialize(VkCommandBuffer cmd) {
 				},
 				{
 					.binding = 1,
-					.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+					.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 					.descriptorCount = 1,
-					.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+					.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
 				},
 			};
 
@@ -387,11 +449,20 @@ void initialize(VkCommandBuffer cmd) {
 			}
 		}
 
-		// NOTE: Declare external data sources, only push constants this time
+		// NOTE: Index of first object, for draws that can't pass it in firstInstance
+		VkPushConstantRange push_constants{
+			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+			.offset = 0,
+			.size = sizeof(uint32_t),
+		};
+
+		// NOTE: Declare external data sources
 		VkPipelineLayoutCreateInfo layout_info{
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
 			.setLayoutCount = 1,
 			.pSetLayouts = &descriptor_set_layout,
+			.pushConstantRangeCount = 1,
+			.pPushConstantRanges = &push_constants,
 		};
 
 		// NOTE: Create pipeline layout
@@ -417,13 +488,93 @@ void initialize(VkCommandBuffer cmd) {
 			.renderPass = veekay::app.vk_render_pass,
 		};
 
-		// NOTE: Create graphics pipeline
-		if (vkCreateGraphicsPipelines(device, nullptr,
-		                              1, &info, nullptr, &pipeline) != VK_SUCCESS) {
-			std::cerr << "Failed to create Vulkan pipeline\n";
+		// NOTE: Compiled in background, first frames are drawn without it
+		pipeline = veekay::graphics::compilePipeline(info);
+	}
+
+	{ // NOTE: Build compute pipeline that culls models and writes indirect draws
+		cull_shader_module = loadShaderModule("./shaders/cull.comp.spv");
+		if (!cull_shader_module) {
+			std::cerr << "Failed to load Vulkan compute shader from file\n";
 			veekay::app.running = false;
 			return;
 		}
+
+		{
+			VkDescriptorSetLayoutBinding bindings[3];
+
+			// NOTE: Object records, draw commands and draw counts
+			for (uint32_t i = 0; i < 3; ++i) {
+				bindings[i] = VkDescriptorSetLayoutBinding{
+					.binding = i,
+					.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+					.descriptorCount = 1,
+					.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+				};
+			}
+
+			VkDescriptorSetLayoutCreateInfo info{
+				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+				.bindingCount = sizeof(bindings) / sizeof(bindings[0]),
+				.pBindings = bindings,
+			};
+
+			if (vkCreateDescriptorSetLayout(device, &info, nullptr,
+			                                &cull_descriptor_set_layout) != VK_SUCCESS) {
+				std::cerr << "Failed to create Vulkan descriptor set layout\n";
+				veekay::app.running = false;
+				return;
+			}
+		}
+
+		{
+			VkDescriptorSetAllocateInfo info{
+				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+				.descriptorPool = descriptor_pool,
+				.descriptorSetCount = 1,
+				.pSetLayouts = &cull_descriptor_set_layout,
+			};
+
+			if (vkAllocateDescriptorSets(device, &info, &cull_descriptor_set) != VK_SUCCESS) {
+				std::cerr << "Failed to create Vulkan descriptor set\n";
+				veekay::app.running = false;
+				return;
+			}
+		}
+
+		VkPushConstantRange push_constants{
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.offset = 0,
+			.size = sizeof(CullParameters),
+		};
+
+		VkPipelineLayoutCreateInfo layout_info{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 1,
+			.pSetLayouts = &cull_descriptor_set_layout,
+			.pushConstantRangeCount = 1,
+			.pPushConstantRanges = &push_constants,
+		};
+
+		if (vkCreatePipelineLayout(device, &layout_info,
+		                           nullptr, &cull_pipeline_layout) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan pipeline layout\n";
+			veekay::app.running = false;
+			return;
+		}
+
+		VkComputePipelineCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			.stage = {
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+				.module = cull_shader_module,
+				.pName = "main",
+			},
+			.layout = cull_pipeline_layout,
+		};
+
+		cull_pipeline = veekay::graphics::compilePipeline(info);
 	}
 
 	scene_uniforms_buffer = new veekay::graphics::Buffer(
@@ -431,10 +582,28 @@ void initialize(VkCommandBuffer cmd) {
 		nullptr,
 		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
 
-	model_uniforms_buffer = new veekay::graphics::Buffer(
-		max_models * veekay::graphics::Buffer::structureAlignment(sizeof(ModelUniforms)),
+	model_instances_buffer = new veekay::graphics::Buffer(
+		max_models * sizeof(ModelInstance),
 		nullptr,
-		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+	object_records_buffer = new veekay::graphics::Buffer(
+		max_models * sizeof(ObjectRecord),
+		nullptr,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+	draw_commands_buffer = new veekay::graphics::Buffer(
+		max_models * sizeof(VkDrawIndexedIndirectCommand),
+		nullptr,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		veekay::graphics::BufferPlacement::device);
+
+	draw_count_buffer = new veekay::graphics::Buffer(
+		sizeof(uint32_t),
+		nullptr,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		veekay::graphics::BufferPlacement::device);
 
 	// NOTE: This texture and sampler is used when texture could not be loaded
 	{
@@ -459,6 +628,41 @@ void initialize(VkCommandBuffer cmd) {
 		                                                pixels);
 	}
 
+	{ // NOTE: Files are decoded in parallel on job threads, lodepng does the decoding
+		veekay::graphics::ImageLoadRequest requests[] = {
+			{"./assets/lenna.png", VK_FORMAT_R8G8B8A8_SRGB, false},
+		};
+
+		auto decode = [](const void* data, size_t size, veekay::graphics::DecodedImage& image) {
+			unsigned width, height;
+
+			if (lodepng::decode(image.pixels, width, height,
+			                    static_cast<const unsigned char*>(data), size) != 0) {
+				return false;
+			}
+
+			image.width = width;
+			image.height = height;
+
+			return true;
+		};
+
+		auto results = veekay::graphics::loadImages(requests, std::size(requests), decode);
+
+		for (const auto& result : results) {
+			if (!result.texture) {
+				std::cerr << result.error << '\n';
+				continue;
+			}
+
+			std::cout << result.width << 'x' << result.height
+			          << " decode " << result.decode_time << " ms, convert " << result.convert_time
+			          << " ms, upload " << result.upload_time << " ms\n";
+		}
+
+		texture = results[0].texture;
+	}
+
 	{
 		VkDescriptorBufferInfo buffer_infos[] = {
 			{
@@ -467,9 +671,9 @@ void initialize(VkCommandBuffer cmd) {
 				.range = sizeof(SceneUniforms),
 			},
 			{
-				.buffer = model_uniforms_buffer->buffer,
+				.buffer = model_instances_buffer->buffer,
 				.offset = 0,
-				.range = sizeof(ModelUniforms),
+				.range = VK_WHOLE_SIZE,
 			},
 		};
 
@@ -489,7 +693,7 @@ void initialize(VkCommandBuffer cmd) {
 				.dstBinding = 1,
 				.dstArrayElement = 0,
 				.descriptorCount = 1,
-				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 				.pBufferInfo = &buffer_infos[1],
 			},
 		};
@@ -498,6 +702,43 @@ void initialize(VkCommandBuffer cmd) {
 		                       write_infos, 0, nullptr);
 	}
 
+	{
+		veekay::graphics::Buffer* buffers[] = {
+			object_records_buffer,
+			draw_commands_buffer,
+			draw_count_buffer,
+		};
+
+		VkDescriptorBufferInfo buffer_infos[3];
+		VkWriteDescriptorSet write_infos[3];
+
+		for (uint32_t i = 0; i < 3; ++i) {
+			buffer_infos[i] = VkDescriptorBufferInfo{
+				.buffer = buffers[i]->buffer,
+				.offset = 0,
+				.range = VK_WHOLE_SIZE,
+			};
+
+			write_infos[i] = VkWriteDescriptorSet{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = cull_descriptor_set,
+				.dstBinding = i,
+				.dstArrayElement = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.pBufferInfo = &buffer_infos[i],
+			};
+		}
+
+		vkUpdateDescriptorSets(device, 3, write_infos, 0, nullptr);
+	}
+
+	// NOTE: Every mesh shares one vertex and index buffer. Indices are relative
+	//       to mesh's first vertex, so 16 bits are enough for meshes this small.
+	//       Arena widens them to 32 bits once an imported mesh needs it
+	mesh_arena = new veekay::graphics::MeshArena(sizeof(veekay::graphics::QuantizedVertex),
+	                                             1 << 16, 1 << 18, VK_INDEX_TYPE_UINT16);
+
 	// NOTE: Plane mesh initialization
 	{
 		// (v0)------(v1)
@@ -516,15 +757,7 @@ void initialize(VkCommandBuffer cmd) {
 			0, 1, 2, 2, 3, 0
 		};
 
-		plane_mesh.vertex_buffer = new veekay::graphics::Buffer(
-			vertices.size() * sizeof(Vertex), vertices.data(),
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-
-		plane_mesh.index_buffer = new veekay::graphics::Buffer(
-			indices.size() * sizeof(uint32_t), indices.data(),
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
-
-		plane_mesh.indices = uint32_t(indices.size());
+		plane_mesh = addMesh(cmd, "Plane", vertices, indices);
 	}
 
 	// NOTE: Cube mesh initialization
@@ -570,15 +803,7 @@ void initialize(VkCommandBuffer cmd) {
 			20, 21, 22, 22, 23, 20,
 		};
 
-		cube_mesh.vertex_buffer = new veekay::graphics::Buffer(
-			vertices.size() * sizeof(Vertex), vertices.data(),
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-
-		cube_mesh.index_buffer = new veekay::graphics::Buffer(
-			indices.size() * sizeof(uint32_t), indices.data(),
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
-
-		cube_mesh.indices = uint32_t(indices.size());
+		cube_mesh = addMesh(cmd, "Cube", vertices, indices);
 	}
 
 	// NOTE: Add models to scene
@@ -611,6 +836,31 @@ void initialize(VkCommandBuffer cmd) {
 		},
 		.albedo_color = veekay::vec3{0.0f, 0.0f, 1.0f}
 	});
+
+	if (imported_mesh_path) {
+		try {
+			Mesh mesh{};
+
+			mesh.id = mesh_arena->importFile(cmd, imported_mesh_path, mesh.quantization);
+
+			// NOTE: Sphere around quantization cube, importer only reports a bounding box
+			mesh.bounds_center = mesh.quantization.center;
+			mesh.bounds_radius = mesh.quantization.extent * std::sqrt(3.0f);
+
+			std::cout << imported_mesh_path << ": " << mesh_arena->range(mesh.id).vertex_count
+			          << " vertices, " << mesh_arena->range(mesh.id).index_count / 3 << " triangles\n";
+
+			models.emplace_back(Model{
+				.mesh = mesh,
+				.transform = Transform{
+					.position = {0.0f, -1.0f, 3.0f},
+				},
+				.albedo_color = veekay::vec3{1.0f, 1.0f, 1.0f}
+			});
+		} catch (const std::exception& error) {
+			std::cerr << error.what() << '\n';
+		}
+	}
 }
 
 // NOTE: Destroy resources here, do not cause leaks in your program!
@@ -619,27 +869,45 @@ void shutdown() {
 
 	vkDestroySampler(device, missing_texture_sampler, nullptr);
 	delete missing_texture;
+	delete texture;
 
-	delete cube_mesh.index_buffer;
-	delete cube_mesh.vertex_buffer;
+	delete mesh_arena;
 
-	delete plane_mesh.index_buffer;
-	delete plane_mesh.vertex_buffer;
+	delete draw_count_buffer;
+	delete draw_commands_buffer;
+	delete object_records_buffer;
 
-	delete model_uniforms_buffer;
+	delete model_instances_buffer;
 	delete scene_uniforms_buffer;
 
+	vkDestroyDescriptorSetLayout(device, cull_descriptor_set_layout, nullptr);
 	vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
 	vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
 
-	vkDestroyPipeline(device, pipeline, nullptr);
+	veekay::graphics::destroyPipeline(cull_pipeline);
+	vkDestroyPipelineLayout(device, cull_pipeline_layout, nullptr);
+	vkDestroyShaderModule(device, cull_shader_module, nullptr);
+
+	veekay::graphics::destroyPipeline(pipeline);
 	vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
 	vkDestroyShaderModule(device, fragment_shader_module, nullptr);
 	vkDestroyShaderModule(device, vertex_shader_module, nullptr);
 }
 
 void update(double time) {
+	if (pipeline.failed() || cull_pipeline.failed()) {
+		std::cerr << "Failed to create Vulkan pipeline\n";
+		veekay::app.running = false;
+		return;
+	}
+
 	ImGui::Begin("Controls:");
+
+	bool profiler_visible = veekay::profiler::isOverlayVisible();
+	if (ImGui::Checkbox("Profiler", &profiler_visible)) {
+		veekay::profiler::setOverlayVisible(profiler_visible);
+	}
+
 	ImGui::End();
 
 	if (!ImGui::IsWindowHovered()) {
@@ -682,28 +950,158 @@ void update(double time) {
 		.view_projection = camera.view_projection(aspect_ratio),
 	};
 
-	std::vector<ModelUniforms> model_uniforms(models.size());
-	for (size_t i = 0, n = models.size(); i < n; ++i) {
-		const Model& model = models[i];
-		ModelUniforms& uniforms = model_uniforms[i];
+	*(SceneUniforms*)scene_uniforms_buffer->mapped_region = scene_uniforms;
+
+	{ // NOTE: Frustum planes from rows of view projection matrix (Gribb-Hartmann)
+		auto rows = veekay::mat4::transpose(scene_uniforms.view_projection);
+
+		veekay::vec4 planes[] = {
+			rows[3] + rows[0], // NOTE: Left
+			rows[3] - rows[0], // NOTE: Right
+			rows[3] + rows[1], // NOTE: Bottom
+			rows[3] - rows[1], // NOTE: Top
+			rows[2],           // NOTE: Near, depth range is [0, 1]
+			rows[3] - rows[2], // NOTE: Far
+		};
+
+		for (size_t i = 0; i < 6; ++i) {
+			float length = std::sqrt(planes[i].x * planes[i].x +
+			                         planes[i].y * planes[i].y +
+			                         planes[i].z * planes[i].z);
 
-		uniforms.model = model.transform.matrix();
-		uniforms.albedo_color = model.albedo_color;
+			cull_parameters.planes[i] = planes[i] / length;
+		}
 	}
 
-	*(SceneUniforms*)scene_uniforms_buffer->mapped_region = scene_uniforms;
+	const uint32_t object_count = uint32_t(std::min(models.size(), size_t(max_models)));
+
+	cull_parameters.object_count = object_count;
+	cull_parameters.compact = veekay::app.draw_indirect_count && veekay::app.draw_indirect_first_instance;
+	cull_parameters.first_instance = veekay::app.draw_indirect_first_instance;
+
+	// NOTE: Transforms of large scenes are computed on all cores
+	auto transforms = veekay::jobs::parallelFor(object_count, 256, [](size_t begin, size_t end) {
+		ModelInstance* instances = static_cast<ModelInstance*>(model_instances_buffer->mapped_region);
+		ObjectRecord* objects = static_cast<ObjectRecord*>(object_records_buffer->mapped_region);
+
+		for (size_t i = begin; i < end; ++i) {
+			const Model& model = models[i];
+			const Mesh& mesh = model.mesh;
+			const veekay::graphics::MeshRange& range = mesh_arena->range(mesh.id);
 
-	const size_t alignment =
-		veekay::graphics::Buffer::structureAlignment(sizeof(ModelUniforms));
+			veekay::mat4 matrix = model.transform.matrix();
 
-	for (size_t i = 0, n = model_uniforms.size(); i < n; ++i) {
-		const ModelUniforms& uniforms = model_uniforms[i];
+			instances[i].model = mesh.quantization.matrix() * matrix;
+			instances[i].albedo_color = model.albedo_color;
+
+			// NOTE: Radius grows with the largest axis scale
+			float scale = 0.0f;
+
+			for (size_t axis = 0; axis < 3; ++axis) {
+				veekay::vec3 column = {matrix[axis].x, matrix[axis].y, matrix[axis].z};
+				scale = std::max(scale, veekay::vec3::length(column));
+			}
 
-		char* const pointer = static_cast<char*>(model_uniforms_buffer->mapped_region) + i * alignment;
-		*reinterpret_cast<ModelUniforms*>(pointer) = uniforms;
+			veekay::vec4 center = veekay::vec4{mesh.bounds_center.x, mesh.bounds_center.y,
+			                                   mesh.bounds_center.z, 1.0f} * matrix;
+
+			objects[i] = ObjectRecord{
+				.bounds = {center.x, center.y, center.z, mesh.bounds_radius * scale},
+				.index_count = range.index_count,
+				.first_index = range.first_index,
+				.vertex_offset = range.vertex_offset,
+			};
+		}
+	});
+
+	veekay::jobs::wait(transforms);
+}
+
+// NOTE: Runs on several threads at once, nothing bound by render is visible here.
+//       Every mesh lives in the arena, so buffers are bound once per chunk
+void recordDraws(VkCommandBuffer cmd, size_t begin, size_t end) {
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline());
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,
+	                        0, 1, &descriptor_set, 0, nullptr);
+
+	mesh_arena->bind(cmd);
+
+	const VkBuffer commands = draw_commands_buffer->buffer;
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+	// NOTE: Without drawIndirectFirstInstance it has to stay 0, so every object is
+	//       drawn on its own and vertex shader gets its index through push constant
+	const bool first_instance = veekay::app.draw_indirect_first_instance;
+
+	if (first_instance) {
+		const uint32_t first_object = 0;
+		vkCmdPushConstants(cmd, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT,
+		                   0, sizeof(first_object), &first_object);
+	}
+
+	if (first_instance && veekay::app.draw_indirect_count) {
+		// NOTE: Whole scene in one call, recorded as a single chunk
+		vkCmdDrawIndexedIndirectCount(cmd, commands, 0, draw_count_buffer->buffer, 0,
+		                              cull_parameters.object_count, stride);
+	} else if (first_instance && veekay::app.multi_draw_indirect) {
+		vkCmdDrawIndexedIndirect(cmd, commands, begin * stride, uint32_t(end - begin), stride);
+	} else {
+		for (size_t i = begin; i < end; ++i) {
+			if (!first_instance) {
+				const uint32_t first_object = uint32_t(i);
+				vkCmdPushConstants(cmd, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT,
+				                   0, sizeof(first_object), &first_object);
+			}
+
+			vkCmdDrawIndexedIndirect(cmd, commands, i * stride, 1, stride);
+		}
 	}
 }
 
+// NOTE: Rewrites draw commands for visible models, must be recorded outside of render pass
+void recordCulling(VkCommandBuffer cmd) {
+	// NOTE: Previous frame may still be reading draws we are about to overwrite
+	VkMemoryBarrier reuse_barrier{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+	};
+
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+	                     VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+	                     0, 1, &reuse_barrier, 0, nullptr, 0, nullptr);
+
+	vkCmdFillBuffer(cmd, draw_count_buffer->buffer, 0, VK_WHOLE_SIZE, 0);
+
+	VkMemoryBarrier clear_barrier{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+	};
+
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+	                     0, 1, &clear_barrier, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline.pipeline());
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline_layout,
+	                        0, 1, &cull_descriptor_set, 0, nullptr);
+	vkCmdPushConstants(cmd, cull_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT,
+	                   0, sizeof(CullParameters), &cull_parameters);
+
+	// NOTE: Matches local_size_x of cull shader
+	constexpr uint32_t group_size = 64;
+	vkCmdDispatch(cmd, (cull_parameters.object_count + group_size - 1) / group_size, 1, 1);
+
+	VkMemoryBarrier draw_barrier{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+	};
+
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+	                     0, 1, &draw_barrier, 0, nullptr, 0, nullptr);
+}
+
 void render(VkCommandBuffer cmd, VkFramebuffer framebuffer) {
 	vkResetCommandBuffer(cmd, 0);
 
@@ -716,6 +1114,14 @@ void render(VkCommandBuffer cmd, VkFramebuffer framebuffer) {
 		vkBeginCommandBuffer(cmd, &info);
 	}
 
+	// NOTE: Models are skipped until both pipelines finish compiling
+	const bool drawing = pipeline.ready() && cull_pipeline.ready() &&
+	                     cull_parameters.object_count > 0;
+
+	if (drawing) {
+		recordCulling(cmd);
+	}
+
 	{ // NOTE: Use current swapchain framebuffer and clear it
 		VkClearValue clear_color{.color = {{0.1f, 0.1f, 0.1f, 1.0f}}};
 		VkClearValue clear_depth{.depthStencil = {1.0f, 0}};
@@ -736,37 +1142,13 @@ void render(VkCommandBuffer cmd, VkFramebuffer framebuffer) {
 			.pClearValues = clear_values,
 		};
 
-		vkCmdBeginRenderPass(cmd, &info, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(cmd, &info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 	}
 
-	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-	VkDeviceSize zero_offset = 0;
-
-	VkBuffer current_vertex_buffer = VK_NULL_HANDLE;
-	VkBuffer current_index_buffer = VK_NULL_HANDLE;
-
-	const size_t model_uniorms_alignment =
-		veekay::graphics::Buffer::structureAlignment(sizeof(ModelUniforms));
-
-	for (size_t i = 0, n = models.size(); i < n; ++i) {
-		const Model& model = models[i];
-		const Mesh& mesh = model.mesh;
-
-		if (current_vertex_buffer != mesh.vertex_buffer->buffer) {
-			current_vertex_buffer = mesh.vertex_buffer->buffer;
-			vkCmdBindVertexBuffers(cmd, 0, 1, &current_vertex_buffer, &zero_offset);
-		}
-
-		if (current_index_buffer != mesh.index_buffer->buffer) {
-			current_index_buffer = mesh.index_buffer->buffer;
-			vkCmdBindIndexBuffer(cmd, current_index_buffer, zero_offset, VK_INDEX_TYPE_UINT32);
-		}
-
-		uint32_t offset = i * model_uniorms_alignment;
-		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,
-		                    0, 1, &descriptor_set, 1, &offset);
-
-		vkCmdDrawIndexed(cmd, mesh.indices, 1, 0, 0, 0);
+	// NOTE: Draws are split between threads, each chunk goes into its own secondary command buffer
+	if (drawing) {
+		const size_t draw_count = cull_parameters.compact ? 1 : cull_parameters.object_count;
+		veekay::recording::recordParallel(cmd, framebuffer, draw_count, recordDraws);
 	}
 
 	vkCmdEndRenderPass(cmd);
@@ -775,7 +1157,9 @@ void render(VkCommandBuffer cmd, VkFramebuffer framebuffer) {
 
 } // namespace
 
-int main() {
+int main(int argc, char** argv) {
+	imported_mesh_path = argc > 1 ? argv[1] : nullptr;
+
 	return veekay::run({
 		.init = initialize,
 		.shutdown = shutdown,
@@ -0,0 +1,397 @@
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+
+#include <veekay/types.hpp>
+#include <veekay/vertices.hpp>
+#include <veekay/mesh_file.hpp>
+#include <veekay/mesh_importer.hpp>
+#include <veekay/mesh_optimizer.hpp>
+
+namespace veekay::jobs {
+
+void init();
+void shutdown();
+
+} // namespace veekay::jobs
+
+namespace {
+
+namespace graphics = veekay::graphics;
+
+using veekay::vec2;
+using veekay::vec3;
+
+constexpr uint32_t max_lod_count = 4;
+constexpr uint32_t lod_grid_resolution = 64; // NOTE: Cells along bounds of first reduced LOD
+
+// NOTE: Values of meshoptimizer and most mesh shader guides
+constexpr uint32_t meshlet_max_vertices = 64;
+constexpr uint32_t meshlet_max_triangles = 124;
+
+typedef graphics::ImportedVertex Vertex;
+
+struct Options {
+	const char* input = nullptr;
+	const char* output = nullptr;
+	graphics::MeshImportOptions import;
+};
+
+void printUsage() {
+	std::cerr << "Usage: veekay_meshconv [options] <input.obj|.gltf|.glb> <output.vkmf>\n"
+	             "\n"
+	             "  --keep-y          Don't mirror Y axis, input already has Y down\n"
+	             "  --flip-winding    Reverse triangle winding of input\n"
+	             "  --chunk-size <MB> Size of work parsed by a single job thread, 4 by default\n";
+}
+
+bool parseArguments(int argc, char** argv, Options& options) {
+	for (int i = 1; i < argc; ++i) {
+		const char* argument = argv[i];
+
+		if (std::strcmp(argument, "--flip-winding") == 0) {
+			options.import.flip_winding = true;
+		} else if (std::strcmp(argument, "--keep-y") == 0) {
+			options.import.mirror_y = false;
+		} else if (std::strcmp(argument, "--chunk-size") == 0 && i + 1 < argc) {
+			const long megabytes = std::strtol(argv[++i], nullptr, 10);
+
+			if (megabytes <= 0) {
+				std::cerr << "Invalid chunk size " << argv[i] << '\n';
+				return false;
+			}
+
+			options.import.chunk_size = size_t(megabytes) << 20;
+		} else if (argument[0] == '-') {
+			std::cerr << "Unknown option " << argument << '\n';
+			return false;
+		} else if (!options.input) {
+			options.input = argument;
+		} else if (!options.output) {
+			options.output = argument;
+		} else {
+			std::cerr << "Unexpected argument " << argument << '\n';
+			return false;
+		}
+	}
+
+	return options.input && options.output;
+}
+
+// NOTE: Front faces are clockwise, see optimizeOverdraw
+vec3 triangleNormal(const vec3& a, const vec3& b, const vec3& c) {
+	return vec3::cross(c - a, b - a);
+}
+
+void computeSphere(const std::vector<Vertex>& vertices, const uint32_t* list, size_t count,
+                   float (&center)[3], float& radius) {
+	vec3 min = vertices[list[0]].position;
+	vec3 max = min;
+
+	for (size_t i = 0; i < count; ++i) {
+		const vec3& position = vertices[list[i]].position;
+
+		for (size_t j = 0; j < 3; ++j) {
+			min[j] = std::min(min[j], position[j]);
+			max[j] = std::max(max[j], position[j]);
+		}
+	}
+
+	const vec3 middle = (min + max) * 0.5f;
+
+	radius = 0.0f;
+
+	for (size_t i = 0; i < count; ++i) {
+		radius = std::max(radius, vec3::length(vertices[list[i]].position - middle));
+	}
+
+	center[0] = middle.x;
+	center[1] = middle.y;
+	center[2] = middle.z;
+}
+
+// NOTE: Vertex clustering, every vertex snaps to first vertex of its grid cell and
+//       triangles that collapse are dropped. Coarse, but keeps sharing one vertex buffer
+std::vector<uint32_t> simplify(const std::vector<Vertex>& vertices,
+                               const uint32_t* indices, uint32_t index_count,
+                               const graphics::QuantizationBounds& bounds, uint32_t resolution,
+                               float& error) {
+	const float cell = 2.0f * bounds.extent / float(resolution);
+
+	std::unordered_map<uint64_t, uint32_t> cells;
+	std::vector<uint32_t> representative(vertices.size());
+
+	error = 0.0f;
+
+	for (uint32_t i = 0; i < vertices.size(); ++i) {
+		const vec3 local = vertices[i].position - bounds.center;
+
+		uint64_t key = 0;
+
+		for (size_t j = 0; j < 3; ++j) {
+			const float coordinate = (local[j] + bounds.extent) / cell;
+			const uint64_t index = uint64_t(std::clamp(coordinate, 0.0f, float(resolution - 1)));
+
+			key = key * resolution + index;
+		}
+
+		const uint32_t target = cells.try_emplace(key, i).first->second;
+		representative[i] = target;
+
+		error = std::max(error, vec3::length(vertices[target].position - vertices[i].position));
+	}
+
+	std::vector<uint32_t> result;
+
+	for (uint32_t i = 0; i < index_count; i += 3) {
+		const uint32_t a = representative[indices[i + 0]];
+		const uint32_t b = representative[indices[i + 1]];
+		const uint32_t c = representative[indices[i + 2]];
+
+		if (a != b && b != c && c != a) {
+			result.insert(result.end(), {a, b, c});
+		}
+	}
+
+	return result;
+}
+
+// NOTE: Greedy in index order, which is already cache optimized and thus spatially coherent
+std::vector<graphics::MeshFileMeshlet> buildMeshlets(const std::vector<Vertex>& vertices,
+                                                     const std::vector<uint32_t>& indices,
+                                                     uint32_t index_count) {
+	std::vector<graphics::MeshFileMeshlet> meshlets;
+
+	std::vector<uint32_t> stamp(vertices.size(), UINT32_MAX);
+	std::vector<uint32_t> unique;
+
+	uint32_t first = 0;
+
+	auto finish = [&](uint32_t end) {
+		graphics::MeshFileMeshlet meshlet{
+			.first_index = first,
+			.index_count = end - first,
+			.vertex_count = uint32_t(unique.size()),
+		};
+
+		computeSphere(vertices, unique.data(), unique.size(), meshlet.center, meshlet.radius);
+
+		std::vector<vec3> normals;
+		vec3 axis{};
+
+		for (uint32_t i = first; i < end; i += 3) {
+			vec3 normal = triangleNormal(vertices[indices[i + 0]].position,
+			                             vertices[indices[i + 1]].position,
+			                             vertices[indices[i + 2]].position);
+
+			const float length = vec3::length(normal);
+
+			if (length > 0.0f) {
+				normal = normal * (1.0f / length);
+				normals.push_back(normal);
+				axis += normal;
+			}
+		}
+
+		const float axis_length = vec3::length(axis);
+		float min_dot = -1.0f;
+
+		if (axis_length > 0.0f) {
+			axis = axis * (1.0f / axis_length);
+			min_dot = 1.0f;
+
+			for (const vec3& normal : normals) {
+				min_dot = std::min(min_dot, vec3::dot(normal, axis));
+			}
+		}
+
+		// NOTE: Cone wider than a hemisphere can always be seen, cutoff of 1 never rejects
+		meshlet.cone_axis[0] = axis.x;
+		meshlet.cone_axis[1] = axis.y;
+		meshlet.cone_axis[2] = axis.z;
+		meshlet.cone_cutoff = min_dot <= 0.0f ? 1.0f : std::sqrt(1.0f - min_dot * min_dot);
+
+		meshlets.push_back(meshlet);
+
+		for (uint32_t vertex : unique) {
+			stamp[vertex] = UINT32_MAX;
+		}
+
+		unique.clear();
+		first = end;
+	};
+
+	for (uint32_t i = 0; i < index_count; i += 3) {
+		uint32_t new_vertices = 0;
+
+		for (uint32_t j = 0; j < 3; ++j) {
+			new_vertices += stamp[indices[i + j]] != uint32_t(meshlets.size());
+		}
+
+		const uint32_t triangle_count = (i - first) / 3;
+
+		if (unique.size() + new_vertices > meshlet_max_vertices ||
+		    triangle_count + 1 > meshlet_max_triangles) {
+			finish(i);
+		}
+
+		for (uint32_t j = 0; j < 3; ++j) {
+			const uint32_t vertex = indices[i + j];
+
+			if (stamp[vertex] != uint32_t(meshlets.size())) {
+				stamp[vertex] = uint32_t(meshlets.size());
+				unique.push_back(vertex);
+			}
+		}
+	}
+
+	if (first < index_count) {
+		finish(index_count);
+	}
+
+	return meshlets;
+}
+
+void convert(const Options& options) {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+
+	// NOTE: Optimization needs the whole mesh, so chunks are gathered here
+	graphics::importMesh(options.input, graphics::MeshImportTarget{
+		.begin = [&](const graphics::MeshImportInfo& info) {
+			vertices.resize(info.vertex_count);
+			indices.resize(info.index_count);
+		},
+		.write = [&](const graphics::MeshImportChunk& chunk) {
+			std::copy(chunk.vertices, chunk.vertices + chunk.vertex_count, vertices.begin() + chunk.first_vertex);
+			std::copy(chunk.indices, chunk.indices + chunk.index_count, indices.begin() + chunk.first_index);
+		},
+	}, options.import);
+
+	const graphics::MeshOptimizationReport report =
+		graphics::optimizeMesh(vertices, indices, offsetof(Vertex, position));
+
+	std::cout << options.input << ": " << report.vertices_before << " -> " << report.vertices_after
+	          << " vertices, " << indices.size() / 3 << " triangles, ACMR "
+	          << report.before.acmr << " -> " << report.after.acmr << '\n';
+
+	const graphics::QuantizationBounds bounds =
+		graphics::quantizationBounds(&vertices[0].position, vertices.size(), sizeof(Vertex));
+
+	graphics::MeshFileData data{
+		.vertex_format = graphics::MeshVertexFormat::quantized,
+		.vertex_stride = sizeof(graphics::QuantizedVertex),
+		.index_type = graphics::smallestIndexType(uint32_t(vertices.size())),
+		.quantization_center = {bounds.center.x, bounds.center.y, bounds.center.z},
+		.quantization_extent = bounds.extent,
+		.vertex_count = uint32_t(vertices.size()),
+	};
+
+	{
+		std::vector<uint32_t> all(vertices.size());
+
+		for (uint32_t i = 0; i < all.size(); ++i) {
+			all[i] = i;
+		}
+
+		computeSphere(vertices, all.data(), all.size(), data.bounds_center, data.bounds_radius);
+	}
+
+	// NOTE: Meshlets and LODs are built from full detail triangles at the front
+	const uint32_t full_index_count = uint32_t(indices.size());
+	data.meshlets = buildMeshlets(vertices, indices, full_index_count);
+
+	data.lods.push_back({.first_index = 0, .index_count = full_index_count, .error = 0.0f});
+
+	uint32_t resolution = lod_grid_resolution;
+	uint32_t previous_count = full_index_count;
+
+	while (data.lods.size() < max_lod_count && resolution >= 2) {
+		float error;
+		std::vector<uint32_t> lod = simplify(vertices, indices.data(), full_index_count,
+		                                    bounds, resolution, error);
+
+		resolution /= 2;
+
+		// NOTE: Grid finer than mesh detail removes next to nothing, try a coarser one
+		if (lod.size() * 10 > size_t(previous_count) * 9) {
+			continue;
+		}
+
+		if (lod.empty()) {
+			break;
+		}
+
+		graphics::optimizeVertexCache(lod.data(), lod.data(), lod.size(), vertices.size());
+
+		data.lods.push_back({
+			.first_index = uint32_t(indices.size()),
+			.index_count = uint32_t(lod.size()),
+			.error = error,
+		});
+
+		previous_count = uint32_t(lod.size());
+
+		indices.insert(indices.end(), lod.begin(), lod.end());
+	}
+
+	data.index_count = uint32_t(indices.size());
+
+	data.vertices.resize(vertices.size() * sizeof(graphics::QuantizedVertex));
+
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		const Vertex& vertex = vertices[i];
+
+		const graphics::QuantizedVertex quantized =
+			graphics::quantizeVertex(bounds, vertex.position, vertex.normal, vertex.uv);
+
+		std::memcpy(data.vertices.data() + i * sizeof(quantized), &quantized, sizeof(quantized));
+	}
+
+	data.indices.resize(indices.size() * graphics::indexSize(data.index_type));
+	graphics::packIndices(indices.data(), indices.size(), data.index_type, data.indices.data());
+
+	graphics::writeMeshFile(options.output, data);
+
+	std::cout << options.output << ": " << data.lods.size() << " LODs, "
+	          << data.meshlets.size() << " meshlets, "
+	          << (data.index_type == VK_INDEX_TYPE_UINT16 ? 16 : 32) << "-bit indices\n";
+
+	for (size_t i = 0; i < data.lods.size(); ++i) {
+		std::cout << "  LOD " << i << ": " << data.lods[i].index_count / 3
+		          << " triangles, error " << data.lods[i].error << '\n';
+	}
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	Options options;
+
+	if (!parseArguments(argc, argv, options)) {
+		printUsage();
+		return 1;
+	}
+
+	veekay::jobs::init();
+
+	int result = 0;
+
+	try {
+		convert(options);
+	} catch (const std::exception& error) {
+		std::cerr << error.what() << '\n';
+		result = 1;
+	}
+
+	veekay::jobs::shutdown();
+
+	return result;
+}